@@ -0,0 +1,248 @@
+#ifndef _CaloDQMCrystalMaps_h_
+#define _CaloDQMCrystalMaps_h_
+
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileDirectory.h"
+#include "art_root_io/TFileService.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistMemory.h"
+#include "otsdaq/Macros/CoutMacros.h"
+
+#include "Offline/CalorimeterGeom/inc/Calorimeter.hh"
+#include "Offline/DataProducts/inc/CaloConst.hh"
+#include "Offline/RecoDataProducts/inc/CaloHit.hh"
+
+#include <TProfile.h>
+#include <TProfile2D.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ots {
+
+  // Per-crystal and per-SiPM calorimeter maps.
+  //
+  // The hits are accumulated in plain counter arrays indexed by crystal (SiPM)
+  // id; the ROOT histograms are only touched at publish time, when the counters
+  // are rolled up into the crystal, disk-map, disk and ring summaries. This
+  // keeps the per-hit cost at a few array increments and the number of ROOT
+  // objects independent of the number of crystals. The rates and means are
+  // profiles filled with the sums of the interval (hits over events, values
+  // over hits), which add up when the packets of several publishers are
+  // merged.
+  class CaloDQMCrystalMaps {
+  public:
+    enum { kNDisks = mu2e::CaloConst::_nDisk };
+
+    CaloDQMCrystalMaps(std::string DirName = "Calo_crystals") : dirName(DirName), nEvents_(0), booked_(false){};
+    virtual ~CaloDQMCrystalMaps(void){};
+
+    struct crystalInfo_ {
+      int disk;
+      int ring;      //ring index within the disk
+      crystalInfo_() : disk(0), ring(0) {}
+    };
+
+    std::string                dirName;
+
+    //crystal geometry table, called at every run: rebuilt only if the number
+    //of crystals changes, in which case the booked histograms are rebinned in
+    //place and the counters of the current interval are dropped
+    void Setup(const mu2e::Calorimeter& cal, float ringWidth) {
+      if (!crystals_.empty() && cal.nCrystals() == nCrystals_) return;
+      nCrystals_ = cal.nCrystals();
+      nSiPMs_    = nCrystals_*mu2e::CaloConst::_nSiPMPerCrystal;
+      crystals_.assign(nCrystals_, crystalInfo_());
+      radius_.assign(nCrystals_, 0.);
+      x_.clear();
+      y_.clear();
+
+      float rMin[kNDisks];
+      for (int d=0; d<kNDisks; ++d) rMin[d] = 1e9;
+
+      for (int i=0; i<nCrystals_; ++i){
+	const CLHEP::Hep3Vector& pos = cal.crystal(i).localPosition();
+	int disk   = cal.crystal(i).diskID();
+	crystals_[i].disk = disk;
+	radius_[i] = std::sqrt(pos.x()*pos.x() + pos.y()*pos.y());
+	rMin[disk] = std::min(rMin[disk], radius_[i]);
+	x_.push_back(pos.x());
+	y_.push_back(pos.y());
+      }
+
+      nRings_ = 1;
+      for (int i=0; i<nCrystals_; ++i){
+	int disk = crystals_[i].disk;
+	crystals_[i].ring = int((radius_[i] - rMin[disk])/ringWidth);
+	nRings_ = std::max(nRings_, crystals_[i].ring + 1);
+      }
+
+      nEvents_ = 0;
+      hits_.assign(nCrystals_, 0);
+      sumE_.assign(nCrystals_, 0.);
+      sumT_.assign(nCrystals_, 0.);
+      sipmHits_.assign(nSiPMs_, 0);
+
+      if (booked_) setBins();
+    }
+
+    //booked once, after the first Setup
+    void BookHistos(art::ServiceHandle<art::TFileService> tfs) {
+      if (booked_) return;
+      art::TFileDirectory dir = tfs->mkdir(dirName);
+
+      _hCrystalRate   = dir.make<TProfile>("crystalRate"  , "Crystal hit rate; crystalId; hits/event"    , 1, 0, 1);
+      _hCrystalEnergy = dir.make<TProfile>("crystalEnergy", "Crystal mean energy; crystalId; <E> [MeV]"  , 1, 0, 1);
+      _hCrystalTime   = dir.make<TProfile>("crystalTime"  , "Crystal mean time; crystalId; <t> [ns]"     , 1, 0, 1);
+      _hSiPMRate      = dir.make<TProfile>("sipmRate"     , "SiPM hit rate; SiPMId; hits/event"           , 1, 0, 1);
+      _hDiskRate      = dir.make<TProfile>("diskRate"     , "Disk hit rate; disk; hits/event"             , kNDisks, -0.5, kNDisks-0.5);
+      _hRingRate      = dir.make<TProfile>("ringRate"     , "Ring hit rate; disk*nRings + ring; hits/event", 1, 0, 1);
+      _hRingEnergy    = dir.make<TProfile>("ringEnergy"   , "Ring mean energy; disk*nRings + ring; <E> [MeV]", 1, 0, 1);
+      for (int d=0; d<kNDisks; ++d){
+	_hMapRate  [d] = dir.make<TProfile2D>(Form("mapRate_disk%i"  , d), Form("Disk %i hit rate; x [mm]; y [mm]", d)        , 1, 0, 1, 1, 0, 1);
+	_hMapEnergy[d] = dir.make<TProfile2D>(Form("mapEnergy_disk%i", d), Form("Disk %i mean energy [MeV]; x [mm]; y [mm]", d), 1, 0, 1, 1, 0, 1);
+	_hMapTime  [d] = dir.make<TProfile2D>(Form("mapTime_disk%i"  , d), Form("Disk %i mean time [ns]; x [mm]; y [mm]", d)   , 1, 0, 1, 1, 0, 1);
+      }
+      booked_ = true;
+      setBins();
+    }
+
+    bool isBooked() const { return booked_; }
+
+    //per-event entry point: only counter updates
+    void fill(const mu2e::CaloHitCollection& hits) {
+      ++nEvents_;
+      for (const mu2e::CaloHit& hit : hits) {
+	unsigned id = hit.crystalID();
+	if (id >= unsigned(nCrystals_)) continue;
+	++hits_[id];
+	sumE_[id] += hit.energyDep();
+	sumT_[id] += hit.time();
+	for (const auto& digi : hit.recoCaloDigis()) {
+	  unsigned sipm = digi->SiPMID();
+	  if (sipm < unsigned(nSiPMs_)) ++sipmHits_[sipm];
+	}
+      }
+    }
+
+    //roll the counters up into the histograms, add them to the packet and reset
+    //counters, geometry tables and histograms
+    DQMMemoryUsage memoryUsage() const {
+      DQMMemoryUsage usage;
+      usage.addVector(crystals_); usage.addVector(radius_); usage.addVector(x_); usage.addVector(y_);
+      usage.addVector(hits_); usage.addVector(sumE_); usage.addVector(sumT_); usage.addVector(sipmHits_);
+      if (!booked_) return usage;
+      for (TH1* h : {_hCrystalRate, _hCrystalEnergy, _hCrystalTime, _hSiPMRate, _hDiskRate, _hRingRate, _hRingEnergy}) usage.addHist(h);
+      for (int d=0; d<kNDisks; ++d){
+	usage.addHist(_hMapRate[d]); usage.addHist(_hMapEnergy[d]); usage.addHist(_hMapTime[d]);
+      }
+      return usage;
+    }
+
+    void publish(std::map<std::string,std::vector<TH1*>>& hists_to_send, const std::string& refName) {
+      if (!booked_) return;
+      resetHistos();
+      double norm = (nEvents_ > 0) ? 1./nEvents_ : 0.;
+
+      //a rate is filled once with the weight of the events, a mean with the
+      //weight of the hits
+      std::vector<double> ringHits(kNDisks*nRings_, 0.), ringE(kNDisks*nRings_, 0.), diskHits(kNDisks, 0.);
+      for (int i=0; i<nCrystals_; ++i){
+	const crystalInfo_& c = crystals_[i];
+	int      ring = c.disk*nRings_ + c.ring;
+	ringHits[ring]   += hits_[i];
+	ringE   [ring]   += sumE_[i];
+	diskHits[c.disk] += hits_[i];
+	if (hits_[i] == 0) continue;
+	double meanE = sumE_[i]/hits_[i];
+	double meanT = sumT_[i]/hits_[i];
+	_hCrystalEnergy    ->Fill(i, meanE, hits_[i]);
+	_hCrystalTime      ->Fill(i, meanT, hits_[i]);
+	_hMapEnergy[c.disk]->Fill(x_[i], y_[i], meanE, hits_[i]);
+	_hMapTime  [c.disk]->Fill(x_[i], y_[i], meanT, hits_[i]);
+      }
+      for (int r=0; r<kNDisks*nRings_; ++r){
+	if (ringHits[r] > 0) _hRingEnergy->Fill(r, ringE[r]/ringHits[r], ringHits[r]);
+      }
+      if (nEvents_ > 0){
+	for (int i=0; i<nCrystals_; ++i){
+	  _hCrystalRate->Fill(i, hits_[i]*norm, nEvents_);
+	  _hMapRate[crystals_[i].disk]->Fill(x_[i], y_[i], hits_[i]*norm, nEvents_);
+	}
+	for (int s=0; s<nSiPMs_; ++s)          _hSiPMRate->Fill(s, sipmHits_[s]*norm, nEvents_);
+	for (int d=0; d<kNDisks; ++d)          _hDiskRate->Fill(d, diskHits[d]*norm, nEvents_);
+	for (int r=0; r<kNDisks*nRings_; ++r)  _hRingRate->Fill(r, ringHits[r]*norm, nEvents_);
+      }
+
+      TH1* all[] = {_hCrystalRate, _hCrystalEnergy, _hCrystalTime, _hSiPMRate, _hDiskRate, _hRingRate, _hRingEnergy};
+      for (TH1* h : all) hists_to_send[refName].push_back((TH1*)h->Clone());
+      for (int d=0; d<kNDisks; ++d){
+	hists_to_send[refName].push_back((TH1*)_hMapRate  [d]->Clone());
+	hists_to_send[refName].push_back((TH1*)_hMapEnergy[d]->Clone());
+	hists_to_send[refName].push_back((TH1*)_hMapTime  [d]->Clone());
+      }
+
+      resetCounters();
+    }
+
+  private:
+    static constexpr float kPitch = 34.4; //crystal pitch [mm] used for the disk-map binning
+
+    //binning from the geometry table
+    void setBins() {
+      _hCrystalRate  ->SetBins(nCrystals_, -0.5, nCrystals_-0.5);
+      _hCrystalEnergy->SetBins(nCrystals_, -0.5, nCrystals_-0.5);
+      _hCrystalTime  ->SetBins(nCrystals_, -0.5, nCrystals_-0.5);
+      _hSiPMRate     ->SetBins(nSiPMs_   , -0.5, nSiPMs_-0.5);
+      _hRingRate     ->SetBins(kNDisks*nRings_, -0.5, kNDisks*nRings_-0.5);
+      _hRingEnergy   ->SetBins(kNDisks*nRings_, -0.5, kNDisks*nRings_-0.5);
+
+      //disk maps binned at the crystal pitch
+      float xMax(0);
+      for (int i=0; i<nCrystals_; ++i) xMax = std::max(xMax, std::max(std::fabs(x_[i]), std::fabs(y_[i])));
+      int   nBins = 2*int(xMax/kPitch + 1);
+      float hMax  = nBins*kPitch/2;
+      for (int d=0; d<kNDisks; ++d){
+	_hMapRate  [d]->SetBins(nBins, -hMax, hMax, nBins, -hMax, hMax);
+	_hMapEnergy[d]->SetBins(nBins, -hMax, hMax, nBins, -hMax, hMax);
+	_hMapTime  [d]->SetBins(nBins, -hMax, hMax, nBins, -hMax, hMax);
+      }
+    }
+
+    void resetCounters() {
+      nEvents_ = 0;
+      std::fill(hits_.begin(), hits_.end(), 0);
+      std::fill(sumE_.begin(), sumE_.end(), 0.);
+      std::fill(sumT_.begin(), sumT_.end(), 0.);
+      std::fill(sipmHits_.begin(), sipmHits_.end(), 0);
+    }
+
+    void resetHistos() {
+      TH1* all[] = {_hCrystalRate, _hCrystalEnergy, _hCrystalTime, _hSiPMRate, _hDiskRate, _hRingRate, _hRingEnergy};
+      for (TH1* h : all) h->Reset();
+      for (int d=0; d<kNDisks; ++d){
+	_hMapRate[d]->Reset(); _hMapEnergy[d]->Reset(); _hMapTime[d]->Reset();
+      }
+    }
+
+    int                        nCrystals_ = 0, nSiPMs_ = 0, nRings_ = 1;
+    unsigned long              nEvents_;
+    bool                       booked_;
+    std::vector<crystalInfo_>  crystals_;
+    std::vector<float>         radius_, x_, y_;
+
+    //dense counters, indexed by crystal/SiPM id
+    std::vector<unsigned int>  hits_;
+    std::vector<float>         sumE_, sumT_;
+    std::vector<unsigned int>  sipmHits_;
+
+    TProfile   *_hCrystalRate = NULL, *_hCrystalEnergy = NULL, *_hCrystalTime = NULL, *_hSiPMRate = NULL;
+    TProfile   *_hDiskRate    = NULL, *_hRingRate      = NULL, *_hRingEnergy  = NULL;
+    TProfile2D *_hMapRate[kNDisks], *_hMapEnergy[kNDisks], *_hMapTime[kNDisks];
+  };
+
+} // namespace ots
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef _CaloDQMHandler_h_
+#define _CaloDQMHandler_h_
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileService.h"
+#include "otsdaq-mu2e-dqm/ArtModules/CaloDQMCrystalMaps.h"
+#include "otsdaq-mu2e-dqm/ArtModules/CaloDQMHistoContainer.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistMemory.h"
+
+#include "Offline/CalorimeterGeom/inc/Calorimeter.hh"
+#include "Offline/GeometryService/inc/GeomHandle.hh"
+#include "Offline/RecoDataProducts/inc/CaloCluster.hh"
+#include "Offline/RecoDataProducts/inc/CaloHit.hh"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ots {
+
+  // The calorimeter DQM of an event: the hit and cluster summary and, on
+  // request, the crystal maps. It is the calorimeter handler of RawDQM's
+  // DQMFragmentDispatcher and the fill of CaloDQM. The calo DTC data are
+  // monitored through the hits and clusters reconstructed from them
+  // (CaloHitMakerFast, CaloClusterFast), read from the event: the decoding
+  // and the hit reconstruction happen once, upstream. The summary set is
+  // the module's, picked per event (spill state); the crystal maps are
+  // owned here. Only these are touched, so the handler can run concurrently
+  // with the other subsystems.
+  class CaloDQMHandler {
+  public:
+    CaloDQMHandler(bool DoCrystals, float RingWidth) :
+      doCrystals_(DoCrystals), ringWidth_(RingWidth){};
+    virtual ~CaloDQMHandler(void){};
+
+    // the crystal table only depends on the geometry: the maps are booked at
+    // the first run and only rebinned if the number of crystals changes
+    void beginRun(art::ServiceHandle<art::TFileService> tfs) {
+      if (!doCrystals_) return;
+      mu2e::GeomHandle<mu2e::Calorimeter> cal;
+      crystalMaps_.Setup(*cal, ringWidth_);
+      crystalMaps_.BookHistos(tfs);
+    }
+
+    // histos may be NULL (spill state not monitored); the values are only
+    // buffered per hit, the histograms are filled once per event
+    void fill(const art::Event& event, CaloDQMHistoContainer* histos) {
+      auto const caloH    = event.getValidHandle<mu2e::CaloHitCollection>("CaloHitMakerFast::calo");
+      auto const clusterH = event.getValidHandle<mu2e::CaloClusterCollection>("CaloClusterFast");
+      if (histos) {
+	calo_summary_fill(histos->fillBuffer, caloH->size(), *clusterH);
+	histos->fillBuffer.Flush();
+      }
+      if (doCrystals_) crystalMaps_.fill(*caloH);
+    }
+
+    void publish(std::map<std::string,std::vector<TH1*>>& hists_to_send, const std::string& refName) {
+      if (doCrystals_) crystalMaps_.publish(hists_to_send, refName);
+    }
+
+    DQMMemoryUsage memoryUsage() const { return crystalMaps_.memoryUsage(); }
+
+  private:
+    bool                doCrystals_;
+    float               ringWidth_;
+    CaloDQMCrystalMaps  crystalMaps_;
+  };
+
+} // namespace ots
+
+#endif
@@ -6,6 +6,9 @@
 #include "art_root_io/TFileService.h"
 #include "otsdaq/NetworkUtilities/TCPPublishServer.h"
 #include "otsdaq/Macros/CoutMacros.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMFillBuffer.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMHistSchema.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/CaloFillEngine.h"
 #include <TH1F.h>
 #include <string>
 
@@ -13,8 +16,16 @@ namespace ots {
 
   class CaloDQMHistoContainer {
   public:
-    CaloDQMHistoContainer(){};
+    CaloDQMHistoContainer(std::string DirName = "Calo_summary") : dirName(DirName){};
     virtual ~CaloDQMHistoContainer(void){};
+
+    // the schemas are the ones of the fill engine (CaloFillEngine.h)
+    enum SummaryHist { kNHits = kCaloNHits, kNClusters = kCaloNClusters, kClusterEnergy = kCaloClusterEnergy,
+		       kNSummaryHists = kNCaloSummaryHists };
+
+    static constexpr const DQMHistSpec (&kOnspillSchema )[kNSummaryHists] = kCaloOnspillSchema;
+    static constexpr const DQMHistSpec (&kOffspillSchema)[kNSummaryHists] = kCaloOffspillSchema;
+
     struct summaryInfoHist_ {
       TH1F *_Hist;
       int   plane;
@@ -24,13 +35,16 @@ namespace ots {
     };
 
     std::vector<summaryInfoHist_> histograms;
+    std::string                   dirName;
+    DQMFillBuffer                 fillBuffer;   // per-event fills, the id is the position in histograms
 
     void BookSummaryHistos(art::ServiceHandle<art::TFileService> tfs, std::string Title,
 			   int nBins, float min, float max) {
       histograms.push_back(summaryInfoHist_());
-      art::TFileDirectory testDir = tfs->mkdir("Calo_summary");
+      art::TFileDirectory testDir = tfs->mkdir(dirName);
       this->histograms[histograms.size() - 1]._Hist = 
 	testDir.make<TH1F>(Title.c_str(), Title.c_str(), nBins, min, max);
+      fillBuffer.AddTarget(this->histograms[histograms.size() - 1]._Hist);
     }
   
     /* void BookHistos(art::ServiceHandle<art::TFileService> tfs, std::string Title, */
@@ -0,0 +1,183 @@
+#ifndef _CrvDQMChannelBank_h_
+#define _CrvDQMChannelBank_h_
+
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileDirectory.h"
+#include "art_root_io/TFileService.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistMemory.h"
+
+#include <TH1F.h>
+#include <TProfile.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ots {
+
+  // Per-channel CRV counters.
+  //
+  // One dense integer bank indexed by readout channel (ROC, FEB port, FEB
+  // channel): hit count, pedestal and time sums, and a coarse time histogram
+  // per sector. A hit costs a few integer additions at a computed index; the
+  // ROOT histograms are only touched at publish time, when the bank is rolled
+  // up into the per-channel, per-module (FEB) and per-sector (ROC) summaries.
+  // The rates and means are profiles filled with the sums of the interval
+  // (hits over events, values over hits): a receiver merging the packets of
+  // several publishers adds them up like the time counts.
+  class CrvDQMChannelBank {
+  public:
+    enum { kNROCs = 16, kNFEBsPerROC = 24, kNChannelsPerFEB = 64,
+	   kNFEBs = kNROCs*kNFEBsPerROC, kNChannels = kNFEBs*kNChannelsPerFEB,
+	   kNTimeBins = 128 };
+
+    CrvDQMChannelBank(std::string DirName = "CRV_channels") : dirName(DirName), nEvents_(0), stamp_(0), nActiveFEBs_(0), timeMax_(4096), booked_(false) {
+      hits_.assign(kNChannels, 0);
+      pedSum_.assign(kNChannels, 0);
+      pedSum2_.assign(kNChannels, 0);
+      timeSum_.assign(kNChannels, 0);
+      febHits_.assign(kNFEBs, 0);
+      febStamp_.assign(kNFEBs, 0);
+      rocTime_.assign(kNROCs*kNTimeBins, 0);
+    };
+    virtual ~CrvDQMChannelBank(void){};
+
+    std::string                dirName;
+
+    // dense channel index; -1 outside the readout map
+    static int channel(int roc, int port, int febChannel) {
+      if (roc < 0 || roc >= kNROCs || port < 0 || port >= kNFEBsPerROC ||
+	  febChannel < 0 || febChannel >= kNChannelsPerFEB) return -1;
+      return (roc*kNFEBsPerROC + port)*kNChannelsPerFEB + febChannel;
+    }
+
+    // the per-sector time histograms span [0, TimeMax) TDC counts
+    void BookHistos(art::ServiceHandle<art::TFileService> tfs, int TimeMax) {
+      if (booked_) return;
+      timeMax_ = TimeMax > 0 ? TimeMax : 4096;
+      art::TFileDirectory dir = tfs->mkdir(dirName);
+
+      _hChannelRate     = dir.make<TProfile>("crvChannelRate"    , "CRV channel hit rate; channel; hits/event"     , kNChannels, -0.5, kNChannels-0.5);
+      _hChannelPedestal = dir.make<TProfile>("crvChannelPedestal", "CRV channel pedestal; channel; <ADC>"         , kNChannels, -0.5, kNChannels-0.5, "s");
+      _hChannelTime     = dir.make<TProfile>("crvChannelTime"    , "CRV channel mean time; channel; <t> [TDC]"    , kNChannels, -0.5, kNChannels-0.5);
+      _hFEBRate         = dir.make<TProfile>("crvFEBRate"        , "CRV FEB hit rate; ROC*24 + port; hits/event"  , kNFEBs    , -0.5, kNFEBs-0.5);
+      _hROCRate         = dir.make<TProfile>("crvROCRate"        , "CRV ROC hit rate; ROC; hits/event"            , kNROCs    , -0.5, kNROCs-0.5);
+      for (int r=0; r<kNROCs; ++r){
+	_hROCTime[r] = dir.make<TH1F>(Form("crvROCTime_roc%i", r), Form("CRV ROC %i hit time; t [TDC]; hits", r), kNTimeBins, 0, timeMax_);
+      }
+      booked_ = true;
+    }
+
+    bool isBooked() const { return booked_; }
+
+    void beginEvent() {
+      ++nEvents_;
+      ++stamp_;
+      nActiveFEBs_ = 0;
+    }
+
+    // per-hit entry point: only counter updates
+    void fill(int Channel, int Pedestal, int Time) {
+      ++hits_[Channel];
+      pedSum_ [Channel] += Pedestal;
+      pedSum2_[Channel] += int64_t(Pedestal)*Pedestal;
+      timeSum_[Channel] += Time;
+      int feb = Channel/kNChannelsPerFEB;
+      ++febHits_[feb];
+      if (febStamp_[feb] != stamp_) {
+	febStamp_[feb] = stamp_;
+	++nActiveFEBs_;
+      }
+      int bin = (Time < 0) ? 0 : std::min<int64_t>(kNTimeBins - 1, int64_t(Time)*kNTimeBins/timeMax_);
+      ++rocTime_[(Channel/(kNFEBsPerROC*kNChannelsPerFEB))*kNTimeBins + bin];
+    }
+
+    // number of FEBs hit in the current event
+    size_t nActiveFEBs() const { return nActiveFEBs_; }
+
+    //the bank and the histograms
+    DQMMemoryUsage memoryUsage() const {
+      DQMMemoryUsage usage;
+      usage.addVector(hits_); usage.addVector(pedSum_); usage.addVector(pedSum2_); usage.addVector(timeSum_);
+      usage.addVector(febHits_); usage.addVector(febStamp_); usage.addVector(rocTime_);
+      if (!booked_) return usage;
+      for (TH1* h : {_hChannelRate, _hChannelPedestal, _hChannelTime, _hFEBRate, _hROCRate}) usage.addHist(h);
+      for (int r=0; r<kNROCs; ++r) usage.addHist(_hROCTime[r]);
+      return usage;
+    }
+
+    //roll the bank up into the histograms, add them to the packet and reset
+    void publish(std::map<std::string,std::vector<TH1*>>& hists_to_send, const std::string& refName) {
+      if (!booked_) return;
+      resetHistos();
+      double norm = (nEvents_ > 0) ? 1./nEvents_ : 0.;
+
+      //a rate is filled once with the weight of the events, a mean with the
+      //weight of the hits; the pedestal as two halves at mean -+ rms, which
+      //gives the profile the sum of the squares as well (spread as error)
+      for (int i=0; i<kNChannels; ++i){
+	if (nEvents_ > 0) _hChannelRate->Fill(i, hits_[i]*norm, nEvents_);
+	if (hits_[i] == 0) continue;
+	double mean = double(pedSum_[i])/hits_[i];
+	double rms  = std::sqrt(std::max(0., double(pedSum2_[i])/hits_[i] - mean*mean));
+	_hChannelPedestal->Fill(i, mean - rms, 0.5*hits_[i]);
+	_hChannelPedestal->Fill(i, mean + rms, 0.5*hits_[i]);
+	_hChannelTime    ->Fill(i, double(timeSum_[i])/hits_[i], hits_[i]);
+      }
+      std::vector<double> rocHits(kNROCs, 0.);
+      for (int f=0; f<kNFEBs; ++f){
+	if (nEvents_ > 0) _hFEBRate->Fill(f, febHits_[f]*norm, nEvents_);
+	rocHits[f/kNFEBsPerROC] += febHits_[f];
+      }
+      for (int r=0; r<kNROCs; ++r){
+	if (nEvents_ > 0) _hROCRate->Fill(r, rocHits[r]*norm, nEvents_);
+	for (int b=0; b<kNTimeBins; ++b) _hROCTime[r]->SetBinContent(b+1, rocTime_[r*kNTimeBins + b]);
+      }
+
+      TH1* all[] = {_hChannelRate, _hChannelPedestal, _hChannelTime, _hFEBRate, _hROCRate};
+      for (TH1* h : all) hists_to_send[refName].push_back((TH1*)h->Clone());
+      for (int r=0; r<kNROCs; ++r) hists_to_send[refName].push_back((TH1*)_hROCTime[r]->Clone());
+
+      resetCounters();
+    }
+
+  private:
+    void resetCounters() {
+      nEvents_ = 0;
+      std::fill(hits_.begin()   , hits_.end()   , 0);
+      std::fill(pedSum_.begin() , pedSum_.end() , 0);
+      std::fill(pedSum2_.begin(), pedSum2_.end(), 0);
+      std::fill(timeSum_.begin(), timeSum_.end(), 0);
+      std::fill(febHits_.begin(), febHits_.end(), 0);
+      std::fill(rocTime_.begin(), rocTime_.end(), 0);
+    }
+
+    void resetHistos() {
+      TH1* all[] = {_hChannelRate, _hChannelPedestal, _hChannelTime, _hFEBRate, _hROCRate};
+      for (TH1* h : all) h->Reset();
+      for (int r=0; r<kNROCs; ++r) _hROCTime[r]->Reset();
+    }
+
+    unsigned long              nEvents_;
+    uint32_t                   stamp_;          // event stamp of febStamp_, never reset
+    size_t                     nActiveFEBs_;
+    int                        timeMax_;
+    bool                       booked_;
+
+    //dense counters, indexed by channel, FEB and ROC*kNTimeBins + time bin
+    std::vector<uint32_t>      hits_;
+    std::vector<int64_t>       pedSum_, pedSum2_, timeSum_;
+    std::vector<uint32_t>      febHits_, febStamp_;
+    std::vector<uint32_t>      rocTime_;
+
+    TProfile *_hChannelRate = NULL, *_hChannelPedestal = NULL, *_hChannelTime = NULL;
+    TProfile *_hFEBRate     = NULL, *_hROCRate         = NULL;
+    TH1F *_hROCTime[kNROCs];
+  };
+
+} // namespace ots
+
+#endif
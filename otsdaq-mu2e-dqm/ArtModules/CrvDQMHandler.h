@@ -0,0 +1,83 @@
+#ifndef _CrvDQMHandler_h_
+#define _CrvDQMHandler_h_
+
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileService.h"
+#include "artdaq-core-mu2e/Data/CRVDataDecoder.hh"
+#include "otsdaq-mu2e-dqm/ArtModules/CrvDQMChannelBank.h"
+#include "otsdaq-mu2e-dqm/ArtModules/CrvDQMHistoContainer.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMFragmentDispatcher.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistMemory.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ots {
+
+  // The CRV DQM of the DTC data of an event, run as the CRV handler of a
+  // DQMFragmentDispatcher (CrvDQM, RawDQM): the hit summary and, on request,
+  // the per-channel bank. The summary set is the module's, picked per event
+  // (spill state); the channel bank is owned here. Only these are touched,
+  // so the handler can run concurrently with the other subsystems.
+  class CrvDQMHandler {
+  public:
+    CrvDQMHandler(bool DoChannels, int TimeMax) :
+      doChannels_(DoChannels), timeMax_(TimeMax){};
+    virtual ~CrvDQMHandler(void){};
+
+    void BookHistos(art::ServiceHandle<art::TFileService> tfs) {
+      if (doChannels_) channelBank_.BookHistos(tfs, timeMax_);
+    }
+
+    // histos may be NULL (spill state not monitored); one pass over the hits,
+    // the histograms are filled once per event
+    void fill(const DQMSubsystemFragments& frags, CrvDQMHistoContainer* histos) {
+      channelBank_.beginEvent();
+      size_t nHits(0);
+      for (const mu2e::CRVDataDecoder* cc : frags.crv) nHits += fill_(*cc, histos);
+      if (histos) {
+	schemaFill(histos, CrvDQMHistoContainer::kNHits      , nHits);
+	schemaFill(histos, CrvDQMHistoContainer::kNActiveFEBs, channelBank_.nActiveFEBs());
+	histos->fillBuffer.Flush();
+      }
+    }
+
+    void publish(std::map<std::string,std::vector<TH1*>>& hists_to_send, const std::string& refName) {
+      if (doChannels_) channelBank_.publish(hists_to_send, refName);
+    }
+
+    DQMMemoryUsage memoryUsage() const { return channelBank_.memoryUsage(); }
+
+  private:
+    size_t fill_(const mu2e::CRVDataDecoder& cc, CrvDQMHistoContainer* histos) {
+      size_t nHits(0);
+      for (size_t curBlockIdx = 0; curBlockIdx < cc.block_count(); curBlockIdx++) {
+	auto block_data = cc.dataAtBlockIndex(curBlockIdx);
+	if (block_data == nullptr || block_data->GetHeader()->GetPacketCount() == 0) continue;
+
+	for (const auto& crvHit : cc.GetCRVHits(curBlockIdx)) {
+	  const auto& info     = crvHit.first;
+	  const auto& waveform = crvHit.second;
+	  int time     = info.HitTime;
+	  int pedestal = waveform.empty() ? 0 : int(waveform.front().ADC);
+	  ++nHits;
+	  if (histos) {
+	    schemaFill(histos, CrvDQMHistoContainer::kPedestal, pedestal);
+	    schemaFill(histos, CrvDQMHistoContainer::kHitTime , time);
+	  }
+	  int channel = CrvDQMChannelBank::channel(info.controllerNumber, info.portNumber, info.febChannel);
+	  if (channel >= 0) channelBank_.fill(channel, pedestal, time);
+	}
+      }
+      return nHits;
+    }
+
+    bool                doChannels_;
+    int                 timeMax_;
+    CrvDQMChannelBank   channelBank_;
+  };
+
+} // namespace ots
+
+#endif
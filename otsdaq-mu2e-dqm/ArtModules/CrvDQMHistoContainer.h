@@ -0,0 +1,56 @@
+#ifndef _CrvDQMHistoContainer_h_
+#define _CrvDQMHistoContainer_h_
+
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileDirectory.h"
+#include "art_root_io/TFileService.h"
+#include "otsdaq/Macros/CoutMacros.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMFillBuffer.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMHistSchema.h"
+#include <TH1F.h>
+#include <string>
+
+namespace ots {
+
+  class CrvDQMHistoContainer {
+  public:
+    CrvDQMHistoContainer(std::string DirName = "CRV_summary") : dirName(DirName){};
+    virtual ~CrvDQMHistoContainer(void){};
+
+    enum SummaryHist { kNHits = 0, kNActiveFEBs, kPedestal, kHitTime, kNSummaryHists };
+
+    // onspill and offspill (cosmics only) binnings
+    static constexpr DQMHistSpec kOnspillSchema[kNSummaryHists] = {
+      { "CRV hits, nHits; nCRVHits; Events/10"        , 200, 0, 2000 },
+      { "CRV FEBs with hits; nFEBs; Events"           , 100, 0, 400  },
+      { "CRV pedestal; ADC; Hits"                     , 200, -200, 200 },
+      { "CRV hit time; TDC; Hits/32"                  , 128, 0, 4096 }};
+    static constexpr DQMHistSpec kOffspillSchema[kNSummaryHists] = {
+      { "CRV hits, nHits; nCRVHits; Events"           , 200, 0, 200  },
+      { "CRV FEBs with hits; nFEBs; Events"           , 100, 0, 100  },
+      { "CRV pedestal; ADC; Hits"                     , 200, -200, 200 },
+      { "CRV hit time; TDC; Hits/32"                  , 128, 0, 4096 }};
+    static_assert(schemaIsValid(kOnspillSchema) && schemaIsValid(kOffspillSchema), "invalid CRV summary schema");
+
+    struct summaryInfoHist_ {
+      TH1F *_Hist;
+      summaryInfoHist_() { _Hist = NULL; }
+    };
+
+    std::vector<summaryInfoHist_> histograms;
+    std::string                   dirName;
+    DQMFillBuffer                 fillBuffer;   // per-event fills, the id is the position in histograms
+
+    void BookSummaryHistos(art::ServiceHandle<art::TFileService> tfs, std::string Title,
+			   int nBins, float min, float max) {
+      histograms.push_back(summaryInfoHist_());
+      art::TFileDirectory testDir = tfs->mkdir(dirName);
+      this->histograms[histograms.size() - 1]._Hist =
+	testDir.make<TH1F>(Title.c_str(), Title.c_str(), nBins, min, max);
+      fillBuffer.AddTarget(this->histograms[histograms.size() - 1]._Hist);
+    }
+  };
+
+} // namespace ots
+
+#endif
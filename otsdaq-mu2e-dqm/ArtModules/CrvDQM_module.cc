@@ -0,0 +1,88 @@
+// This module produces histograms of the CRV raw data: per-event summaries,
+// and per-channel hit rates, pedestals and times rolled up per FEB and ROC
+
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "fhiclcpp/types/TableFragment.h"
+
+#include <TH1F.h>
+
+#include "otsdaq-mu2e-dqm/ArtModules/CrvDQMHandler.h"
+#include "otsdaq-mu2e-dqm/ArtModules/CrvDQMHistoContainer.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMFragmentDispatcher.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMModule.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMSpillState.h"
+#include "otsdaq/Macros/CoutMacros.h"
+#include "otsdaq/MessageFacility/MessageFacility.h"
+
+namespace ots {
+  class CrvDQM : public DQMModule<CrvDQMHistoContainer> {
+  public:
+    struct Config {
+      using Name = fhicl::Name;
+      using Comment = fhicl::Comment;
+      fhicl::TableFragment<DQMModuleConfig> dqm;
+      fhicl::Atom<int>             timeMax { Name("timeMax"), Comment("Upper edge [TDC] of the per-ROC hit-time histograms"), 4096 };
+    };
+
+    typedef art::EDAnalyzer::Table<Config> Parameters;
+
+    explicit CrvDQM(Parameters const& conf);
+
+    void analyze(art::Event const& event) override;
+    void beginJob() override;
+
+    void book_summary(CrvDQMHistoContainer *histos, SpillState spill) override;
+
+  private:
+    void collect_extra(packet_t& packet) override;
+    DQMMemoryUsage memory_extra() const override { return handler_.memoryUsage(); }
+
+    // the same decode and fill as the CRV handler of RawDQM, fed by a
+    // dispatcher with this handler only
+    CrvDQMHandler             handler_;
+    DQMFragmentDispatcher     dispatcher_;
+    size_t                    dispatchStage_, fillStage_;
+  };
+} // namespace ots
+
+ots::CrvDQM::CrvDQM(Parameters const& conf)
+  : DQMModule<CrvDQMHistoContainer>(conf, conf().dqm(), "CRV"),
+    handler_(hasHistType("Channels"), conf().timeMax()), dispatcher_(1),
+    dispatchStage_(addStage("dispatch")), fillStage_(addStage("decode+fill")) {
+  checkHistTypes({"Onspill", "Offspill", "Channels"});
+}
+
+void ots::CrvDQM::beginJob() {
+  __MOUT__ << "[CrvDQM::beginJob] Beginning job" << std::endl;
+  bookSpillSets();
+  handler_.BookHistos(tfs);
+  dispatcher_.add(mu2e::detail::Subsystem::CRV, "crv",
+		  [this](const art::Event& event, const DQMSubsystemFragments& frags) {
+		    DQMStageTimers::Scope fill = timeStage(fillStage_);
+		    handler_.fill(frags, summarySet(spillState(event)));
+		  });
+  reportMemory();
+}
+
+void ots::CrvDQM::book_summary(CrvDQMHistoContainer *histos, SpillState spill) {
+  bookSchema(histos, tfs, spill == kOffspill ? CrvDQMHistoContainer::kOffspillSchema :
+	                                       CrvDQMHistoContainer::kOnspillSchema);
+}
+
+void ots::CrvDQM::analyze(art::Event const& event) {
+  ++evtCounter_;
+
+  // fetch and fill
+  DQMStageTimers::Scope dispatch = timeStage(dispatchStage_);
+  dispatcher_.dispatch(event);
+  dispatch.stop();
+
+  publishIfDue();
+}
+
+void ots::CrvDQM::collect_extra(packet_t& packet) {
+  handler_.publish(packet, moduleTag_+"_channels");
+}
+
+DEFINE_ART_MODULE(ots::CrvDQM)
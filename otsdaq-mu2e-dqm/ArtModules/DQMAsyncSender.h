@@ -0,0 +1,175 @@
+#ifndef _DQMAsyncSender_h_
+#define _DQMAsyncSender_h_
+
+#include "otsdaq/Macros/CoutMacros.h"
+#include "otsdaq/NetworkUtilities/TCPPublishServer.h"
+#include "otsdaq-mu2e/ArtModules/HistoSender.hh"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMPublishTiming.h"
+#include "otsdaq-mu2e-dqm/ArtModules/detail/DQMPacket.hh"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistMemory.h"
+
+#include <TBufferFile.h>
+
+#include <TH1.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ots {
+
+  // Histogram sender running off the event loop.
+  //
+  // The modules hand over a packet of detached snapshots (see DQMModule) and
+  // return to the event loop; a worker thread serializes and sends them with
+  // HistoSender. At most maxPending packets wait in the queue: when the
+  // receiver is slower than the publish cadence the oldest packet is dropped,
+  // the newer one supersedes it anyway. With async disabled the packet is
+  // sent in the caller thread, as the modules used to do.
+  //
+  // With a SourceId >= 0 the packets are not sent to Address: they are
+  // served on Port in the DQMPacket format, tagged with the source id and a
+  // sequence number, for a histogram aggregator to subscribe to and merge
+  // with the streams of the other processes.
+  //
+  // Address "null" sends nothing: the packets are serialized in the DQMPacket
+  // format and dropped, so a replay measures the full publish cost without a
+  // receiver. The delivery latency of every packet is recorded in
+  // DQMPublishTiming under the sender label.
+  class DQMAsyncSender {
+  public:
+    typedef std::map<std::string, std::vector<TH1*>> packet_t;
+
+    DQMAsyncSender(const std::string& Address, int Port, bool Async = true, size_t MaxPending = 2, int SourceId = -1) :
+      async_(Async), maxPending_(MaxPending > 0 ? MaxPending : 1), sourceId_(SourceId),
+      label_(Address + ":" + std::to_string(Port)), sequence_(0), buffer_(TBuffer::kWrite), stop_(false), nSent_(0), nDropped_(0), bufferBytes_(0) {
+      if (sourceId_ >= 0) {
+	publisher_.reset(new TCPPublishServer(Port, 4));
+	publisher_->startAccept();
+      } else if (Address != "null") {
+	sender_.reset(new HistoSender(Address, Port));
+      }
+      if (async_) worker_ = std::thread(&DQMAsyncSender::run_, this);
+    };
+
+    // the packets still queued are sent before returning
+    virtual ~DQMAsyncSender(void) {
+      if (!async_) return;
+      {
+	std::lock_guard<std::mutex> lock(mutex_);
+	stop_ = true;
+      }
+      cond_.notify_one();
+      worker_.join();
+    };
+
+    DQMAsyncSender(const DQMAsyncSender&)            = delete;
+    DQMAsyncSender& operator=(const DQMAsyncSender&) = delete;
+
+    // takes ownership of the histograms; they are detached from any ROOT
+    // directory here, in the caller thread
+    void send(packet_t&& Packet) {
+      for (auto& dir : Packet) {
+	for (TH1* h : dir.second) h->SetDirectory(nullptr);
+      }
+      DQMPublishTiming::clock_t::time_point queued = DQMPublishTiming::clock_t::now();
+      if (!async_) {
+	deliver_(Packet);
+	DQMPublishTiming::instance().record(label_, DQMPublishTiming::kDelivery, queued);
+	++nSent_;
+	return;
+      }
+      {
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (queue_.size() >= maxPending_) {
+	  discard_(queue_.front().first);
+	  queue_.pop_front();
+	  ++nDropped_;
+	}
+	queue_.emplace_back(std::move(Packet), queued);
+      }
+      cond_.notify_one();
+    }
+
+    // name of the latency records (default Address:Port), set before the
+    // first send; the module tag for the DQM modules
+    void setLabel(const std::string& Label) { label_ = Label; }
+
+    unsigned long nSent()    const { return nSent_; }
+    unsigned long nDropped() const { return nDropped_; }
+
+    // the snapshots waiting in the queue and the serialization buffer; the
+    // packet being sent is not counted
+    DQMMemoryUsage memoryUsage() {
+      DQMMemoryUsage usage;
+      {
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (auto& packet : queue_) {
+	  for (auto& dir : packet.first) {
+	    for (TH1* h : dir.second) usage.queued += DQMMemoryUsage::histBinBytes(h) + DQMMemoryUsage::histObjectBytes(h);
+	  }
+	}
+      }
+      usage.buffers = bufferBytes_;
+      return usage;
+    }
+
+  private:
+    static void discard_(packet_t& Packet) {
+      for (auto& dir : Packet) {
+	for (TH1* h : dir.second) delete h;
+      }
+    }
+
+    void deliver_(packet_t& Packet) {
+      if (sender_) {
+	sender_->sendHistograms(Packet);
+	return;
+      }
+      writeDQMPacket(buffer_, sourceId_ >= 0 ? sourceId_ : 0, sequence_++, Packet);
+      bufferBytes_ = buffer_.BufferSize();
+      if (publisher_) publisher_->broadcastPacket(buffer_.Buffer(), buffer_.Length());
+      discard_(Packet);
+    }
+
+    void run_() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (true) {
+	cond_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+	if (queue_.empty()) return;  // stop requested and nothing left
+	std::pair<packet_t, DQMPublishTiming::clock_t::time_point> packet = std::move(queue_.front());
+	queue_.pop_front();
+	lock.unlock();
+	deliver_(packet.first);
+	DQMPublishTiming::instance().record(label_, DQMPublishTiming::kDelivery, packet.second);
+	lock.lock();
+	++nSent_;
+      }
+    }
+
+    std::unique_ptr<HistoSender>       sender_;
+    std::unique_ptr<TCPPublishServer>  publisher_;
+    bool                               async_;
+    size_t                             maxPending_;
+    int                                sourceId_;
+    std::string                        label_;
+    uint32_t                           sequence_;   // used by the sending thread only
+    TBufferFile                        buffer_;
+    bool                               stop_;
+    std::atomic<unsigned long>         nSent_, nDropped_;
+    std::atomic<size_t>                bufferBytes_;   // capacity of buffer_
+    std::deque<std::pair<packet_t, DQMPublishTiming::clock_t::time_point>> queue_;   // with the hand-over time
+    std::mutex                         mutex_;
+    std::condition_variable            cond_;
+    std::thread                        worker_;
+  };
+
+} // namespace ots
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef _DQMFragmentDispatcher_h_
+#define _DQMFragmentDispatcher_h_
+
+#include "art/Framework/Principal/Event.h"
+#include "artdaq-core-mu2e/Data/CRVDataDecoder.hh"
+#include "artdaq-core-mu2e/Data/CalorimeterDataDecoder.hh"
+#include "artdaq-core-mu2e/Data/TrackerDataDecoder.hh"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMThreadCPU.h"
+#include "otsdaq-mu2e-dqm/ArtModules/detail/Subsystem.hh"
+
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ots {
+
+  // the DTC data of one event, fetched once and grouped by subsystem; the
+  // pointers refer to the event products and are valid during the event only
+  struct DQMSubsystemFragments {
+    std::vector<const mu2e::TrackerDataDecoder*>      tracker;
+    std::vector<const mu2e::CalorimeterDataDecoder*>  calorimeter;
+    std::vector<const mu2e::CRVDataDecoder*>          crv;
+
+    void clear() {
+      tracker.clear();
+      calorimeter.clear();
+      crv.clear();
+    }
+
+    size_t size(mu2e::detail::Subsystem Subsystem) const {
+      switch (Subsystem) {
+      case mu2e::detail::Subsystem::Tracker:     return tracker.size();
+      case mu2e::detail::Subsystem::Calorimeter: return calorimeter.size();
+      case mu2e::detail::Subsystem::CRV:         return crv.size();
+      }
+      return 0;
+    }
+  };
+
+  // Fans the DTC data of an event out to per-subsystem DQM handlers.
+  //
+  // The handlers are registered once with the subsystem they monitor. For each
+  // event the decoder collections are fetched once (only those of subsystems
+  // with a handler) and every handler with data runs as a task of a TBB
+  // arena, so the tracker and calo DQM of the same event run concurrently.
+  // A handler must only touch its own histograms (and fill buffers): handlers
+  // never share state. Exceptions thrown by a handler reach the caller. With
+  // DQMThreadCPU enabled, the CPU of the handlers run by the other threads of
+  // the arena is credited to the calling thread.
+  class DQMFragmentDispatcher {
+  public:
+    typedef std::function<void(const art::Event&, const DQMSubsystemFragments&)> handler_t;
+
+    // NThreads <= 0: as many as TBB allows
+    DQMFragmentDispatcher(int NThreads = 0) :
+      arena_(NThreads > 0 ? NThreads : int(tbb::task_arena::automatic)){};
+    virtual ~DQMFragmentDispatcher(void){};
+
+    void add(mu2e::detail::Subsystem Subsystem, const std::string& Name, handler_t Handler) {
+      handlers_.push_back(entry_{Subsystem, Name, std::move(Handler)});
+    }
+
+    bool wants(mu2e::detail::Subsystem Subsystem) const {
+      for (const entry_& h : handlers_) {
+	if (h.subsystem == Subsystem) return true;
+      }
+      return false;
+    }
+
+    void dispatch(const art::Event& event) {
+      fragments_.clear();
+      if (wants(mu2e::detail::Subsystem::Tracker)) {
+	for (const auto& handle : event.getMany<std::vector<mu2e::TrackerDataDecoder>>()) {
+	  if (!handle.isValid()) continue;
+	  for (const auto& frag : *handle) fragments_.tracker.push_back(&frag);
+	}
+      }
+      if (wants(mu2e::detail::Subsystem::Calorimeter)) {
+	for (const auto& handle : event.getMany<std::vector<mu2e::CalorimeterDataDecoder>>()) {
+	  if (!handle.isValid()) continue;
+	  for (const auto& frag : *handle) fragments_.calorimeter.push_back(&frag);
+	}
+      }
+      if (wants(mu2e::detail::Subsystem::CRV)) {
+	for (const auto& handle : event.getMany<std::vector<mu2e::CRVDataDecoder>>()) {
+	  if (!handle.isValid()) continue;
+	  for (const auto& frag : *handle) fragments_.crv.push_back(&frag);
+	}
+      }
+
+      // each task writes its own slot: the tasks run by the calling thread
+      // are already in its CPU time
+      bool timeCPU = DQMThreadCPU::enabled();
+      std::thread::id caller = std::this_thread::get_id();
+      offloadedCPU_.assign(handlers_.size(), 0.);
+      arena_.execute([&] {
+	tbb::task_group group;
+	for (size_t i = 0; i < handlers_.size(); ++i) {
+	  if (fragments_.size(handlers_[i].subsystem) == 0) continue;
+	  const handler_t* handler = &handlers_[i].handler;
+	  double*          cpu     = &offloadedCPU_[i];
+	  group.run([&event, handler, cpu, timeCPU, caller, this] {
+	    if (!timeCPU || std::this_thread::get_id() == caller) {
+	      (*handler)(event, fragments_);
+	      return;
+	    }
+	    double start = DQMThreadCPU::now();
+	    (*handler)(event, fragments_);
+	    *cpu = DQMThreadCPU::now() - start;
+	  });
+	}
+	group.wait();
+      });
+      if (timeCPU) {
+	for (double cpu : offloadedCPU_) DQMThreadCPU::addOffloaded(cpu);
+      }
+    }
+
+    size_t nHandlers() const { return handlers_.size(); }
+
+  private:
+    struct entry_ {
+      mu2e::detail::Subsystem subsystem;
+      std::string             name;
+      handler_t               handler;
+    };
+
+    tbb::task_arena        arena_;
+    std::vector<entry_>    handlers_;
+    DQMSubsystemFragments  fragments_;   // reused across events
+    std::vector<double>    offloadedCPU_; // per handler, seconds run on another thread
+  };
+
+} // namespace ots
+
+#endif
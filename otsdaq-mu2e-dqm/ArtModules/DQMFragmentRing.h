@@ -0,0 +1,107 @@
+#ifndef _DQMFragmentRing_h_
+#define _DQMFragmentRing_h_
+
+#include "otsdaq-mu2e-dqm/ArtModules/detail/DataRequestMessage.hh"
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace ots {
+
+  // Raw fragments of the last N events, for on-demand drill-down.
+  //
+  // The art products are gone once the event is processed, so the fragments
+  // are copied, once, into the slot of the event. Each slot keeps one byte
+  // pool that is cleared, not freed, when the slot is reused for a new event:
+  // after the first turn of the ring the copies are plain memcpy's into
+  // memory that is already there. The ring is filled by the event loop and
+  // read by the request server thread, under a mutex held for the copy only.
+  class DQMFragmentRing {
+  public:
+    DQMFragmentRing(size_t NEvents) : slots_(NEvents > 0 ? NEvents : 1), next_(0), nEvents_(0){};
+    virtual ~DQMFragmentRing(void){};
+
+    // start recording an event, in place of the oldest one
+    void beginEvent(uint64_t Event) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      current_ = &slots_[next_];
+      next_    = (next_ + 1) % slots_.size();
+      if (nEvents_ < slots_.size()) ++nEvents_;
+      current_->event = Event;
+      current_->bytes.clear();
+      current_->fragments.clear();
+    }
+
+    void add(uint16_t FragmentId, uint8_t Type, const void* Data, size_t Size) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!current_) return;
+      slot_& slot = *current_;
+      size_t offset = slot.bytes.size();
+      slot.bytes.resize(offset + Size);
+      std::memcpy(slot.bytes.data() + offset, Data, Size);
+      slot.fragments.push_back(fragment_{FragmentId, Type, offset, Size});
+    }
+
+    // append to Out a DataFragmentHeader and the bytes of every buffered
+    // fragment of the events in [First, Last]; returns the number of
+    // fragments. FirstInBuffer/LastInBuffer are the event range held.
+    size_t copy(uint64_t First, uint64_t Last, std::vector<char>& Out,
+		uint64_t& FirstInBuffer, uint64_t& LastInBuffer) const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      size_t nFragments(0);
+      FirstInBuffer = LastInBuffer = 0;
+      for (size_t i=0; i<nEvents_; ++i){
+	// oldest first
+	const slot_& slot = slots_[(next_ + slots_.size() - nEvents_ + i) % slots_.size()];
+	if (i == 0) FirstInBuffer = slot.event;
+	LastInBuffer = slot.event;
+	if (slot.event < First || slot.event > Last) continue;
+	for (const fragment_& frag : slot.fragments) {
+	  DataFragmentHeader header(slot.event, frag.id, frag.type, frag.size);
+	  size_t offset = Out.size();
+	  Out.resize(offset + sizeof(header) + frag.size);
+	  std::memcpy(Out.data() + offset, &header, sizeof(header));
+	  std::memcpy(Out.data() + offset + sizeof(header), slot.bytes.data() + frag.offset, frag.size);
+	  ++nFragments;
+	}
+      }
+      return nFragments;
+    }
+
+    size_t nEvents() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return nEvents_;
+    }
+
+    // memory held by the pools
+    size_t capacityBytes() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      size_t n(0);
+      for (const slot_& slot : slots_) n += slot.bytes.capacity();
+      return n;
+    }
+
+  private:
+    struct fragment_ {
+      uint16_t id;
+      uint8_t  type;
+      size_t   offset, size;
+    };
+
+    struct slot_ {
+      uint64_t               event = 0;
+      std::vector<char>      bytes;
+      std::vector<fragment_> fragments;
+    };
+
+    std::vector<slot_>  slots_;
+    slot_*              current_ = nullptr;
+    size_t              next_, nEvents_;
+    mutable std::mutex  mutex_;
+  };
+
+} // namespace ots
+
+#endif
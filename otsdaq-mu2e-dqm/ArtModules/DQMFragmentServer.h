@@ -0,0 +1,127 @@
+#ifndef _DQMFragmentServer_h_
+#define _DQMFragmentServer_h_
+
+#include "otsdaq-mu2e-dqm/ArtModules/DQMFragmentRing.h"
+#include "otsdaq-mu2e-dqm/ArtModules/detail/DataRequestMessage.hh"
+#include "otsdaq/Macros/CoutMacros.h"
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace ots {
+
+  // Answers DataRequestMessage queries from a DQMFragmentRing.
+  //
+  // A thread listens on Port; each connection sends one DataRequestMessage
+  // and gets a DataResponseHeader (number of fragments and the event range
+  // held by the ring) followed by the fragments, then the connection is
+  // closed. Requests are served one at a time, off the event loop: the ring
+  // is only locked while the fragments are copied to the response buffer.
+  class DQMFragmentServer {
+  public:
+    DQMFragmentServer(const DQMFragmentRing& Ring, int Port) :
+      ring_(Ring), fd_(-1), stop_(false), nRequests_(0) {
+      fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+      int yes = 1;
+      ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+      sockaddr_in addr{};
+      addr.sin_family      = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_ANY);
+      addr.sin_port        = htons(Port);
+      if (fd_ < 0 || ::bind(fd_, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(fd_, 4) < 0) {
+	__MOUT_ERR__ << "[DQMFragmentServer] cannot listen on port " << Port << ", raw requests disabled" << std::endl;
+	if (fd_ >= 0) ::close(fd_);
+	fd_ = -1;
+	return;
+      }
+      worker_ = std::thread(&DQMFragmentServer::run_, this);
+    };
+
+    virtual ~DQMFragmentServer(void) {
+      stop_ = true;
+      if (worker_.joinable()) worker_.join();
+      if (fd_ >= 0) ::close(fd_);
+    };
+
+    DQMFragmentServer(const DQMFragmentServer&)            = delete;
+    DQMFragmentServer& operator=(const DQMFragmentServer&) = delete;
+
+    unsigned long nRequests() const { return nRequests_; }
+
+  private:
+    void run_() {
+      std::vector<char> response;  // reused across requests
+      pollfd pfd{fd_, POLLIN, 0};
+      while (!stop_) {
+	// wake up regularly to check for stop
+	if (::poll(&pfd, 1, 200) <= 0) continue;
+	int client = ::accept(fd_, nullptr, nullptr);
+	if (client < 0) continue;
+	serve_(client, response);
+	::close(client);
+      }
+    }
+
+    void serve_(int client, std::vector<char>& response) {
+      // a stuck client must not block the other requests forever
+      timeval timeout{2, 0};
+      ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+      ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+      DataRequestMessage request;
+      if (!readAll_(client, (char*)&request, sizeof(request)) || !request.isValid()) return;
+      ++nRequests_;
+
+      response.resize(sizeof(DataResponseHeader));
+      uint64_t first(0), last(0);
+      size_t   n = ring_.copy(request.eventNumber, request.lastEvent(), response, first, last);
+      DataResponseHeader header(n, first, last);
+      std::memcpy(response.data(), &header, sizeof(header));
+      writeAll_(client, response.data(), response.size());
+    }
+
+    static bool readAll_(int fd, char* data, size_t size) {
+      while (size > 0) {
+	ssize_t n = ::recv(fd, data, size, 0);
+	if (n <= 0) {
+	  if (n < 0 && errno == EINTR) continue;
+	  return false;
+	}
+	data += n;
+	size -= n;
+      }
+      return true;
+    }
+
+    static bool writeAll_(int fd, const char* data, size_t size) {
+      while (size > 0) {
+	ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+	if (n <= 0) {
+	  if (n < 0 && errno == EINTR) continue;
+	  return false;
+	}
+	data += n;
+	size -= n;
+      }
+      return true;
+    }
+
+    const DQMFragmentRing&      ring_;
+    int                         fd_;
+    std::atomic<bool>           stop_;
+    std::atomic<unsigned long>  nRequests_;
+    std::thread                 worker_;
+  };
+
+} // namespace ots
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef _DQMHistSchema_h_
+#define _DQMHistSchema_h_
+
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileService.h"
+#include "cetlib_except/exception.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistSpec.h"
+
+#include <cstddef>
+
+namespace ots {
+
+  // book a schema in a XxxDQMHistoContainer, in schema order, so the position
+  // of a histogram in the container (and its fill-buffer id) is its enum
+  // value. Booking into a set that already holds histograms would shift the
+  // ids: this is refused at startup.
+  template <typename Container, size_t N>
+  void bookSchema(Container* histos, art::ServiceHandle<art::TFileService> tfs, const DQMHistSpec (&Schema)[N]) {
+    if (!histos->histograms.empty()) {
+      throw cet::exception("DQMHistSchema") << "schema booked in a non-empty set (" << histos->dirName << ")";
+    }
+    for (const DQMHistSpec& spec : Schema) {
+      histos->BookSummaryHistos(tfs, spec.title, spec.nBins, spec.min, spec.max);
+    }
+  }
+
+} // namespace ots
+
+#endif
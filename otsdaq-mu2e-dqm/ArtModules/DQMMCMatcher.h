@@ -0,0 +1,85 @@
+#ifndef _DQMMCMatcher_h_
+#define _DQMMCMatcher_h_
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ots {
+
+  // Dominant SimParticle finder.
+  //
+  // The hits of a reconstructed object are added one by one with the id of
+  // the SimParticle that made them; each id is counted in a hash, so finding
+  // the particle with most hits is linear in the number of hits (the old
+  // TriggerRates code re-counted the whole list for every hit). Ties go to the
+  // particle with the hit closest to z=0, the same choice the old code made.
+  // The scratch storage is kept between objects and events: after the first
+  // few events the matcher does not allocate.
+  class DQMMCMatcher {
+  public:
+    struct match_ {
+      uint64_t simId;
+      int      nHits;     //hits of the dominant particle
+      int      nTotal;    //hits added
+      size_t   hitIndex;  //caller index of its hit closest to z=0
+      double   purity() const { return nTotal > 0 ? double(nHits)/nTotal : 0.; }
+    };
+
+    DQMMCMatcher(){};
+    virtual ~DQMMCMatcher(void){};
+
+    // start a new object
+    void clear() {
+      slots_.clear();
+      candidates_.clear();
+      nTotal_ = 0;
+    }
+
+    void add(uint64_t simId, float z, size_t hitIndex) {
+      ++nTotal_;
+      auto it = slots_.find(simId);
+      if (it == slots_.end()) {
+	slots_.emplace(simId, candidates_.size());
+	candidates_.push_back(candidate_{simId, 1, std::fabs(z), hitIndex});
+	return;
+      }
+      candidate_& c = candidates_[it->second];
+      ++c.count;
+      if (std::fabs(z) < c.minAbsZ) {
+	c.minAbsZ  = std::fabs(z);
+	c.hitIndex = hitIndex;
+      }
+    }
+
+    // false if no hit was added
+    bool dominant(match_& Match) const {
+      if (candidates_.empty()) return false;
+      const candidate_* best = &candidates_.front();
+      for (const candidate_& c : candidates_) {
+	if (c.count > best->count || (c.count == best->count && c.minAbsZ < best->minAbsZ)) best = &c;
+      }
+      Match.simId    = best->simId;
+      Match.nHits    = best->count;
+      Match.nTotal   = nTotal_;
+      Match.hitIndex = best->hitIndex;
+      return true;
+    }
+
+  private:
+    struct candidate_ {
+      uint64_t simId;
+      int      count;
+      float    minAbsZ;
+      size_t   hitIndex;
+    };
+
+    int                                    nTotal_ = 0;
+    std::unordered_map<uint64_t, size_t>   slots_;       //sim id -> candidates_
+    std::vector<candidate_>                candidates_;
+  };
+
+} // namespace ots
+
+#endif
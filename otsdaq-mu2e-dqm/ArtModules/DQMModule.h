@@ -0,0 +1,379 @@
+#ifndef _DQMModule_h_
+#define _DQMModule_h_
+
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileService.h"
+#include "artdaq-core/Data/Fragment.hh"
+#include "artdaq/DAQdata/Globals.hh"
+#include "canvas/Utilities/InputTag.h"
+#include "fhiclcpp/types/Atom.h"
+#include "fhiclcpp/types/Sequence.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMAsyncSender.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMFragmentRing.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMFragmentServer.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMPublishManifest.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMPublishTiming.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMSpillState.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistMemory.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMStageTimers.h"
+#include "otsdaq/Macros/CoutMacros.h"
+#include "otsdaq/MessageFacility/MessageFacility.h"
+
+#include <TH1.h>
+#include <TH1F.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace ots {
+
+  // parameters shared by all the DQM modules, included in their Config as a
+  // fhicl::TableFragment so the fcl files keep the same flat layout
+  struct DQMModuleConfig {
+    using Name = fhicl::Name;
+    using Comment = fhicl::Comment;
+    fhicl::Atom<int>             port           { Name("port"),           Comment("This parameter sets the port where the histogram will be sent") };
+    fhicl::Atom<std::string>     address        { Name("address"),        Comment("This paramter sets the IP address where the histogram will be sent (\"null\": serialized and dropped)") };
+    fhicl::Atom<std::string>     moduleTag      { Name("moduleTag"),      Comment("Module tag name") };
+    fhicl::Sequence<std::string> histType       { Name("histType"),       Comment("This parameter determines which quantity is histogrammed") };
+    fhicl::Atom<int>             freqDQM        { Name("freqDQM"),        Comment("Frequency for sending histograms to the data-receiver") };
+    fhicl::Atom<int>             diag           { Name("diagLevel"),      Comment("Diagnostic level"), 0 };
+    fhicl::Atom<art::InputTag>   ewmTag         { Name("ewmTag"),         Comment("EventWindowMarker used to classify onspill/offspill events"), art::InputTag("EWMProducer") };
+    fhicl::Atom<bool>            asyncSend      { Name("asyncSend"),      Comment("Send the histograms from a separate thread"), true };
+    fhicl::Atom<int>             sourceId       { Name("sourceId"),       Comment("If >= 0, serve the histograms on port for a DQM aggregator, tagged with this id"), -1 };
+    fhicl::Atom<int>             rawRingEvents  { Name("rawRingEvents"),  Comment("Keep the raw fragments of the last N events for drill-down (0: disabled)"), 0 };
+    fhicl::Atom<int>             rawRequestPort { Name("rawRequestPort"), Comment("Port answering DataRequestMessage queries on the raw fragments (0: disabled)"), 0 };
+    fhicl::Atom<bool>            stageTiming    { Name("stageTiming"),    Comment("Time the stages of analyze() and the publish; their percentiles are published as histograms and metrics"), false };
+    fhicl::Atom<int>             memoryReportFreq { Name("memoryReportFreq"), Comment("Publishes between two memory checks (metrics and soft limit; 0: disabled)"), 10 };
+    fhicl::Atom<double>          memorySoftLimit  { Name("memorySoftLimit"),  Comment("Memory [MB] above which the largest sets are degraded to coarser binning, then to stats only (0: no limit)"), 0. };
+  };
+
+  // Common engine of the DQM modules.
+  //
+  // Container is the module's histogram set (a XxxDQMHistoContainer: a
+  // `histograms` vector of `_Hist` pointers and a DQMFillBuffer). The base owns
+  // the sets, books one per requested spill state ("Onspill"/"Offspill" in
+  // histType, a single "summary" set otherwise) through the module's
+  // book_summary, picks the set of each event, and publishes every freqDQM
+  // events: each histogram is cloned into a detached snapshot and reset, and
+  // the packet goes to a DQMAsyncSender, so the event loop never waits for
+  // the network. The sender directory of every histogram is fixed at booking
+  // time in the publish manifest. Extra histograms whose content is computed
+  // at publish time (crystal maps, correlations, ...) are added to the packet
+  // by overriding collect_extra. With rawRingEvents > 0 the modules that
+  // call recordRaw keep the raw fragments of the last events, served on
+  // rawRequestPort. With stageTiming the stages timed by the module and the
+  // publish are summarized at each publish (DQMStageTimers), in a
+  // moduleTag_timing directory of the packet and as artdaq metrics. The
+  // memory owned by the module (DQMMemoryUsage: bins, ROOT objects, buffers,
+  // queued snapshots) is summarized per set by reportMemory, which the
+  // modules call at the end of beginJob, and checked every memoryReportFreq
+  // publishes: it is sent as metrics and, above memorySoftLimit, the largest
+  // sets are degraded one step at a time (DQMDegradeLevel).
+  template <typename Container>
+  class DQMModule : public art::EDAnalyzer {
+  public:
+    typedef DQMAsyncSender::packet_t packet_t;
+
+    template <typename Table>
+    DQMModule(const Table& conf, const DQMModuleConfig& dqm, const std::string& SetPrefix) :
+      art::EDAnalyzer(conf), port_(dqm.port()), address_(dqm.address()),
+      moduleTag_(dqm.moduleTag()), histType_(dqm.histType()), freqDQM_(dqm.freqDQM()),
+      diagLevel_(dqm.diag()), evtCounter_(0), ewmTag_(dqm.ewmTag()), setPrefix_(SetPrefix),
+      histTypes_(histType_.begin(), histType_.end()),
+      sender_(address_, port_, dqm.asyncSend(), 2, dqm.sourceId()), summary_histos_{NULL, NULL},
+      timeStages_(dqm.stageTiming()), memoryReportFreq_(dqm.memoryReportFreq()),
+      memorySoftLimit_(size_t(dqm.memorySoftLimit()*1024*1024)), nPublishes_(0) {
+      if (freqDQM_ <= 0) freqDQM_ = 1;
+      sender_.setLabel(moduleTag_);
+      publishStage_ = timers_.addStage("publish");
+      if (dqm.rawRingEvents() > 0) {
+	rawRing_.reset(new DQMFragmentRing(dqm.rawRingEvents()));
+	if (dqm.rawRequestPort() > 0) rawServer_.reset(new DQMFragmentServer(*rawRing_, dqm.rawRequestPort()));
+      }
+      if (diagLevel_ > 0 && !histType_.empty()) {
+	__MOUT__ << "[" << setPrefix_ << "DQM] DQM for " << histType_[0] << std::endl;
+      }
+    }
+
+    virtual ~DQMModule(void){};
+
+  protected:
+    // book the histograms of one set
+    virtual void book_summary(Container* histos, SpillState spill) = 0;
+
+    // called for each booked set; Suffix is "" for the single summary set,
+    // "_onspill"/"_offspill" otherwise
+    virtual void book_set(SpillState spill, const std::string& Suffix) {}
+
+    // add the module-specific histograms to the packet
+    virtual void collect_extra(packet_t& packet) {}
+
+    // memory of the module-specific content (the counters and histograms
+    // behind collect_extra), which is not degraded
+    virtual DQMMemoryUsage memory_extra() const { return DQMMemoryUsage(); }
+
+    // the histType entries are parsed once, in the constructor
+    bool hasHistType(const std::string& name) const { return histTypes_.count(name) > 0; }
+
+    bool splitSpills() const { return hasHistType("Onspill") || hasHistType("Offspill"); }
+
+    void checkHistTypes(std::initializer_list<const char*> known) const {
+      for (const std::string& name : histType_) {
+	if (std::find_if(known.begin(), known.end(), [&](const char* k) { return name == k; }) == known.end()) {
+	  __MOUT_ERR__ << "Unrecognized histogram type: " << name << std::endl;
+	}
+      }
+    }
+
+    // the module takes ownership of histos
+    Container* addSet(Container* histos) {
+      owned_.emplace_back(histos);
+      return histos;
+    }
+
+    // publish the histograms booked so far in the set under refName
+    void manifestSet(const std::string& refName, const Container* histos) {
+      size_t key = manifest_.key(refName);
+      for (auto& h : histos->histograms) manifest_.add(key, h._Hist);
+    }
+
+    DQMPublishManifest& manifest() { return manifest_; }
+
+    void bookSpillSets() {
+      if (!splitSpills()) {
+	//no spill split requested: a single set collects all the events
+	Container* histos = addSet(new Container(setPrefix_+"_summary"));
+	book_summary(histos, kOnspill);
+	manifestSet(moduleTag_+"_summary", histos);
+	summary_histos_[kOnspill]  = histos;
+	summary_histos_[kOffspill] = histos;
+	book_set(kOnspill, "");
+	return;
+      }
+
+      for (int i=0; i<kNSpillStates; ++i){
+	SpillState  spill = SpillState(i);
+	std::string name  = spillStateName(spill);
+	if ( (spill == kOnspill  && !hasHistType("Onspill")) ||
+	     (spill == kOffspill && !hasHistType("Offspill")) ) continue;
+	Container* histos = addSet(new Container(setPrefix_+"_"+name));
+	book_summary(histos, spill);
+	manifestSet(moduleTag_+"_"+name, histos);
+	summary_histos_[spill] = histos;
+	book_set(spill, "_"+name);
+      }
+    }
+
+    // copy the raw fragments of the event to the drill-down ring
+    void recordRaw(const art::Event& event) {
+      if (!rawRing_) return;
+      rawRing_->beginEvent(eventWindowTag(event));
+      for (const auto& handle : event.getMany<artdaq::Fragments>()) {
+	if (!handle.isValid()) continue;
+	for (const artdaq::Fragment& frag : *handle) {
+	  rawRing_->add(frag.fragmentID(), frag.type(), frag.headerBeginBytes(), frag.sizeBytes());
+	}
+      }
+    }
+
+    // stage timing: the modules register their stages (fetch, fill, ...) at
+    // construction and time them with a scope, which does nothing unless
+    // stageTiming is set
+    size_t addStage(const std::string& Name) { return timers_.addStage(Name); }
+
+    DQMStageTimers::Scope timeStage(size_t Stage) {
+      return timeStages_ ? timers_.time(Stage) : DQMStageTimers::Scope();
+    }
+
+    SpillState spillState(const art::Event& event) const { return findSpillState(event, ewmTag_); }
+
+    // NULL if the spill state of the event is not monitored
+    Container* summarySet(SpillState spill) const { return summary_histos_[spill]; }
+
+    // detached copy of h, which is then reset
+    static TH1* snapshot(TH1* h) {
+      TH1* copy = (TH1*)h->Clone();
+      copy->SetDirectory(nullptr);
+      h->Reset();
+      return copy;
+    }
+
+    void publishIfDue() {
+      if (evtCounter_ % freqDQM_ != 0) return;
+      publish();
+    }
+
+    //send a packet AND reset the histograms
+    void publish() {
+      DQMPublishTiming::clock_t::time_point start = DQMPublishTiming::clock_t::now();
+      DQMStageTimers::Scope                 scope = timeStage(publishStage_);
+      packet_t packet;
+      if (timeStages_) collect_timing_(packet);
+      manifest_.collect(packet, snapshot);
+      collect_extra(packet);
+
+      if (diagLevel_ > 0) {
+	size_t nHists(0);
+	for (auto& dir : packet) nHists += dir.second.size();
+	__MOUT__ << "[" << setPrefix_ << "DQM::publish] " << nHists << " histograms in "
+		 << packet.size() << " directories, " << sender_.nDropped() << " packets dropped so far" << std::endl;
+      }
+      sender_.send(std::move(packet));
+      DQMPublishTiming::instance().record(moduleTag_, DQMPublishTiming::kSnapshot, start);
+      if (memoryReportFreq_ > 0 && ++nPublishes_ % memoryReportFreq_ == 0) checkMemory_(false);
+    }
+
+    // print the memory summary, send the metrics and apply the soft limit
+    void reportMemory() { checkMemory_(true); }
+
+    int                       port_;
+    std::string               address_;
+    std::string               moduleTag_;
+    std::vector<std::string>  histType_;
+    int                       freqDQM_, diagLevel_, evtCounter_;
+    art::InputTag             ewmTag_;
+    std::string               setPrefix_;
+    art::ServiceHandle<art::TFileService> tfs;
+
+  private:
+    // percentiles of the stages since the previous publish, in us: one
+    // histogram per percentile with a bin per stage, and one metric each
+    void collect_timing_(packet_t& packet) {
+      static const char* names[kNTimingHists] = {"p50", "p90", "p99", "max"};
+      std::vector<DQMStageTimers::summary_t> interval = timers_.interval();
+      if (!timing_hists_[0]) {
+	for (int i = 0; i < kNTimingHists; ++i) {
+	  std::string name = setPrefix_ + "_timing_" + names[i];
+	  timing_hists_[i].reset(new TH1F(name.c_str(), (setPrefix_ + " stage timing, " + names[i] + "; ; Time [us]").c_str(),
+					  timers_.nStages(), 0, timers_.nStages()));
+	  timing_hists_[i]->SetDirectory(nullptr);
+	  for (size_t st = 0; st < timers_.nStages(); ++st) timing_hists_[i]->GetXaxis()->SetBinLabel(st + 1, timers_.stageName(st).c_str());
+	}
+      }
+      std::vector<TH1*>& dir = packet[moduleTag_ + "_timing"];
+      for (int i = 0; i < kNTimingHists; ++i) {
+	for (size_t st = 0; st < interval.size(); ++st) {
+	  const DQMStageTimers::summary_t& s = interval[st];
+	  double us = 1e-3*(i == 0 ? s.p50 : i == 1 ? s.p90 : i == 2 ? s.p99 : s.max);
+	  timing_hists_[i]->SetBinContent(st + 1, us);
+	  if (metricMan && s.n > 0) {
+	    metricMan->sendMetric(moduleTag_ + ".Timing." + timers_.stageName(st) + "." + names[i], us, "us", 3, artdaq::MetricMode::LastPoint);
+	  }
+	}
+	TH1* copy = (TH1*)timing_hists_[i]->Clone();
+	copy->SetDirectory(nullptr);
+	dir.push_back(copy);
+      }
+    }
+
+    enum { kNTimingHists = 4 };
+
+    // the histograms of each sender directory, the rest in "extra", "buffers"
+    // (fill buffers, serialization) and "queued" (snapshots in the sender)
+    DQMMemoryUsage memoryUsage_(std::vector<size_t>& setBytes) const {
+      DQMMemoryUsage usage;
+      setBytes.assign(manifest_.nKeys(), 0);
+      for (size_t k = 0; k < manifest_.nKeys(); ++k) {
+	DQMMemoryUsage set;
+	for (const TH1* h : manifest_.group(k)) set.addHist(h);
+	setBytes[k] = set.total();
+	usage      += set;
+      }
+      for (auto& histos : owned_) usage.buffers += histos->fillBuffer.capacityBytes();
+      return usage;
+    }
+
+    void checkMemory_(bool print) {
+      std::vector<size_t> setBytes;
+      DQMMemoryUsage usage  = memoryUsage_(setBytes);
+      DQMMemoryUsage extra  = memory_extra();
+      DQMMemoryUsage sender = sender_.memoryUsage();
+      usage += extra;
+      usage += sender;
+
+      if (print) {
+	const double MB = 1./(1024*1024);
+	__MOUT__ << "[" << setPrefix_ << "DQM::memory] " << usage.total()*MB << " MB: bins " << usage.bins*MB
+		 << " MB, objects " << usage.objects*MB << " MB, buffers " << usage.buffers*MB << " MB, queued "
+		 << usage.queued*MB << " MB, module-specific " << extra.total()*MB << " MB" << std::endl;
+	std::vector<size_t> order(setBytes.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return setBytes[a] > setBytes[b]; });
+	for (size_t i = 0; i < order.size() && i < kNReportedSets; ++i) {
+	  __MOUT__ << "[" << setPrefix_ << "DQM::memory]   " << manifest_.dir(order[i]) << ": " << manifest_.group(order[i]).size()
+		   << " histograms, " << setBytes[order[i]]*MB << " MB" << std::endl;
+	}
+      }
+      if (metricMan) {
+	std::string name = moduleTag_ + ".Memory.";
+	metricMan->sendMetric(name + "Bins"   , double(usage.bins)   , "bytes", 2, artdaq::MetricMode::LastPoint);
+	metricMan->sendMetric(name + "Objects", double(usage.objects), "bytes", 2, artdaq::MetricMode::LastPoint);
+	metricMan->sendMetric(name + "Buffers", double(usage.buffers), "bytes", 2, artdaq::MetricMode::LastPoint);
+	metricMan->sendMetric(name + "Queued" , double(usage.queued) , "bytes", 2, artdaq::MetricMode::LastPoint);
+	metricMan->sendMetric(name + "Total"  , double(usage.total()), "bytes", 2, artdaq::MetricMode::LastPoint);
+      }
+      if (memorySoftLimit_ > 0 && usage.total() > memorySoftLimit_) degrade_(setBytes, usage.total());
+    }
+
+    // one step for the largest set that can still be degraded, until the
+    // module is under the limit or every set is stats only
+    void degrade_(std::vector<size_t>& setBytes, size_t total) {
+      degradeLevels_.resize(setBytes.size(), kFullBinning);
+      while (total > memorySoftLimit_) {
+	size_t worst = setBytes.size();
+	for (size_t k = 0; k < setBytes.size(); ++k) {
+	  if (degradeLevels_[k] == kStatsOnly) continue;
+	  if (worst == setBytes.size() || setBytes[k] > setBytes[worst]) worst = k;
+	}
+	if (worst == setBytes.size()) break;
+
+	DQMDegradeLevel level = DQMDegradeLevel(degradeLevels_[worst] + 1);
+	DQMMemoryUsage  set;
+	for (TH1* h : manifest_.group(worst)) {
+	  degradeHist(h, level);
+	  set.addHist(h);
+	}
+	degradeLevels_[worst] = level;
+	mf::LogWarning(setPrefix_ + "DQM") << moduleTag_ << ": " << total/(1024*1024) << " MB above the soft limit of "
+					   << memorySoftLimit_/(1024*1024) << " MB, " << manifest_.dir(worst) << " ("
+					   << setBytes[worst]/1024 << " kB) degraded to " << degradeLevelName(level);
+	total           -= setBytes[worst] - std::min(setBytes[worst], set.total());
+	setBytes[worst]  = set.total();
+      }
+      if (metricMan) {
+	size_t nDegraded = std::count_if(degradeLevels_.begin(), degradeLevels_.end(), [](int l) { return l != kFullBinning; });
+	metricMan->sendMetric(moduleTag_ + ".Memory.DegradedSets", double(nDegraded), "sets", 2, artdaq::MetricMode::LastPoint);
+      }
+    }
+
+    enum { kNReportedSets = 5 };
+
+    std::unordered_set<std::string>                       histTypes_;
+    DQMAsyncSender                                        sender_;
+    std::vector<std::unique_ptr<Container>>               owned_;
+    Container*                                            summary_histos_[kNSpillStates];  // indexed by SpillState, NULL if not booked
+    DQMPublishManifest                                    manifest_;
+    std::unique_ptr<DQMFragmentRing>                      rawRing_;
+    std::unique_ptr<DQMFragmentServer>                    rawServer_;      // destroyed before the ring
+    bool                                                  timeStages_;
+    DQMStageTimers                                        timers_;
+    size_t                                                publishStage_;
+    std::unique_ptr<TH1F>                                 timing_hists_[kNTimingHists];
+    int                                                   memoryReportFreq_;
+    size_t                                                memorySoftLimit_;   // bytes, 0: none
+    unsigned long                                         nPublishes_;
+    std::vector<int>                                      degradeLevels_;     // DQMDegradeLevel per manifest key
+  };
+
+} // namespace ots
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef _DQMPeriodicPublisher_h_
+#define _DQMPeriodicPublisher_h_
+
+#include "artdaq/DAQdata/Globals.hh"
+#include "cetlib_except/exception.h"
+#include "otsdaq/NetworkUtilities/TCPPublishServer.h"
+
+#include <TBufferFile.h>
+#include <TList.h>
+#include <TObject.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace ots {
+
+  // Periodic publisher for the TCPPublishServer-based modules.
+  //
+  // The modules call isDue() once per event; when the event or the time
+  // cadence is reached they hand over their whole histogram set, which is
+  // serialized into a buffer reused across packets and broadcast. The number
+  // of broadcast bytes is reported to the artdaq metric manager as a rate.
+  //
+  // Two packet formats (fcl packetFormat):
+  //   "objects"  one packet per histogram, each a single serialized TH1, as
+  //              the modules sent before: a receiver reading every packet
+  //              with ReadObject(TH1::Class()) keeps working (default)
+  //   "list"     the whole set in one packet, a TList of the histograms: one
+  //              broadcast per publish; the receiver reads it with
+  //              ReadObject(TList::Class()) and iterates it
+  class DQMPeriodicPublisher {
+  public:
+    enum Format { kObjects = 0, kList };
+
+    static Format format(const std::string& Name) {
+      if (Name == "objects") return kObjects;
+      if (Name == "list")    return kList;
+      throw cet::exception("DQMPeriodicPublisher") << "unknown packetFormat \"" << Name << "\" (objects, list)";
+    }
+
+    // a cadence <= 0 is disabled; with both disabled, every event is published
+    DQMPeriodicPublisher(TCPPublishServer* Server, std::string MetricName,
+			 int EveryNEvents, double EverySeconds, Format PacketFormat = kObjects) :
+      server_(Server), metricName_(MetricName), everyNEvents_(EveryNEvents),
+      everySeconds_(EverySeconds), format_(PacketFormat), nEvents_(0), nPackets_(0), nBytes_(0),
+      buffer_(TBuffer::kWrite), last_(std::chrono::steady_clock::now()){};
+    virtual ~DQMPeriodicPublisher(void){};
+
+    bool isDue() {
+      ++nEvents_;
+      if (everyNEvents_ <= 0 && everySeconds_ <= 0) return true;
+      if (everyNEvents_ > 0 && nEvents_ >= (unsigned long)everyNEvents_) return true;
+      if (everySeconds_ > 0) {
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - last_;
+	if (elapsed.count() >= everySeconds_) return true;
+      }
+      return false;
+    }
+
+    // serialize and broadcast the set; the objects are not copied
+    void publish(const std::vector<TObject*>& objects) {
+      nEvents_ = 0;
+      last_    = std::chrono::steady_clock::now();
+      if (objects.empty()) return;
+
+      size_t bytes(0);
+      if (format_ == kList) {
+	TList list;
+	list.SetOwner(kFALSE);
+	for (TObject* obj : objects) list.Add(obj);
+	bytes += broadcast_(&list);
+      } else {
+	for (TObject* obj : objects) bytes += broadcast_(obj);
+      }
+
+      nBytes_ += bytes;
+      if (metricMan) {
+	metricMan->sendMetric(metricName_ + ".BroadcastBytes", double(bytes), "bytes/s", 2, artdaq::MetricMode::Rate);
+      }
+    }
+
+    unsigned long nPackets() const { return nPackets_; }
+    unsigned long nBytes()   const { return nBytes_; }
+
+  private:
+    size_t broadcast_(const TObject* obj) {
+      buffer_.SetBufferOffset(0);
+      buffer_.ResetMap();
+      buffer_.WriteObject(obj);
+      server_->broadcastPacket(buffer_.Buffer(), buffer_.Length());
+      ++nPackets_;
+      return buffer_.Length();
+    }
+
+    TCPPublishServer*                      server_;
+    std::string                            metricName_;
+    int                                    everyNEvents_;
+    double                                 everySeconds_;
+    Format                                 format_;
+    unsigned long                          nEvents_, nPackets_, nBytes_;
+    TBufferFile                            buffer_;
+    std::chrono::steady_clock::time_point  last_;
+  };
+
+} // namespace ots
+
+#endif
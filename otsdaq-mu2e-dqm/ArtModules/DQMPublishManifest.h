@@ -0,0 +1,67 @@
+#ifndef _DQMPublishManifest_h_
+#define _DQMPublishManifest_h_
+
+#include <TH1.h>
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ots {
+
+  // Sender-directory layout of a module, computed at booking time.
+  //
+  // Each sender directory ("<moduleTag>_pedestals/plane_3/panel_2", ...) is
+  // interned once and gets an integer key; the histograms are stored grouped
+  // by key, in booking order. Publishing walks the groups: one packet entry
+  // per directory, no per-histogram string is built.
+  class DQMPublishManifest {
+  public:
+    DQMPublishManifest(){};
+    virtual ~DQMPublishManifest(void){};
+
+    // key of a sender directory, added if new
+    size_t key(const std::string& Dir) {
+      auto it = index_.find(Dir);
+      if (it != index_.end()) return it->second;
+      index_.emplace(Dir, keys_.size());
+      keys_.push_back(Dir);
+      groups_.emplace_back();
+      return keys_.size() - 1;
+    }
+
+    void add(size_t Key, TH1* Hist) {
+      groups_[Key].push_back(Hist);
+      ++nHists_;
+    }
+
+    void add(const std::string& Dir, TH1* Hist) { add(key(Dir), Hist); }
+
+    // append Snapshot(h) of every histogram to its directory in the packet
+    template <typename Snapshot>
+    void collect(std::map<std::string, std::vector<TH1*>>& Packet, Snapshot snapshot) const {
+      for (size_t k=0; k<keys_.size(); ++k){
+	if (groups_[k].empty()) continue;
+	std::vector<TH1*>& out = Packet[keys_[k]];
+	out.reserve(out.size() + groups_[k].size());
+	for (TH1* h : groups_[k]) out.push_back(snapshot(h));
+      }
+    }
+
+    size_t nKeys()  const { return keys_.size(); }
+    size_t nHists() const { return nHists_; }
+
+    const std::string&       dir(size_t Key)   const { return keys_[Key]; }
+    const std::vector<TH1*>& group(size_t Key) const { return groups_[Key]; }
+
+  private:
+    std::vector<std::string>                 keys_;
+    std::unordered_map<std::string, size_t>  index_;
+    std::vector<std::vector<TH1*>>           groups_;
+    size_t                                   nHists_ = 0;
+  };
+
+} // namespace ots
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef _DQMPublishTiming_h_
+#define _DQMPublishTiming_h_
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ots {
+
+  // Process-wide record of the publish latencies of the DQM senders.
+  //
+  // Two stages per sender label (the module tag): the snapshot, taken in the
+  // event loop (clone + reset + hand-over to the sender), and the delivery,
+  // from the hand-over until the packet is sent. Publishes happen every
+  // freqDQM events, so recording takes a lock and keeps every sample (up to
+  // kMaxSamples per label and stage). Read by the replay report
+  // (DQMReplayMonitor service) at the end of the job.
+  class DQMPublishTiming {
+  public:
+    enum Stage { kSnapshot = 0, kDelivery, kNStages };
+    enum { kMaxSamples = 1 << 20 };
+
+    typedef std::chrono::steady_clock clock_t;
+
+    struct summary_t {
+      size_t n    = 0;
+      double p50  = 0, p90 = 0, p99 = 0, max = 0;   // seconds
+    };
+
+    // one instance per process, shared by all the modules
+    static DQMPublishTiming& instance() {
+      static DQMPublishTiming timing;
+      return timing;
+    }
+
+    static const char* stageName(Stage s) {
+      static const char* names[kNStages] = {"snapshot", "delivery"};
+      return names[s];
+    }
+
+    void record(const std::string& Label, Stage stage, double Seconds) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::vector<float>& samples = samples_[Label][stage];
+      if (samples.size() < kMaxSamples) samples.push_back(Seconds);
+    }
+
+    void record(const std::string& Label, Stage stage, clock_t::time_point Since) {
+      record(Label, stage, std::chrono::duration<double>(clock_t::now() - Since).count());
+    }
+
+    std::vector<std::string> labels() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::vector<std::string> names;
+      for (auto& s : samples_) names.push_back(s.first);
+      return names;
+    }
+
+    summary_t summary(const std::string& Label, Stage stage) const {
+      std::vector<float> samples;
+      {
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto it = samples_.find(Label);
+	if (it == samples_.end()) return summary_t();
+	samples = it->second[stage];
+      }
+      summary_t s;
+      s.n = samples.size();
+      if (s.n == 0) return s;
+      std::sort(samples.begin(), samples.end());
+      auto at = [&](double q) { return samples[std::min(s.n - 1, size_t(q*s.n))]; };
+      s.p50 = at(0.50);
+      s.p90 = at(0.90);
+      s.p99 = at(0.99);
+      s.max = samples.back();
+      return s;
+    }
+
+  private:
+    DQMPublishTiming(){};
+
+    mutable std::mutex                                               mutex_;
+    std::map<std::string, std::array<std::vector<float>, kNStages>> samples_;
+  };
+
+} // namespace ots
+
+#endif
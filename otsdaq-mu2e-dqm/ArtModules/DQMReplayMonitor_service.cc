@@ -0,0 +1,189 @@
+// This service reports the throughput of a DQM replay (fcl/DQMReplay.fcl):
+// events/s, CPU and wall time per module, publish latency percentiles (from
+// DQMPublishTiming) and peak RSS, at the end of the job and optionally as a
+// JSON file. The CPU of a module includes the work it hands over to other
+// threads through a DQMFragmentDispatcher (DQMThreadCPU), reported apart as
+// well
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ActivityRegistry.h"
+#include "art/Framework/Services/Registry/ServiceDeclarationMacros.h"
+#include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
+#include "art/Framework/Services/Registry/ServiceTable.h"
+#include "art/Persistency/Provenance/ModuleContext.h"
+#include "art/Persistency/Provenance/ScheduleContext.h"
+#include "fhiclcpp/types/Atom.h"
+
+#include "otsdaq-mu2e-dqm/ArtModules/DQMPublishTiming.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMThreadCPU.h"
+#include "otsdaq/Macros/CoutMacros.h"
+#include "otsdaq/MessageFacility/MessageFacility.h"
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace ots {
+  class DQMReplayMonitor {
+  public:
+    struct Config {
+      using Name = fhicl::Name;
+      using Comment = fhicl::Comment;
+      fhicl::Atom<std::string>     reportFile { Name("reportFile"), Comment("JSON report written at the end of the job (none if empty)"), "" };
+    };
+
+    typedef art::ServiceTable<Config> Parameters;
+
+    DQMReplayMonitor(Parameters const& conf, art::ActivityRegistry& reg);
+
+  private:
+    typedef std::chrono::steady_clock clock_t;
+
+    struct module_ {
+      unsigned long n   = 0;
+      double        cpu = 0, offloadedCPU = 0, wall = 0, maxWall = 0;   // seconds, cpu includes offloadedCPU
+    };
+
+    void preEvent_(art::Event const&, art::ScheduleContext);
+    void postEvent_(art::Event const&, art::ScheduleContext);
+    void preModule_(art::ModuleContext const&);
+    void postModule_(art::ModuleContext const&);
+    void postEndJob_();
+
+    std::string                       reportFile_;
+    std::mutex                        mutex_;
+    std::map<std::string, module_>    modules_;
+    unsigned long                     nEvents_;
+    clock_t::time_point               first_, last_;   // first event start, last event end
+    double                            cpuAtFirst_;     // process CPU at the first event
+  };
+} // namespace ots
+
+namespace {
+  // the modules of an event run in the calling thread: begin times per thread
+  thread_local double moduleCPU_  = 0;
+  thread_local double moduleOffloaded_ = 0;
+  thread_local std::chrono::steady_clock::time_point moduleWall_;
+
+  double processCPU() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + 1e-6*(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+  }
+
+  long peakRSSkB() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+  }
+} // namespace
+
+ots::DQMReplayMonitor::DQMReplayMonitor(Parameters const& conf, art::ActivityRegistry& reg)
+  : reportFile_(conf().reportFile()), nEvents_(0), cpuAtFirst_(0) {
+  DQMThreadCPU::enable();
+  reg.sPreProcessEvent .watch(this, &DQMReplayMonitor::preEvent_);
+  reg.sPostProcessEvent.watch(this, &DQMReplayMonitor::postEvent_);
+  reg.sPreModule       .watch(this, &DQMReplayMonitor::preModule_);
+  reg.sPostModule      .watch(this, &DQMReplayMonitor::postModule_);
+  reg.sPostEndJob      .watch(this, &DQMReplayMonitor::postEndJob_);
+}
+
+// the rate is measured from the first event on: the booking at beginJob is
+// not part of it
+void ots::DQMReplayMonitor::preEvent_(art::Event const&, art::ScheduleContext) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (nEvents_ == 0 && first_ == clock_t::time_point()) {
+    first_      = clock_t::now();
+    cpuAtFirst_ = processCPU();
+  }
+}
+
+void ots::DQMReplayMonitor::postEvent_(art::Event const&, art::ScheduleContext) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++nEvents_;
+  last_ = clock_t::now();
+}
+
+void ots::DQMReplayMonitor::preModule_(art::ModuleContext const&) {
+  moduleCPU_       = DQMThreadCPU::now();
+  moduleOffloaded_ = DQMThreadCPU::offloaded();
+  moduleWall_      = clock_t::now();
+}
+
+void ots::DQMReplayMonitor::postModule_(art::ModuleContext const& mc) {
+  double offloaded = DQMThreadCPU::offloaded() - moduleOffloaded_;
+  double cpu       = DQMThreadCPU::now() - moduleCPU_ + offloaded;
+  double wall      = std::chrono::duration<double>(clock_t::now() - moduleWall_).count();
+  std::lock_guard<std::mutex> lock(mutex_);
+  module_& m = modules_[mc.moduleLabel()];
+  ++m.n;
+  m.cpu          += cpu;
+  m.offloadedCPU += offloaded;
+  m.wall   += wall;
+  m.maxWall = std::max(m.maxWall, wall);
+}
+
+void ots::DQMReplayMonitor::postEndJob_() {
+  double seconds = (nEvents_ > 0) ? std::chrono::duration<double>(last_ - first_).count() : 0;
+  double cpu     = processCPU() - cpuAtFirst_;
+  double rate    = (seconds > 0) ? nEvents_/seconds : 0;
+  long   rss     = peakRSSkB();
+  DQMPublishTiming& timing = DQMPublishTiming::instance();
+
+  __MOUT__ << "[DQMReplayMonitor] " << nEvents_ << " events in " << seconds << " s: " << rate
+	   << " events/s, " << cpu << " s CPU, peak RSS " << rss/1024. << " MB" << std::endl;
+  for (auto& m : modules_) {
+    __MOUT__ << "[DQMReplayMonitor]   module " << std::setw(20) << std::left << m.first
+	     << " CPU " << 1e6*m.second.cpu/std::max(1ul, m.second.n) << " us/event ("
+	     << 1e6*m.second.offloadedCPU/std::max(1ul, m.second.n) << " in other threads), wall "
+	     << 1e6*m.second.wall/std::max(1ul, m.second.n) << " us/event (max "
+	     << 1e3*m.second.maxWall << " ms)" << std::endl;
+  }
+  for (const std::string& label : timing.labels()) {
+    for (int s = 0; s < DQMPublishTiming::kNStages; ++s) {
+      DQMPublishTiming::Stage stage = DQMPublishTiming::Stage(s);
+      DQMPublishTiming::summary_t p = timing.summary(label, stage);
+      __MOUT__ << "[DQMReplayMonitor]   publish " << std::setw(20) << std::left << label << " "
+	       << std::setw(8) << DQMPublishTiming::stageName(stage) << " n=" << p.n
+	       << " p50 " << 1e3*p.p50 << " ms, p90 " << 1e3*p.p90 << " ms, p99 " << 1e3*p.p99
+	       << " ms, max " << 1e3*p.max << " ms" << std::endl;
+    }
+  }
+
+  if (reportFile_.empty()) return;
+  std::ofstream out(reportFile_);
+  out << "{\n  \"suite\": \"dqm_replay\",\n  \"format\": 1,\n"
+      << "  \"events\": " << nEvents_ << ",\n  \"seconds\": " << seconds << ",\n"
+      << "  \"events_per_second\": " << rate << ",\n  \"cpu_seconds\": " << cpu << ",\n"
+      << "  \"peak_rss_kB\": " << rss << ",\n  \"modules\": [";
+  bool first = true;
+  for (auto& m : modules_) {
+    out << (first ? "" : ",") << "\n    {\"label\": \"" << m.first << "\", \"events\": " << m.second.n
+	<< ", \"cpu_seconds\": " << m.second.cpu << ", \"offloaded_cpu_seconds\": " << m.second.offloadedCPU
+	<< ", \"wall_seconds\": " << m.second.wall
+	<< ", \"max_wall_seconds\": " << m.second.maxWall << "}";
+    first = false;
+  }
+  out << "\n  ],\n  \"publish\": [";
+  first = true;
+  for (const std::string& label : timing.labels()) {
+    for (int s = 0; s < DQMPublishTiming::kNStages; ++s) {
+      DQMPublishTiming::Stage stage = DQMPublishTiming::Stage(s);
+      DQMPublishTiming::summary_t p = timing.summary(label, stage);
+      out << (first ? "" : ",") << "\n    {\"label\": \"" << label << "\", \"stage\": \"" << DQMPublishTiming::stageName(stage)
+	  << "\", \"n\": " << p.n << ", \"p50\": " << p.p50 << ", \"p90\": " << p.p90
+	  << ", \"p99\": " << p.p99 << ", \"max\": " << p.max << "}";
+      first = false;
+    }
+  }
+  out << "\n  ]\n}" << std::endl;
+  if (!out) mf::LogError("DQMReplayMonitor") << "Cannot write the report to " << reportFile_;
+}
+
+DECLARE_ART_SERVICE(ots::DQMReplayMonitor, SHARED)
+DEFINE_ART_SERVICE(ots::DQMReplayMonitor)
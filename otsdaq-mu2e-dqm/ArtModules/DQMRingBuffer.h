@@ -0,0 +1,68 @@
+#ifndef _DQMRingBuffer_h_
+#define _DQMRingBuffer_h_
+
+#include <cstddef>
+#include <vector>
+
+namespace ots {
+
+  // Fixed-capacity ring buffer.
+  //
+  // The storage is allocated once by Resize(); push() overwrites the oldest
+  // entry when the buffer is full, so the memory stays bounded however long
+  // the run is. Entries are addressed either by their raw slot (the value
+  // returned by push(), stable until overwritten) or in time order with
+  // operator[] (0 = oldest).
+  template <typename T>
+  class DQMRingBuffer {
+  public:
+    explicit DQMRingBuffer(size_t capacity = 0) { Resize(capacity); }
+    virtual ~DQMRingBuffer(void){};
+
+    //drop the content and reallocate
+    void Resize(size_t capacity) {
+      data_.assign(capacity, T());
+      head_ = 0;
+      size_ = 0;
+    }
+
+    void clear() {
+      head_ = 0;
+      size_ = 0;
+    }
+
+    size_t capacity() const { return data_.size(); }
+    size_t size()     const { return size_; }
+    bool   empty()    const { return size_ == 0; }
+    bool   full()     const { return size_ == data_.size(); }
+
+    //store a copy of the entry and return the slot it was written to
+    size_t push(const T& entry) {
+      size_t slot = head_;
+      data_[slot] = entry;
+      head_ = (head_ + 1 == data_.size()) ? 0 : head_ + 1;
+      if (size_ < data_.size()) ++size_;
+      return slot;
+    }
+
+    //slot of the oldest and of the newest entry
+    size_t oldestSlot() const { return full() ? head_ : 0; }
+    size_t newestSlot() const { return (head_ == 0 ? data_.size() : head_) - 1; }
+
+    const T& slot(size_t s) const { return data_[s]; }
+
+    //time-ordered access, 0 is the oldest entry
+    const T& operator[](size_t i) const {
+      size_t s = oldestSlot() + i;
+      return data_[s >= data_.size() ? s - data_.size() : s];
+    }
+
+  private:
+    std::vector<T> data_;
+    size_t         head_;   //next slot to be written
+    size_t         size_;
+  };
+
+} // namespace ots
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef _DQMRunningRegression_h_
+#define _DQMRunningRegression_h_
+
+#include <cmath>
+
+namespace ots {
+
+  // Streaming least-squares fit of y = intercept + slope*x.
+  //
+  // The means and the centred second moments are updated one point at a time
+  // (Welford), which is equivalent to keeping the raw sums Sx, Sy, Sxx, Syy,
+  // Sxy but does not lose precision when the proxies are large (O(1e4) calo
+  // hits) and the interval holds many events. Every accessor is O(1).
+  class DQMRunningRegression {
+  public:
+    DQMRunningRegression() { Reset(); }
+
+    void Reset() {
+      n_ = 0;
+      meanX_ = meanY_ = 0.;
+      cxx_ = cyy_ = cxy_ = 0.;
+    }
+
+    void Add(double x, double y) {
+      ++n_;
+      double dx = x - meanX_;
+      meanX_ += dx/n_;
+      double dy = y - meanY_;
+      meanY_ += dy/n_;
+      //the second factor uses the updated mean
+      cxx_ += dx*(x - meanX_);
+      cyy_ += dy*(y - meanY_);
+      cxy_ += dx*(y - meanY_);
+    }
+
+    unsigned long n()     const { return n_; }
+    double        meanX() const { return meanX_; }
+    double        meanY() const { return meanY_; }
+
+    //a fit needs at least two distinct x values
+    bool isValid() const { return n_ > 2 && cxx_ > 0.; }
+
+    double slope()     const { return isValid() ? cxy_/cxx_ : 0.; }
+    double intercept() const { return meanY_ - slope()*meanX_; }
+
+    double correlation() const {
+      return (cxx_ > 0. && cyy_ > 0.) ? cxy_/std::sqrt(cxx_*cyy_) : 0.;
+    }
+
+    //RMS of the residuals around the fitted line
+    double residualSigma() const {
+      if (!isValid()) return 0.;
+      double rss = cyy_ - cxy_*cxy_/cxx_;
+      return (rss > 0.) ? std::sqrt(rss/(n_ - 2)) : 0.;
+    }
+
+  private:
+    unsigned long n_;
+    double        meanX_, meanY_;
+    double        cxx_, cyy_, cxy_;
+  };
+
+} // namespace ots
+
+#endif
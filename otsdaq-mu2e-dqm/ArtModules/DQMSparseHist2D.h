@@ -0,0 +1,84 @@
+#ifndef _DQMSparseHist2D_h_
+#define _DQMSparseHist2D_h_
+
+#include <TH2.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace ots {
+
+  // Sparse 2D accumulator.
+  //
+  // Keeps the full ("virtual") binning of a 2D histogram but only stores the
+  // occupied cells, in a hash keyed by the global cell index. Occupancy-vs-
+  // intensity plots populate a narrow band of a very large grid, so this is
+  // orders of magnitude smaller than the equivalent TH2F. A ROOT histogram is
+  // only produced on demand, by projecting the occupied cells on a (usually
+  // coarser) target histogram: the cost is O(occupied cells).
+  class DQMSparseHist2D {
+  public:
+    DQMSparseHist2D(int nBinsX, double xMin, double xMax,
+		    int nBinsY, double yMin, double yMax) :
+      nx_(nBinsX), ny_(nBinsY), xMin_(xMin), xMax_(xMax), yMin_(yMin), yMax_(yMax),
+      nEntries_(0) {
+      dx_ = (xMax_ - xMin_)/nx_;
+      dy_ = (yMax_ - yMin_)/ny_;
+    };
+    virtual ~DQMSparseHist2D(void){};
+
+    //same convention as TH2: bin 0 is the underflow, bin n+1 the overflow
+    void Fill(double x, double y, double w = 1.) {
+      ++nEntries_;
+      cells_[key(findBin(x, xMin_, xMax_, dx_, nx_), findBin(y, yMin_, yMax_, dy_, ny_))] += w;
+    }
+
+    void Reset() {
+      cells_.clear();
+      nEntries_ = 0;
+    }
+
+    size_t        nCells()   const { return cells_.size(); }
+
+    //approximate: a hash node (key, value, next pointer) per cell plus the bucket array
+    size_t        memoryBytes() const {
+      return cells_.size()*(sizeof(uint64_t) + sizeof(double) + sizeof(void*)) + cells_.bucket_count()*sizeof(void*);
+    }
+    unsigned long nEntries() const { return nEntries_; }
+
+    //overwrite the target with the content, each cell is added at its centre
+    void FillTH2(TH2* target) const {
+      target->Reset();
+      for (const auto& cell : cells_) {
+	int ix = int(cell.first/(ny_ + 2));
+	int iy = int(cell.first%(ny_ + 2));
+	target->Fill(center(ix, xMin_, dx_), center(iy, yMin_, dy_), cell.second);
+      }
+      target->SetEntries(nEntries_);
+    }
+
+  private:
+    static int findBin(double v, double vMin, double vMax, double dv, int n) {
+      if (v <  vMin) return 0;
+      if (v >= vMax) return n + 1;
+      int bin = 1 + int((v - vMin)/dv);
+      return bin > n ? n : bin;
+    }
+
+    //under/overflow are mapped just outside the axis range
+    static double center(int bin, double vMin, double dv) {
+      return vMin + (bin - 0.5)*dv;
+    }
+
+    uint64_t key(int ix, int iy) const { return uint64_t(ix)*(ny_ + 2) + iy; }
+
+    int                                    nx_, ny_;
+    double                                 xMin_, xMax_, yMin_, yMax_, dx_, dy_;
+    unsigned long                          nEntries_;
+    std::unordered_map<uint64_t, double>   cells_;
+  };
+
+} // namespace ots
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef _DQMSpillState_h_
+#define _DQMSpillState_h_
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "canvas/Utilities/InputTag.h"
+
+#include "Offline/DataProducts/inc/EventWindowMarker.hh"
+
+namespace ots {
+
+  // Spill state of an event window. The values are used directly as array
+  // indices for the per-spill histogram sets, so the fill path never has to
+  // look anything up by name.
+  enum SpillState { kOnspill = 0, kOffspill = 1, kNSpillStates = 2 };
+
+  inline const char* spillStateName(SpillState state) {
+    return (state == kOnspill) ? "onspill" : "offspill";
+  }
+
+  // Classify the event from the EventWindowMarker written by the EWT producer.
+  // Events without a marker are treated as onspill, which is the common case
+  // for the online beam streams.
+  inline SpillState findSpillState(art::Event const& event, art::InputTag const& ewmTag) {
+    art::Handle<mu2e::EventWindowMarker> ewmH;
+    event.getByLabel(ewmTag, ewmH);
+    if (ewmH.isValid() &&
+        ewmH->spillType() == mu2e::EventWindowMarker::SpillType::offspill) {
+      return kOffspill;
+    }
+    return kOnspill;
+  }
+
+  // Event-window tag of an event. The EventWindowMarker only carries the
+  // spill type and the event length: the EWT reaches art as the event
+  // number, which artdaq takes from the sequence id of the fragments, set to
+  // the EWT by the Mu2e DAQ (and by DQMSyntheticDTCEvents).
+  inline unsigned long long eventWindowTag(art::Event const& event) { return event.event(); }
+
+} // namespace ots
+
+#endif
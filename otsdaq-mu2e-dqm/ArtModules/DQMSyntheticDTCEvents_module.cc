@@ -0,0 +1,118 @@
+// This module puts synthetic DTC events in the event, one artdaq fragment of
+// type DTCEVT per DTC as read out by the DAQ, so the raw-data DQM can be
+// replayed at full speed without a data file (fcl/DQMReplaySynthetic.fcl)
+
+#include "art/Framework/Core/EDProducer.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/types/Atom.h"
+
+#include "artdaq-core-mu2e/Overlays/FragmentType.hh"
+#include "artdaq-core/Data/Fragment.hh"
+#include "otsdaq-mu2e-dqm/DQMSim/DTCFragmentGenerator.h"
+#include "otsdaq/Macros/CoutMacros.h"
+#include "otsdaq/MessageFacility/MessageFacility.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ots {
+  class DQMSyntheticDTCEvents : public art::EDProducer {
+  public:
+    struct Config {
+      using Name = fhicl::Name;
+      using Comment = fhicl::Comment;
+      fhicl::Atom<std::string>     subsystem      { Name("subsystem"),      Comment("tracker or calorimeter"), "tracker" };
+      fhicl::Atom<int>             firstDTC       { Name("firstDTC"),       Comment("DTC id of the first fragment"), 0 };
+      fhicl::Atom<int>             nDTCs          { Name("nDTCs"),          Comment("Fragments per event"), 1 };
+      fhicl::Atom<int>             nROCs          { Name("nROCs"),          Comment("Links per DTC"), 6 };
+      fhicl::Atom<double>          occupancy      { Name("occupancy"),      Comment("Mean hits per ROC and event"), 10 };
+      fhicl::Atom<int>             nSamples       { Name("nSamples"),       Comment("ADC samples per hit"), 15 };
+      fhicl::Atom<double>          pedestal       { Name("pedestal"),       Comment("Mean pedestal [ADC]"), 100 };
+      fhicl::Atom<double>          pedestalSpread { Name("pedestalSpread"), Comment("Channel-to-channel RMS of the pedestal"), 5 };
+      fhicl::Atom<double>          noise          { Name("noise"),          Comment("Sample noise RMS [ADC]"), 2 };
+      fhicl::Atom<double>          pulseAmplitude { Name("pulseAmplitude"), Comment("Mean pulse height [ADC]"), 200 };
+      fhicl::Atom<double>          deadFraction   { Name("deadFraction"),   Comment("Fraction of channels never hit"), 0 };
+      fhicl::Atom<double>          hotFraction    { Name("hotFraction"),    Comment("Fraction of channels hit hotFactor times more often"), 0 };
+      fhicl::Atom<double>          hotFactor      { Name("hotFactor"),      Comment("Rate factor of the hot channels"), 20 };
+      fhicl::Atom<double>          blockErrorRate { Name("blockErrorRate"), Comment("Blocks with a bad status and no packets"), 0 };
+      fhicl::Atom<double>          hitErrorRate   { Name("hitErrorRate"),   Comment("Hits with error flags"), 0 };
+      fhicl::Atom<double>          badChannelRate { Name("badChannelRate"), Comment("Hits with a channel outside the detector"), 0 };
+      fhicl::Atom<unsigned long>   seed           { Name("seed"),           Comment("Generator seed"), 1 };
+    };
+
+    typedef art::EDProducer::Table<Config> Parameters;
+
+    explicit DQMSyntheticDTCEvents(Parameters const& conf);
+
+    void produce(art::Event& event) override;
+    void endJob() override;
+
+  private:
+    static DTCGeneratorConfig makeConfig_(Parameters const& conf);
+
+    DTCFragmentGenerator  generator_;
+    std::vector<uint8_t>  buffer_;      // reused across events
+  };
+} // namespace ots
+
+ots::DTCGeneratorConfig ots::DQMSyntheticDTCEvents::makeConfig_(Parameters const& conf) {
+  DTCGeneratorConfig c;
+  if (conf().subsystem() == "tracker") {
+    c.subsystem = dtc_format::kTracker;
+  } else if (conf().subsystem() == "calorimeter") {
+    c.subsystem = dtc_format::kCalorimeter;
+  } else {
+    throw cet::exception("DQMSyntheticDTCEvents") << "unknown subsystem " << conf().subsystem();
+  }
+  c.firstDTC       = conf().firstDTC();
+  c.nDTCs          = conf().nDTCs();
+  c.nROCs          = conf().nROCs();
+  c.occupancy      = conf().occupancy();
+  c.nSamples       = conf().nSamples();
+  c.pedestal       = conf().pedestal();
+  c.pedestalSpread = conf().pedestalSpread();
+  c.noise          = conf().noise();
+  c.pulseAmplitude = conf().pulseAmplitude();
+  c.deadFraction   = conf().deadFraction();
+  c.hotFraction    = conf().hotFraction();
+  c.hotFactor      = conf().hotFactor();
+  c.blockErrorRate = conf().blockErrorRate();
+  c.hitErrorRate   = conf().hitErrorRate();
+  c.badChannelRate = conf().badChannelRate();
+  c.seed           = conf().seed();
+  return c;
+}
+
+ots::DQMSyntheticDTCEvents::DQMSyntheticDTCEvents(Parameters const& conf)
+  : art::EDProducer(conf), generator_(makeConfig_(conf)) {
+  produces<artdaq::Fragments>("DTCEVT");
+}
+
+void ots::DQMSyntheticDTCEvents::produce(art::Event& event) {
+  auto fragments = std::make_unique<artdaq::Fragments>();
+  fragments->reserve(generator_.config().nDTCs);
+  for (int d = 0; d < generator_.config().nDTCs; ++d) {
+    buffer_.clear();
+    size_t nBytes = generator_.generateDTCEvent(event.event(), d, buffer_);
+
+    std::unique_ptr<artdaq::Fragment> frag = artdaq::Fragment::FragmentBytes(nBytes);
+    frag->setUserType(mu2e::FragmentType::DTCEVT);
+    frag->setSequenceID(event.event());
+    frag->setFragmentID(generator_.config().firstDTC + d);
+    memcpy(frag->dataBeginBytes(), buffer_.data(), nBytes);
+    fragments->emplace_back(std::move(*frag));
+  }
+  event.put(std::move(fragments), "DTCEVT");
+}
+
+void ots::DQMSyntheticDTCEvents::endJob() {
+  const DTCFragmentGenerator::stats_t& s = generator_.stats();
+  __MOUT__ << "[DQMSyntheticDTCEvents::endJob] " << s.events << " fragments, " << s.blocks << " blocks, "
+	   << s.hits << " hits, " << s.bytes/1048576. << " MB" << std::endl;
+}
+
+DEFINE_ART_MODULE(ots::DQMSyntheticDTCEvents)
@@ -0,0 +1,51 @@
+#ifndef _DQMThreadCPU_h_
+#define _DQMThreadCPU_h_
+
+#include <time.h>
+
+#include <atomic>
+
+namespace ots {
+
+  // CPU time of the work a module hands over to other threads.
+  //
+  // The replay report (DQMReplayMonitor service) measures the CPU of a module
+  // with CLOCK_THREAD_CPUTIME_ID around its call, which only sees the thread
+  // running the module: the handlers that a DQMFragmentDispatcher runs on the
+  // other threads of its TBB arena would be missed. When enabled (by the
+  // monitor), the dispatcher measures each handler task and credits the CPU
+  // of the tasks that ran on another thread to the calling thread, which the
+  // monitor reads back around the module. Disabled, nothing is measured.
+  class DQMThreadCPU {
+  public:
+    static void enable() { enabled_().store(true, std::memory_order_relaxed); }
+
+    static bool enabled() { return enabled_().load(std::memory_order_relaxed); }
+
+    // seconds of CPU used by the calling thread
+    static double now() {
+      timespec ts;
+      clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+      return ts.tv_sec + 1e-9*ts.tv_nsec;
+    }
+
+    // CPU handed over to other threads by the calling thread so far
+    static double offloaded() { return offloaded_(); }
+
+    static void addOffloaded(double Seconds) { offloaded_() += Seconds; }
+
+  private:
+    static std::atomic<bool>& enabled_() {
+      static std::atomic<bool> enabled(false);
+      return enabled;
+    }
+
+    static double& offloaded_() {
+      thread_local double seconds = 0;
+      return seconds;
+    }
+  };
+
+} // namespace ots
+
+#endif
@@ -0,0 +1,212 @@
+#ifndef _DQMTriggerObjectBank_h_
+#define _DQMTriggerObjectBank_h_
+
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileDirectory.h"
+#include "art_root_io/TFileService.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMFillBuffer.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistMemory.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMTriggerTable.h"
+
+#include <TH1F.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ots {
+
+  // Dense bank of trigger-object histograms.
+  //
+  // Each filter category has a fixed list of variables; a filter module gets
+  // one contiguous block of histograms in a flat vector, booked the first
+  // time the module shows up in a trigger table and kept, by label, across
+  // menu changes. The per-module offsets are resolved once per table, so an
+  // event only touches the blocks of the filters that accepted it: the values
+  // go through a DQMFillBuffer whose target id is the position in the bank.
+  class DQMTriggerObjectBank {
+  public:
+    struct var_ {
+      const char* name;
+      const char* title;
+      int         nBins;
+      double      min, max;
+    };
+
+    enum TrackVar     { kTrkP = 0, kTrkPt, kTrkPz, kTrkNSH, kTrkD0, kTrkChi2, kTrkClE, kTrkNLoops, kNTrackVars };
+    enum HelixVar     { kHelP = 0, kHelPt, kHelNSH, kHelD0, kHelChi2XY, kHelChi2ZPhi, kHelClE, kHelLambda,
+			kHelNLoops, kHelHitRatio, kNHelixVars };
+    enum CaloOnlyVar  { kSeedEPeak = 0, kSeedR1Max1, kSeedR1Max2, kNCaloOnlyVars };
+    enum CaloCalibVar { kClE = 0, kClSize, kNCaloCalibVars };
+    enum TrackMCVar   { kMCP = 0, kMCDP, kMCDPt, kMCDPz, kMCPz, kMCPdg, kMCPurity, kMCPrimaryP, kNTrackMCVars };
+    enum { kMaxVars = kNHelixVars };
+
+    DQMTriggerObjectBank(std::string DirName = "TriggerObjects") :
+      dirName(DirName), maxPerCategory_(0), doMC_(false){};
+    virtual ~DQMTriggerObjectBank(void){};
+
+    std::string                dirName;
+
+    // variables histogrammed for each category, empty for the categories
+    // without a trigger object
+    static const std::vector<var_>& variables(DQMTriggerTable::Category c) {
+      static const std::vector<var_> track = {
+	{"p"     , "Track p; p [MeV/c]"               , 400,    0. , 200. },
+	{"pt"    , "Track p_{T}; p_{T} [MeV/c]"       , 400,    0. , 200. },
+	{"pz"    , "Track p_{Z}; p_{Z} [MeV/c]"       , 400, -200. , 200. },
+	{"nSH"   , "Track nStrawHits; nStrawHits"     , 101,   -0.5, 100.5},
+	{"d0"    , "Track d0; d0 [mm]"                , 801, -400.5, 400.5},
+	{"chi2"  , "Track #chi^{2}/ndof; #chi^{2}/ndof", 100,    0. ,  50. },
+	{"clE"   , "Track cluster energy; E [MeV]"    , 240,    0. , 120. },
+	{"nLoops", "Track nLoops; nLoops"             , 500,    0. ,  50. }};
+      static const std::vector<var_> helix = {
+	{"p"        , "Helix p; p [MeV/c]"                           , 400,    0. , 200. },
+	{"pt"       , "Helix p_{T}; p_{T} [MeV/c]"                   , 400,    0. , 200. },
+	{"nSH"      , "Helix nStrawHits; nStrawHits"                 , 101,   -0.5, 100.5},
+	{"d0"       , "Helix d0; d0 [mm]"                            , 801, -400.5, 400.5},
+	{"chi2XY"   , "Helix #chi^{2}_{XY}; #chi^{2}_{XY}"           , 100,    0. ,  50. },
+	{"chi2ZPhi" , "Helix #chi^{2}_{Z#phi}; #chi^{2}_{Z#phi}"     , 100,    0. ,  50. },
+	{"clE"      , "Helix cluster energy; E [MeV]"                , 240,    0. , 120. },
+	{"lambda"   , "Helix #lambda=dz/d#phi; |#lambda| [mm/rad]"   , 500,    0. , 500. },
+	{"nLoops"   , "Helix nLoops; nLoops"                         , 500,    0. ,  50. },
+	{"hitRatio" , "Helix hitRatio; NComboHits/nExpectedComboHits", 200,    0. ,   2. }};
+      static const std::vector<var_> caloOnly = {
+	{"ePeak"  , "CaloTrigSeed peak energy; E [MeV]"           , 400, 0., 200.},
+	{"r1Max1" , "CaloTrigSeed ring-1 max energy; E [MeV]"     , 400, 0., 200.},
+	{"r1Max2" , "CaloTrigSeed ring-1 2nd max energy; E [MeV]" , 400, 0., 200.}};
+      static const std::vector<var_> caloCalib = {
+	{"clE"    , "Calibration cluster energy; E [MeV]"         , 800,  0. , 800. },
+	{"clSize" , "Calibration cluster size; nCrystals"         , 101, -0.5, 100.5}};
+      static const std::vector<var_> none;
+
+      switch (c) {
+      case DQMTriggerTable::kTrack    : return track;
+      case DQMTriggerTable::kHelix    : return helix;
+      case DQMTriggerTable::kCaloOnly : return caloOnly;
+      case DQMTriggerTable::kCaloCalib: return caloCalib;
+      default                         : return none;
+      }
+    }
+
+    // MC-truth variables, booked after variables() in each block when the
+    // MC matching is enabled. p_{Z} keeps its sign, so the upstream (p_{Z} < 0)
+    // and downstream tracks stay apart. primaryPMC counts the tracks matched
+    // to the primary particle: divided by the event histogram primaryPMC
+    // (all the events with a primary, see primaryOffset()) it is the
+    // efficiency of the filter versus p_{MC}. The ratio is left to the
+    // consumer, so that both stay plain counts that can be merged.
+    static const std::vector<var_>& mcVariables(DQMTriggerTable::Category c) {
+      static const std::vector<var_> track = {
+	{"pMC"       , "Track p_{MC}; p_{MC} [MeV/c]"                     , 400,    0. , 200. },
+	{"dpMC"      , "Track p - p_{MC}; #Deltap [MeV/c]"                , 200,  -10. ,  10. },
+	{"dptMC"     , "Track p_{T} - p_{T,MC}; #Deltap_{T} [MeV/c]"      , 200,  -10. ,  10. },
+	{"dpzMC"     , "Track p_{Z} - p_{Z,MC}; #Deltap_{Z} [MeV/c]"      , 200,  -10. ,  10. },
+	{"pzMC"      , "Track p_{Z,MC}; p_{Z,MC} [MeV/c]"                 , 400, -200. , 200. },
+	{"pdgMC"     , "Track PDG ID of the dominant SimParticle; PDG ID" , 6001, -3000.5, 3000.5},
+	{"purityMC"  , "Track hits from the dominant SimParticle; fraction", 101,   0. ,   1.01},
+	{"primaryPMC", "Tracks matched to the primary; p_{MC} [MeV/c]"    , 400,    0. , 200. }};
+      static const std::vector<var_> none;
+      return c == DQMTriggerTable::kTrack ? track : none;
+    }
+
+    // at most maxPerCategory filters of each category get a block, 0 = no limit
+    void Setup(art::ServiceHandle<art::TFileService> tfs, int maxPerCategory, bool doMC = false) {
+      dir_            = std::make_unique<art::TFileDirectory>(tfs->mkdir(dirName));
+      maxPerCategory_ = maxPerCategory;
+      doMC_           = doMC;
+      if (doMC_) primaryOffset_ = book("event", {{"primaryPMC", "Events with a primary; p_{MC} [MeV/c]", 400, 0., 200.}});
+    }
+
+    // resolve the offsets of the modules of a (re)built table, booking the
+    // blocks of the filters seen for the first time; returns the number of
+    // filters left without a block
+    int Update(const DQMTriggerTable& table) {
+      int nSkipped(0);
+      offsets_.assign(table.modules().size(), -1);
+      for (const DQMTriggerTable::module_& mod : table.modules()) {
+	const std::vector<var_>& vars = variables(mod.category);
+	if (vars.empty()) continue;
+
+	auto it = offsetByLabel_.find(mod.label);
+	if (it == offsetByLabel_.end()) {
+	  int& nBooked = nBooked_[mod.category];
+	  if (maxPerCategory_ > 0 && nBooked >= maxPerCategory_) { ++nSkipped; continue; }
+	  ++nBooked;
+	  int first = book(mod.label, vars);
+	  if (doMC_) book(mod.label, mcVariables(mod.category));
+	  it = offsetByLabel_.emplace(mod.label, first).first;
+	}
+	offsets_[mod.globalIndex] = it->second;
+      }
+      return nSkipped;
+    }
+
+    // first histogram of the module block, -1 if the module has none
+    int offset(int globalIndex) const { return offsets_[globalIndex]; }
+
+    // first MC histogram of a block, -1 if MC is disabled
+    int mcOffset(int offset, DQMTriggerTable::Category c) const {
+      if (!doMC_ || offset < 0 || mcVariables(c).empty()) return -1;
+      return offset + int(variables(c).size());
+    }
+
+    bool doMC() const { return doMC_; }
+
+    // the per-event p_{MC} of the primary particle, -1 if MC is disabled
+    int primaryOffset() const { return primaryOffset_; }
+
+    // buffer the values of one trigger object; Values follows variables()
+    void fill(int offset, const double* Values, size_t nValues) {
+      for (size_t v=0; v<nValues; ++v) fillBuffer_.Add(offset + v, Values[v]);
+    }
+
+    void Flush() { fillBuffer_.Flush(); }
+
+    size_t size() const { return bank_.size(); }
+
+    // the booked blocks and the fill buffer
+    DQMMemoryUsage memoryUsage() const {
+      DQMMemoryUsage usage;
+      for (const TH1F* h : bank_) usage.addHist(h);
+      usage.buffers += fillBuffer_.capacityBytes();
+      return usage;
+    }
+
+    // clone the bank into the packet and reset it
+    void publish(std::map<std::string,std::vector<TH1*>>& hists_to_send, const std::string& refName) {
+      std::vector<TH1*>& out = hists_to_send[refName];
+      out.reserve(out.size() + bank_.size());
+      for (TH1F* h : bank_) {
+	out.push_back((TH1*)h->Clone());
+	h->Reset();
+      }
+    }
+
+  private:
+    int book(const std::string& label, const std::vector<var_>& vars) {
+      int first = int(bank_.size());
+      for (const var_& var : vars) {
+	TH1F* h = dir_->make<TH1F>(("h_" + label + "_" + var.name).c_str(),
+				   (label + ": " + var.title).c_str(), var.nBins, var.min, var.max);
+	bank_.push_back(h);
+	fillBuffer_.AddTarget(h);
+      }
+      return first;
+    }
+
+    int                                    maxPerCategory_;
+    bool                                   doMC_;
+    int                                    primaryOffset_ = -1;
+    int                                    nBooked_[DQMTriggerTable::kNCategories] = {0};
+    std::unique_ptr<art::TFileDirectory>   dir_;
+    std::vector<TH1F*>                     bank_;        // same order as the fill-buffer targets
+    std::vector<int>                       offsets_;     // per module of the current table
+    std::unordered_map<std::string, int>   offsetByLabel_;
+    DQMFillBuffer                          fillBuffer_;
+  };
+
+} // namespace ots
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef _DQMTriggerTable_h_
+#define _DQMTriggerTable_h_
+
+#include "canvas/Persistency/Common/TriggerResults.h"
+#include "fhiclcpp/ParameterSetID.h"
+
+#include "Offline/Mu2eUtilities/inc/TriggerResultsNavigator.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ots {
+
+  // Trigger menu table.
+  //
+  // The trigger paths and the filter modules they run only change when the
+  // TriggerResults come from a different configuration, so the table is built
+  // once per ParameterSetID: every module label is classified (track, helix,
+  // calo-only, calo calibration, event prescaler) and given an index within
+  // its category and in the global list, in order of first appearance, which
+  // is the ordering the old TriggerRates module assigned at run time. Per
+  // event the modules only need TriggerResults::accept(path) and the indices
+  // stored here; no module label is looked at again. Labels are resolved
+  // through a hash, so lookups by name stay O(1) as well.
+  class DQMTriggerTable {
+  public:
+    enum Category { kTrack = 0, kHelix, kCaloOnly, kCaloCalib, kEvtPrescale, kOther, kNCategories };
+
+    struct module_ {
+      std::string label;
+      Category    category;
+      int         index;        //position within the category
+      int         globalIndex;  //position among all the modules
+    };
+
+    struct path_ {
+      std::string         name;
+      size_t              bit;      //position in the TriggerResults
+      size_t              pathID;   //trigger path ID from the navigator
+      std::vector<int>    modules;  //indices in modules()
+      uint64_t            mask;     //user bits, see buildMasks()
+    };
+
+    DQMTriggerTable(){};
+    virtual ~DQMTriggerTable(void){};
+
+    static Category classify(const std::string& label) {
+      if (label.find("HSFilter")        != std::string::npos) return kHelix;
+      if (label.find("TSFilter")        != std::string::npos) return kTrack;
+      if (label.find("EventPrescale")   != std::string::npos) return kEvtPrescale;
+      if (label.find("CaloCosmicCalib") != std::string::npos) return kCaloCalib;
+      if (label.find("caloMVACEFilter") != std::string::npos ||
+	  label.find("caloLHCEFilter")  != std::string::npos) return kCaloOnly;
+      return kOther;
+    }
+
+    static const char* categoryName(Category c) {
+      static const char* names[kNCategories] = {"track", "helix", "caloOnly", "caloCalib", "evtPrescale", "other"};
+      return names[c];
+    }
+
+    // rebuild the table if the trigger configuration changed; returns true
+    // when it did. SelectedPaths restricts the table to those paths (all the
+    // paths if empty)
+    bool Update(const art::TriggerResults& results, const std::vector<std::string>& SelectedPaths) {
+      if (valid_ && results.parameterSetID() == psetID_) return false;
+
+      psetID_ = results.parameterSetID();
+      valid_  = true;
+      paths_  .clear();
+      modules_.clear();
+      moduleIndex_.clear();
+      std::fill(nPerCategory_, nPerCategory_ + kNCategories, 0);
+
+      mu2e::TriggerResultsNavigator   trigNavig(&results);
+      const std::vector<std::string>& names = trigNavig.getTrigPaths();
+      for (size_t i=0; i<names.size(); ++i){
+	if (!SelectedPaths.empty() &&
+	    std::find(SelectedPaths.begin(), SelectedPaths.end(), names[i]) == SelectedPaths.end()) continue;
+	path_ path;
+	path.name   = names[i];
+	path.bit    = i;
+	path.pathID = trigNavig.findTrigPathID(names[i]);
+	path.mask   = 0;
+	for (const std::string& label : trigNavig.triggerModules(names[i])) {
+	  path.modules.push_back(findOrAddModule(label));
+	}
+	paths_.push_back(path);
+      }
+      return true;
+    }
+
+    // set the per-path masks: ModuleBit returns the bit (0-63) a module maps
+    // to, or a negative value if it does not contribute
+    template <typename F>
+    void buildMasks(F ModuleBit) {
+      for (path_& path : paths_) {
+	path.mask = 0;
+	for (int m : path.modules) {
+	  int bit = ModuleBit(modules_[m]);
+	  if (bit >= 0 && bit < 64) path.mask |= (uint64_t(1) << bit);
+	}
+      }
+    }
+
+    // OR of the masks of the accepted paths
+    uint64_t acceptedMask(const art::TriggerResults& results) const {
+      uint64_t mask(0);
+      for (const path_& path : paths_) {
+	if (results.accept(path.bit)) mask |= path.mask;
+      }
+      return mask;
+    }
+
+    // one bit per path, in table order; paths beyond the 64th are ignored
+    uint64_t acceptedPaths(const art::TriggerResults& results) const {
+      uint64_t mask(0);
+      size_t   n = std::min(paths_.size(), size_t(kMaxMaskPaths));
+      for (size_t i=0; i<n; ++i){
+	if (results.accept(paths_[i].bit)) mask |= (uint64_t(1) << i);
+      }
+      return mask;
+    }
+
+    // index of the module in modules(), -1 if unknown
+    int findModule(const std::string& label) const {
+      auto it = moduleIndex_.find(label);
+      return (it == moduleIndex_.end()) ? -1 : it->second;
+    }
+
+    enum { kMaxMaskPaths = 64 };
+
+    const std::vector<path_>&   paths()   const { return paths_; }
+    const std::vector<module_>& modules() const { return modules_; }
+    int nModules(Category c)              const { return nPerCategory_[c]; }
+
+  private:
+    int findOrAddModule(const std::string& label) {
+      int found = findModule(label);
+      if (found >= 0) return found;
+      module_ mod;
+      mod.label       = label;
+      mod.category    = classify(label);
+      mod.index       = nPerCategory_[mod.category]++;
+      mod.globalIndex = int(modules_.size());
+      modules_.push_back(mod);
+      moduleIndex_[label] = mod.globalIndex;
+      return mod.globalIndex;
+    }
+
+    bool                   valid_ = false;
+    fhicl::ParameterSetID  psetID_;
+    std::vector<path_>     paths_;
+    std::vector<module_>   modules_;
+    std::unordered_map<std::string, int> moduleIndex_;
+    int                    nPerCategory_[kNCategories] = {0};
+  };
+
+} // namespace ots
+
+#endif
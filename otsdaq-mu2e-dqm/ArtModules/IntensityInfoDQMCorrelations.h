@@ -0,0 +1,203 @@
+#ifndef _IntensityInfoDQMCorrelations_h_
+#define _IntensityInfoDQMCorrelations_h_
+
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileDirectory.h"
+#include "art_root_io/TFileService.h"
+#include "otsdaq/Macros/CoutMacros.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMRunningRegression.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistMemory.h"
+
+#include <TH1F.h>
+#include <TH2F.h>
+#include <TProfile.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ots {
+
+  // Pairwise correlations of the intensity proxies.
+  //
+  // For every pair of proxies the module fills a 2D correlation histogram and a
+  // running linear regression. Each event is also tested against the fit of the
+  // previous publishing interval: a point further than nSigma residual RMS from
+  // that line is counted as an outlier. The test is O(1) per pair and per event.
+  // At publish time the slope, correlation and outlier rate of the interval are
+  // appended to per-pair trend histograms, and the interval fit becomes the
+  // reference for the next one.
+  //
+  // The correlation maps are sent as deltas in the set's directory, the trend
+  // rings whole in <set>_trends (a snapshot, see DQMPacket.hh). The per-pair
+  // values of the interval are profiles weighted by the events behind them,
+  // so that an aggregator averages them over its sources.
+  class IntensityInfoDQMCorrelations {
+  public:
+    enum Proxy { kCAPHRIHits = 0, kCaloHits, kCaloEnergy, kTrackerHits, kNProxies };
+    enum { kNPairs = kNProxies*(kNProxies - 1)/2 };
+
+    struct proxyAxis_ {
+      std::string name;
+      int         nBins;
+      float       min, max;
+    };
+
+    IntensityInfoDQMCorrelations(std::string DirName = "IntensityInfo_correlations") :
+      dirName(DirName), nSigma_(5.), minEntries_(20), trendLength_(100), nIntervals_(0) {
+      int k(0);
+      for (int i=0; i<kNProxies; ++i){
+	for (int j=i+1; j<kNProxies; ++j, ++k){
+	  pairX_[k] = i;
+	  pairY_[k] = j;
+	}
+      }
+    };
+    virtual ~IntensityInfoDQMCorrelations(void){};
+
+    std::string                dirName;
+
+    void Setup(float nSigma, unsigned int minEntries, int trendLength) {
+      nSigma_      = nSigma;
+      minEntries_  = minEntries;
+      trendLength_ = trendLength > 0 ? trendLength : 1;
+    }
+
+    void BookHistos(art::ServiceHandle<art::TFileService> tfs, const proxyAxis_ axes[kNProxies]) {
+      art::TFileDirectory dir = tfs->mkdir(dirName);
+
+      _hSlope       = dir.make<TProfile>("pairSlope"      , "Fitted slope per proxy pair; ; slope"               , kNPairs, -0.5, kNPairs-0.5);
+      _hCorrelation = dir.make<TProfile>("pairCorrelation", "Correlation coefficient per proxy pair; ; r"        , kNPairs, -0.5, kNPairs-0.5);
+      _hOutlierRate = dir.make<TProfile>("pairOutlierRate", "Outlier fraction per proxy pair; ; outliers/events" , kNPairs, -0.5, kNPairs-0.5);
+
+      for (int k=0; k<kNPairs; ++k){
+	const proxyAxis_& ax = axes[pairX_[k]];
+	const proxyAxis_& ay = axes[pairY_[k]];
+	std::string pair = ax.name + "_vs_" + ay.name;
+	pairs_[k].name = pair;
+
+	_hSlope      ->GetXaxis()->SetBinLabel(k+1, pair.c_str());
+	_hCorrelation->GetXaxis()->SetBinLabel(k+1, pair.c_str());
+	_hOutlierRate->GetXaxis()->SetBinLabel(k+1, pair.c_str());
+
+	pairs_[k]._hCorr         = dir.make<TH2F>(("corr_"+pair).c_str(),
+						  (pair+"; "+ax.name+"; "+ay.name).c_str(),
+						  ax.nBins, ax.min, ax.max, ay.nBins, ay.min, ay.max);
+	pairs_[k]._hSlopeTrend   = dir.make<TH1F>(("slopeTrend_"+pair).c_str(),
+						  (pair+" slope; interval (0 = latest); slope").c_str(),
+						  trendLength_, -trendLength_+0.5, 0.5);
+	pairs_[k]._hOutlierTrend = dir.make<TH1F>(("outlierTrend_"+pair).c_str(),
+						  (pair+" outlier rate; interval (0 = latest); outliers/events").c_str(),
+						  trendLength_, -trendLength_+0.5, 0.5);
+	pairs_[k].slopeTrend  .assign(trendLength_, 0.);
+	pairs_[k].outlierTrend.assign(trendLength_, 0.);
+      }
+    }
+
+    //per-event entry point, the values are indexed by Proxy
+    void fill(const double values[kNProxies]) {
+      for (int k=0; k<kNPairs; ++k){
+	pairInfo_& p = pairs_[k];
+	double     x = values[pairX_[k]];
+	double     y = values[pairY_[k]];
+	p._hCorr->Fill(x, y);
+	p.fit.Add(x, y);
+	if (!p.hasReference) continue;
+	++p.nTested;
+	if (std::fabs(y - (p.refIntercept + p.refSlope*x)) > nSigma_*p.refSigma) ++p.nOutliers;
+      }
+    }
+
+    //close the interval: update the trends, add the histograms to the packet and reset
+    //trend rings and histograms (NULL until booked)
+    DQMMemoryUsage memoryUsage() const {
+      DQMMemoryUsage usage;
+      for (const pairInfo_& pair : pairs_){
+	usage.addVector(pair.slopeTrend); usage.addVector(pair.outlierTrend);
+	usage.addHist(pair._hCorr); usage.addHist(pair._hSlopeTrend); usage.addHist(pair._hOutlierTrend);
+      }
+      usage.addHist(_hSlope); usage.addHist(_hCorrelation); usage.addHist(_hOutlierRate);
+      return usage;
+    }
+
+    void publish(std::map<std::string,std::vector<TH1*>>& hists_to_send, const std::string& refName) {
+      int slot = nIntervals_ % trendLength_;
+      ++nIntervals_;
+      _hSlope->Reset(); _hCorrelation->Reset(); _hOutlierRate->Reset();
+
+      for (int k=0; k<kNPairs; ++k){
+	pairInfo_& p = pairs_[k];
+	double slope       = p.fit.slope();
+	double outlierRate = (p.nTested > 0) ? double(p.nOutliers)/p.nTested : 0.;
+
+	if (p.fit.n() > 0){
+	  _hSlope      ->Fill(k, slope, p.fit.n());
+	  _hCorrelation->Fill(k, p.fit.correlation(), p.fit.n());
+	}
+	if (p.nTested > 0) _hOutlierRate->Fill(k, outlierRate, p.nTested);
+
+	p.slopeTrend  [slot] = slope;
+	p.outlierTrend[slot] = outlierRate;
+	fillTrend(p._hSlopeTrend  , p.slopeTrend  , slot);
+	fillTrend(p._hOutlierTrend, p.outlierTrend, slot);
+
+	//the fit of this interval is the reference for the next one
+	if (p.fit.n() >= minEntries_ && p.fit.isValid() && p.fit.residualSigma() > 0.){
+	  p.hasReference = true;
+	  p.refSlope     = slope;
+	  p.refIntercept = p.fit.intercept();
+	  p.refSigma     = p.fit.residualSigma();
+	}
+	p.fit.Reset();
+	p.nTested   = 0;
+	p.nOutliers = 0;
+
+	hists_to_send[refName].push_back((TH1*)p._hCorr->Clone());
+	hists_to_send[refName+"_trends"].push_back((TH1*)p._hSlopeTrend  ->Clone());
+	hists_to_send[refName+"_trends"].push_back((TH1*)p._hOutlierTrend->Clone());
+	p._hCorr->Reset();
+      }
+
+      hists_to_send[refName].push_back((TH1*)_hSlope      ->Clone());
+      hists_to_send[refName].push_back((TH1*)_hCorrelation->Clone());
+      hists_to_send[refName].push_back((TH1*)_hOutlierRate->Clone());
+    }
+
+  private:
+    struct pairInfo_ {
+      std::string           name;
+      DQMRunningRegression  fit;                 //current interval
+      bool                  hasReference;        //fit of the previous interval
+      double                refSlope, refIntercept, refSigma;
+      unsigned long         nTested, nOutliers;
+      std::vector<double>   slopeTrend, outlierTrend;  //rings of trendLength_ intervals
+      TH2F                 *_hCorr;
+      TH1F                 *_hSlopeTrend, *_hOutlierTrend;
+      pairInfo_() : hasReference(false), refSlope(0), refIntercept(0), refSigma(0),
+		    nTested(0), nOutliers(0), _hCorr(NULL), _hSlopeTrend(NULL), _hOutlierTrend(NULL) {}
+    };
+
+    //unroll the ring so that the latest interval sits in the last bin
+    void fillTrend(TH1F* hist, const std::vector<double>& ring, int latest) {
+      int nFilled = std::min(nIntervals_, trendLength_);
+      hist->Reset();
+      for (int i=0; i<nFilled; ++i){
+	int idx = (latest - i + trendLength_) % trendLength_;
+	hist->SetBinContent(trendLength_ - i, ring[idx]);
+      }
+    }
+
+    float         nSigma_;
+    unsigned int  minEntries_;
+    int           trendLength_, nIntervals_;
+    int           pairX_[kNPairs], pairY_[kNPairs];
+    pairInfo_     pairs_[kNPairs];
+
+    TProfile *_hSlope = NULL, *_hCorrelation = NULL, *_hOutlierRate = NULL;
+  };
+
+} // namespace ots
+
+#endif
@@ -6,6 +6,8 @@
 #include "art_root_io/TFileService.h"
 #include "otsdaq/NetworkUtilities/TCPPublishServer.h"
 #include "otsdaq/Macros/CoutMacros.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMFillBuffer.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMHistSchema.h"
 #include <TH1F.h>
 #include <string>
 
@@ -13,8 +15,24 @@ namespace ots {
 
   class IntensityInfoDQMHistoContainer {
   public:
-    IntensityInfoDQMHistoContainer(){};
+    IntensityInfoDQMHistoContainer(std::string DirName = "IntensityInfo_summary") : dirName(DirName){};
     virtual ~IntensityInfoDQMHistoContainer(void){};
+
+    enum SummaryHist { kCAPHRIHits = 0, kCaloHits, kCaloEnergy, kTrackerHits, kNSummaryHists };
+
+    // offspill the intensity proxies only see cosmics and noise
+    static constexpr DQMHistSpec kOnspillSchema[kNSummaryHists] = {
+      { "CAPHRI hits; nCAPHRIHits; Events"                       , 100, 0, 100  },
+      { "IntensityInfo Calo, nHits; nCaloHits; Events/60"        , 200, 0, 12e3 },
+      { "IntensityInfo Calo, caloEnergy; E[MeV]; Events/(5 MeV)" , 400, 0, 2e3  },
+      { "IntensityInfo Tracker; nTrkHits"                        , 200, 0, 12e3 }};
+    static constexpr DQMHistSpec kOffspillSchema[kNSummaryHists] = {
+      { "CAPHRI hits; nCAPHRIHits; Events"                       ,  10, 0, 10   },
+      { "IntensityInfo Calo, nHits; nCaloHits; Events/2"         , 200, 0, 400  },
+      { "IntensityInfo Calo, caloEnergy; E[MeV]; Events/(1 MeV)" , 500, 0, 500  },
+      { "IntensityInfo Tracker; nTrkHits"                        , 200, 0, 400  }};
+    static_assert(schemaIsValid(kOnspillSchema) && schemaIsValid(kOffspillSchema), "invalid IntensityInfo summary schema");
+
     struct summaryInfoHist_ {
       TH1F *_Hist;
       int   plane;
@@ -24,13 +42,16 @@ namespace ots {
     };
 
     std::vector<summaryInfoHist_> histograms;
+    std::string                   dirName;
+    DQMFillBuffer                 fillBuffer;   // per-event fills, the id is the position in histograms
 
     void BookSummaryHistos(art::ServiceHandle<art::TFileService> tfs, std::string Title,
 			   int nBins, float min, float max) {
       histograms.push_back(summaryInfoHist_());
-      art::TFileDirectory testDir = tfs->mkdir("IntensityInfo_summary");
+      art::TFileDirectory testDir = tfs->mkdir(dirName);
       this->histograms[histograms.size() - 1]._Hist = 
 	testDir.make<TH1F>(Title.c_str(), Title.c_str(), nBins, min, max);
+      fillBuffer.AddTarget(this->histograms[histograms.size() - 1]._Hist);
     }
   
     /* void BookHistos(art::ServiceHandle<art::TFileService> tfs, std::string Title, */
@@ -0,0 +1,160 @@
+#ifndef _IntensityInfoDQMTimeSeries_h_
+#define _IntensityInfoDQMTimeSeries_h_
+
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileDirectory.h"
+#include "art_root_io/TFileService.h"
+#include "otsdaq/Macros/CoutMacros.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMRingBuffer.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistMemory.h"
+
+#include <TH1D.h>
+#include <TH1F.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ots {
+
+  // Per-event intensity time series.
+  //
+  // The records of the last nBuckets*bucketSize events are kept in a ring
+  // buffer. The ring is split into nBuckets consecutive segments, and each
+  // segment keeps its min/max/mean in place while the records are written. A
+  // segment restarts when the write cursor re-enters it, so its summary always
+  // describes exactly the records it holds. Publishing therefore only walks
+  // the buckets, independent of the number of events.
+  class IntensityInfoDQMTimeSeries {
+  public:
+    enum Var { kCAPHRIHits = 0, kCaloEnergy, kTrackerHits, kNVars };
+
+    struct record_ {
+      unsigned long long tag;              //event-window tag
+      float              values[kNVars];
+    };
+
+    IntensityInfoDQMTimeSeries(std::string DirName = "IntensityInfo_timeseries") :
+      dirName(DirName), nBuckets_(0), bucketSize_(1){};
+    virtual ~IntensityInfoDQMTimeSeries(void){};
+
+    std::string                dirName;
+
+    void Setup(int nBuckets, int bucketSize) {
+      nBuckets_   = nBuckets   > 0 ? nBuckets   : 1;
+      bucketSize_ = bucketSize > 0 ? bucketSize : 1;
+      ring_.Resize(size_t(nBuckets_)*bucketSize_);
+      buckets_.assign(nBuckets_, bucket_());
+    }
+
+    void BookHistos(art::ServiceHandle<art::TFileService> tfs) {
+      art::TFileDirectory dir = tfs->mkdir(dirName);
+      const char* names [kNVars] = {"nCAPHRIHits", "caloEnergy", "nTrkHits"};
+      const char* titles[kNVars] = {"CAPHRI hits" , "Calo energy [MeV]", "Tracker hits"};
+      std::string xTitle = "bucket of " + std::to_string(bucketSize_) + " events (latest on the right)";
+
+      for (int v=0; v<kNVars; ++v){
+	std::string n(names[v]);
+	_hMean[v] = dir.make<TH1F>(("ts_"+n+"_mean").c_str(), (std::string(titles[v])+" mean; "+xTitle).c_str(), nBuckets_, 0, nBuckets_);
+	_hMin [v] = dir.make<TH1F>(("ts_"+n+"_min" ).c_str(), (std::string(titles[v])+" min; " +xTitle).c_str(), nBuckets_, 0, nBuckets_);
+	_hMax [v] = dir.make<TH1F>(("ts_"+n+"_max" ).c_str(), (std::string(titles[v])+" max; " +xTitle).c_str(), nBuckets_, 0, nBuckets_);
+      }
+      //double precision: event tags do not fit a float mantissa
+      _hTag = dir.make<TH1D>("ts_eventTag", ("First event-window tag; "+xTitle).c_str(), nBuckets_, 0, nBuckets_);
+    }
+
+    //per-event entry point: one ring write and an O(1) bucket update
+    void fill(unsigned long long tag, float caphriHits, float caloEnergy, float trkHits) {
+      record_ rec;
+      rec.tag                 = tag;
+      rec.values[kCAPHRIHits] = caphriHits;
+      rec.values[kCaloEnergy] = caloEnergy;
+      rec.values[kTrackerHits]= trkHits;
+
+      size_t   slot = ring_.push(rec);
+      bucket_& b    = buckets_[slot/bucketSize_];
+      if (slot % bucketSize_ == 0) b.restart(rec);
+      b.add(rec);
+    }
+
+    //the event ring, the buckets and the histograms (booked with _hTag)
+    DQMMemoryUsage memoryUsage() const {
+      DQMMemoryUsage usage;
+      usage.bins += ring_.capacity()*sizeof(record_);
+      usage.addVector(buckets_);
+      if (!_hTag) return usage;
+      for (int v=0; v<kNVars; ++v){
+	usage.addHist(_hMean[v]); usage.addHist(_hMin[v]); usage.addHist(_hMax[v]);
+      }
+      usage.addHist(_hTag);
+      return usage;
+    }
+
+    //redraw the series from the buckets, oldest to newest, and add it to the packet
+    void publish(std::map<std::string,std::vector<TH1*>>& hists_to_send, const std::string& refName) {
+      for (int v=0; v<kNVars; ++v){
+	_hMean[v]->Reset(); _hMin[v]->Reset(); _hMax[v]->Reset();
+      }
+      _hTag->Reset();
+
+      if (!ring_.empty()) {
+	int newest = ring_.newestSlot()/bucketSize_;
+	for (int i=0; i<nBuckets_; ++i){
+	  const bucket_& b = buckets_[(newest - i + nBuckets_) % nBuckets_];
+	  if (b.n == 0) break;
+	  int bin = nBuckets_ - i;
+	  for (int v=0; v<kNVars; ++v){
+	    _hMean[v]->SetBinContent(bin, b.sum[v]/b.n);
+	    _hMin [v]->SetBinContent(bin, b.min[v]);
+	    _hMax [v]->SetBinContent(bin, b.max[v]);
+	  }
+	  _hTag->SetBinContent(bin, double(b.firstTag));
+	}
+      }
+
+      for (int v=0; v<kNVars; ++v){
+	hists_to_send[refName].push_back((TH1*)_hMean[v]->Clone());
+	hists_to_send[refName].push_back((TH1*)_hMin [v]->Clone());
+	hists_to_send[refName].push_back((TH1*)_hMax [v]->Clone());
+      }
+      hists_to_send[refName].push_back((TH1*)_hTag->Clone());
+    }
+
+  private:
+    struct bucket_ {
+      unsigned int       n;
+      unsigned long long firstTag;
+      float              min[kNVars], max[kNVars];
+      double             sum[kNVars];
+      bucket_() : n(0), firstTag(0) {}
+
+      void restart(const record_& rec) {
+	n        = 0;
+	firstTag = rec.tag;
+	for (int v=0; v<kNVars; ++v){
+	  min[v] = max[v] = rec.values[v];
+	  sum[v] = 0.;
+	}
+      }
+      void add(const record_& rec) {
+	++n;
+	for (int v=0; v<kNVars; ++v){
+	  min[v]  = std::min(min[v], rec.values[v]);
+	  max[v]  = std::max(max[v], rec.values[v]);
+	  sum[v] += rec.values[v];
+	}
+      }
+    };
+
+    int                          nBuckets_, bucketSize_;
+    DQMRingBuffer<record_>       ring_;
+    std::vector<bucket_>         buckets_;
+
+    TH1F *_hMean[kNVars], *_hMin[kNVars], *_hMax[kNVars];
+    TH1D *_hTag = NULL;
+  };
+
+} // namespace ots
+
+#endif
@@ -1,41 +1,38 @@
 // Author: G. Pezzullo
 // This module produces histograms of data from the TriggerResults
 
-#include "art/Framework/Core/EDAnalyzer.h"
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
-#include "art_root_io/TFileService.h"
-#include "fhiclcpp/types/OptionalAtom.h"
-#include "canvas/Persistency/Common/TriggerResults.h"
-#include "art/Framework/Services/System/TriggerNamesService.h"
+#include "fhiclcpp/types/TableFragment.h"
 
-#include <TBufferFile.h>
 #include <TH1F.h>
 
+#include "otsdaq-mu2e-dqm/ArtModules/DQMModule.h"
+#include "otsdaq-mu2e-dqm/ArtModules/IntensityInfoDQMCorrelations.h"
 #include "otsdaq-mu2e-dqm/ArtModules/IntensityInfoDQMHistoContainer.h"
+#include "otsdaq-mu2e-dqm/ArtModules/IntensityInfoDQMTimeSeries.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMSpillState.h"
 #include "otsdaq/Macros/CoutMacros.h"
 #include "otsdaq/Macros/ProcessorPluginMacros.h"
 #include "otsdaq/MessageFacility/MessageFacility.h"
-#include "otsdaq/NetworkUtilities/TCPSendClient.h"
-#include "otsdaq-mu2e/ArtModules/HistoSender.hh"
 
 #include "Offline/RecoDataProducts/inc/CaloHit.hh"
 #include "Offline/RecoDataProducts/inc/IntensityInfoCalo.hh"
 #include "Offline/RecoDataProducts/inc/IntensityInfoTrackerHits.hh"
 
 namespace ots {
-  class IntensityInfoDQM : public art::EDAnalyzer {
+  class IntensityInfoDQM : public DQMModule<IntensityInfoDQMHistoContainer> {
   public:
     struct Config {
       using Name = fhicl::Name;
       using Comment = fhicl::Comment;
-      fhicl::Atom<int>             port      { Name("port"),      Comment("This parameter sets the port where the histogram will be sent") };
-      fhicl::Atom<std::string>     address   { Name("address"),   Comment("This paramter sets the IP address where the histogram will be sent") };
-      fhicl::Atom<std::string>     moduleTag { Name("moduleTag"), Comment("Module tag name") };
-      fhicl::Sequence<std::string> histType  { Name("histType"),  Comment("This parameter determines which quantity is histogrammed") };
-      fhicl::Atom<int>             freqDQM   { Name("freqDQM"),   Comment("Frequency for sending histograms to the data-receiver") };
-      fhicl::Atom<int>             diag      { Name("diagLevel"), Comment("Diagnostic level"), 0 };
+      fhicl::TableFragment<DQMModuleConfig> dqm;
+      fhicl::Atom<float>           outlierNSigma { Name("outlierNSigma"), Comment("Residual, in units of the previous-interval RMS, above which an event is an outlier"), 5. };
+      fhicl::Atom<unsigned int>    minFitEntries { Name("minFitEntries"), Comment("Minimum number of events for an interval fit to be used as outlier reference"), 20 };
+      fhicl::Atom<int>             trendLength   { Name("trendLength"),   Comment("Number of publishing intervals shown in the slope and outlier-rate trends"), 100 };
+      fhicl::Atom<int>             timeSeriesBuckets    { Name("timeSeriesBuckets"),    Comment("Number of display buckets of the intensity time series"), 200 };
+      fhicl::Atom<int>             timeSeriesBucketSize { Name("timeSeriesBucketSize"), Comment("Number of events per time-series bucket"), 100 };
     };
 
     typedef art::EDAnalyzer::Table<Config> Parameters;
@@ -47,70 +44,84 @@ namespace ots {
     void beginJob() override;
     void endJob() override;
 
+    void book_summary(IntensityInfoDQMHistoContainer *histos, SpillState spill) override;
+    void book_correlations(IntensityInfoDQMCorrelations *corr, SpillState spill);
     void summary_fill(IntensityInfoDQMHistoContainer *histos, 
 		      const mu2e::CaloHitCollection        *CAPHRIHits,
 		      const mu2e::IntensityInfoCalo        *CaloInfos, 
 		      const mu2e::IntensityInfoTrackerHits *TrkInfos);
-    void PlotRate(art::Event const& e);
 
   private:
+    void book_set(SpillState spill, const std::string& Suffix) override;
+    void collect_extra(packet_t& packet) override;
+    DQMMemoryUsage memory_extra() const override;
+
     Config                    conf_;
-    int                       port_;
-    std::string               address_;
-    std::string               moduleTag_;
-    std::vector<std::string>  histType_;
-    int                       freqDQM_,  diagLevel_, evtCounter_;
-    art::ServiceHandle<art::TFileService> tfs;
-    IntensityInfoDQMHistoContainer* summary_histos  = new IntensityInfoDQMHistoContainer();
-    HistoSender*              histSender_;
-    bool                      doOnspillHist_, doOffspillHist_;
-    std::string               moduleTag;
-    
+    bool                      doCorrelations_, doTimeSeries_;
+    float                     outlierNSigma_;
+    unsigned int              minFitEntries_;
+    int                       trendLength_;
+    size_t                    fetchStage_, fillStage_;
+    IntensityInfoDQMTimeSeries time_series_;                          // all events, in arrival order
+    IntensityInfoDQMCorrelations*   correlations_[kNSpillStates];    // indexed by SpillState, NULL unless "Correlations" is requested
+    std::vector<std::pair<std::string, std::unique_ptr<IntensityInfoDQMCorrelations>>> correlation_sets_; // sender directory -> set
   };
 } // namespace ots
 
 ots::IntensityInfoDQM::IntensityInfoDQM(Parameters const& conf)
-  : art::EDAnalyzer(conf), conf_(conf()), port_(conf().port()), address_(conf().address()),
-    moduleTag_(conf().moduleTag()), histType_(conf().histType()), 
-    freqDQM_(conf().freqDQM()), diagLevel_(conf().diag()), evtCounter_(0), 
-    doOnspillHist_(false), doOffspillHist_(false) {
-  histSender_  = new HistoSender(address_, port_);
-  
-  if (diagLevel_>0){
-    __MOUT__ << "[IntensityInfoDQM::analyze] DQM for "<< histType_[0] << std::endl;
+  : DQMModule<IntensityInfoDQMHistoContainer>(conf, conf().dqm(), "IntensityInfo"), conf_(conf()),
+    doCorrelations_(hasHistType("Correlations")), doTimeSeries_(hasHistType("TimeSeries")),
+    outlierNSigma_(conf().outlierNSigma()), minFitEntries_(conf().minFitEntries()),
+    trendLength_(conf().trendLength()), fetchStage_(addStage("fetch")), fillStage_(addStage("fill")),
+    correlations_{NULL, NULL} {}
+
+void ots::IntensityInfoDQM::beginJob() {
+  __MOUT__ << "[IntensityInfoDQM::beginJob] Beginning job" << std::endl;
+
+  if (doTimeSeries_) {
+    time_series_.Setup(conf_.timeSeriesBuckets(), conf_.timeSeriesBucketSize());
+    time_series_.BookHistos(tfs);
   }
+  bookSpillSets();
+  reportMemory();
+}
 
-  for (std::string name : histType_) {
-    if (name == "Onspill") {
-      doOnspillHist_ = true;
-    }
-    if (name == "Offspill") {
-      doOffspillHist_ = true;
-    }
+// the correlations follow the spill split of the summary sets
+void ots::IntensityInfoDQM::book_set(SpillState spill, const std::string& Suffix) {
+  if (!doCorrelations_) return;
+  IntensityInfoDQMCorrelations* corr = new IntensityInfoDQMCorrelations("IntensityInfo_correlations"+Suffix);
+  book_correlations(corr, spill);
+  correlation_sets_.emplace_back(moduleTag_+"_correlations"+Suffix, std::unique_ptr<IntensityInfoDQMCorrelations>(corr));
+  if (Suffix.empty()) {
+    correlations_[kOnspill]  = corr;
+    correlations_[kOffspill] = corr;
+  } else {
+    correlations_[spill] = corr;
   }
 }
 
-void ots::IntensityInfoDQM::beginJob() {
-  __MOUT__ << "[IntensityInfoDQM::beginJob] Beginning job" << std::endl;
-  summary_histos->BookSummaryHistos(tfs,
-				    "CAPHRI hits; nCAPHRIHits; Events",
-				    100, 0, 100);
-  //caloInfo
-  summary_histos->BookSummaryHistos(tfs,
-				    "IntensityInfo Calo, nHits; nCaloHits; Events/60"  ,
-				    200, 0, 12e3);
-  summary_histos->BookSummaryHistos(tfs,
-				    "IntensityInfo Calo, caloEnergy; E[MeV]; Events/(5 MeV)"  , 
-				    400, 0, 2e3);
-
-  //tracker info
-  summary_histos->BookSummaryHistos(tfs,
-				    "IntensityInfo Tracker; nTrkHits", 200, 0, 12e3);
+void ots::IntensityInfoDQM::book_summary(IntensityInfoDQMHistoContainer *histos, SpillState spill) {
+  bookSchema(histos, tfs, spill == kOffspill ? IntensityInfoDQMHistoContainer::kOffspillSchema :
+	                                       IntensityInfoDQMHistoContainer::kOnspillSchema);
+}
+
+void ots::IntensityInfoDQM::book_correlations(IntensityInfoDQMCorrelations *corr, SpillState spill) {
+  //same ranges as the 1D summaries, coarser binning
+  const bool offspill = (spill == kOffspill);
+  IntensityInfoDQMCorrelations::proxyAxis_ axes[IntensityInfoDQMCorrelations::kNProxies] = {
+    { "nCAPHRIHits", offspill ? 10 : 100, 0, offspill ? 10.f  : 100.f  },
+    { "nCaloHits"  , 100                , 0, offspill ? 400.f : 12e3f  },
+    { "caloEnergy" , 100                , 0, offspill ? 500.f : 2e3f   },
+    { "nTrkHits"   , 100                , 0, offspill ? 400.f : 12e3f  }
+  };
+  corr->Setup(outlierNSigma_, minFitEntries_, trendLength_);
+  corr->BookHistos(tfs, axes);
 }
 
 void ots::IntensityInfoDQM::analyze(art::Event const& event) {
   ++evtCounter_;
  
+  DQMStageTimers::Scope fetch = timeStage(fetchStage_);
   auto const caphriH   = event.getValidHandle<mu2e::CaloHitCollection>("CaloHitMakerFast::caphri");
   const mu2e::CaloHitCollection         *caphriHits = caphriH.product();
   
@@ -119,25 +130,39 @@ void ots::IntensityInfoDQM::analyze(art::Event const& event) {
 
   auto const trkH   = event.getValidHandle<mu2e::IntensityInfoTrackerHits>("TTmakeSH");
   const mu2e::IntensityInfoTrackerHits  *trkInfos = trkH.product();
-
-  
-  summary_fill(summary_histos, caphriHits, caloInfos, trkInfos);
-  
-
-  if (evtCounter_ % freqDQM_  != 0) return;
-
-  //send a packet AND reset the histograms
-  std::map<std::string,std::vector<TH1*>>   hists_to_send;
-  
-  //send the summary hists
-  for (size_t i = 0; i < summary_histos->histograms.size(); i++) {
-    __MOUT__ << "[IntensityInfoDQM::analyze] collecting summary histogram "<< summary_histos->histograms[i]._Hist << std::endl;
-    hists_to_send[moduleTag_+"_summary"].push_back((TH1*)summary_histos->histograms[i]._Hist->Clone());
-    summary_histos->histograms[i]._Hist->Reset();
+  fetch.stop();
+
+  DQMStageTimers::Scope           fill   = timeStage(fillStage_);
+  SpillState                      spill  = spillState(event);
+  IntensityInfoDQMHistoContainer* histos = summarySet(spill);
+  if (histos) {
+    summary_fill(histos, caphriHits, caloInfos, trkInfos);
+    histos->fillBuffer.Flush();
+  }
+  if (correlations_[spill]) {
+    double values[IntensityInfoDQMCorrelations::kNProxies] = {
+      double(caphriHits->size()), double(caloInfos->nCaloHits()),
+      double(caloInfos->caloEnergy()), double(trkInfos->nTrackerHits()) };
+    correlations_[spill]->fill(values);
+  }
+  if (doTimeSeries_) {
+    time_series_.fill(eventWindowTag(event), caphriHits->size(), caloInfos->caloEnergy(), trkInfos->nTrackerHits());
   }
+  fill.stop();
 
-  histSender_->sendHistograms(hists_to_send);
+  publishIfDue();
+}
+
+void ots::IntensityInfoDQM::collect_extra(packet_t& packet) {
+  for (auto& set : correlation_sets_) set.second->publish(packet, set.first);
+  if (doTimeSeries_) time_series_.publish(packet, moduleTag_+"_timeseries");
+}
 
+ots::DQMMemoryUsage ots::IntensityInfoDQM::memory_extra() const {
+  DQMMemoryUsage usage;
+  for (auto& set : correlation_sets_) usage += set.second->memoryUsage();
+  if (doTimeSeries_) usage += time_series_.memoryUsage();
+  return usage;
 }
 
 
@@ -145,19 +170,11 @@ void ots::IntensityInfoDQM::summary_fill(IntensityInfoDQMHistoContainer       *h
 					 const mu2e::CaloHitCollection        *CAPHRIHits,
 					 const mu2e::IntensityInfoCalo        *CaloInfos, 
 					 const mu2e::IntensityInfoTrackerHits *TrkInfos) {
-  //  __MOUT__ << "filling Summary histograms..."<< std::endl;
-
-  if (histos->histograms.size() == 0) {
-    __MOUT__ << "No histograms booked. Should they have been created elsewhere?"
-	     << std::endl;
-  } else {
-      
-    // Used to get the number of triggered events from each trigger path
-    histos->histograms[0]._Hist->Fill(CAPHRIHits->size()); 
-    histos->histograms[1]._Hist->Fill(CaloInfos->nCaloHits());
-    histos->histograms[2]._Hist->Fill(CaloInfos->caloEnergy());
-    histos->histograms[3]._Hist->Fill(TrkInfos->nTrackerHits());
-  }
+  //the values are only buffered here, the histograms are filled once per event
+  schemaFill(histos, IntensityInfoDQMHistoContainer::kCAPHRIHits  , CAPHRIHits->size());
+  schemaFill(histos, IntensityInfoDQMHistoContainer::kCaloHits    , CaloInfos->nCaloHits());
+  schemaFill(histos, IntensityInfoDQMHistoContainer::kCaloEnergy  , CaloInfos->caloEnergy());
+  schemaFill(histos, IntensityInfoDQMHistoContainer::kTrackerHits , TrkInfos->nTrackerHits());
 }
 
 void ots::IntensityInfoDQM::endJob() {}
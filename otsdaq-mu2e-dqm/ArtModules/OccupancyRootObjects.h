@@ -6,7 +6,11 @@
 #include "art_root_io/TFileService.h"
 #include "art_root_io/TFileDirectory.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "cetlib_except/exception.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMSparseHist2D.h"
 #include <string>
+#include <vector>
+#include <TDirectory.h>
 #include <TH1F.h>
 #include <TH2F.h>
 
@@ -18,18 +22,35 @@ class OccupancyRootObjects
     public:
 	    OccupancyRootObjects(const std::string Title) : _title(Title){};
         OccupancyRootObjects(){};
-	    virtual ~OccupancyRootObjects(void){};
+	    virtual ~OccupancyRootObjects(void){
+            for (int i=0; i<kNOcc; ++i){
+                for (int j=0; j<kNOccVar; ++j) delete Hist._s2DOccInfo[i][j];
+            }
+        };
+        // the sparse histograms are owned: no copies
+        OccupancyRootObjects(const OccupancyRootObjects&)            = delete;
+        OccupancyRootObjects& operator=(const OccupancyRootObjects&) = delete;
         enum {kNOcc=40,kNOccVar= 10};
 
+        // the 2D occupancy-vs-intensity plots are accumulated at full
+        // resolution in sparse histograms; the TH2F are only the reduced
+        // resolution targets they are projected on by UpdateHistos()
+        enum {kNLumBins=1000, kNDigiBins=5000, kDisplayRebinLum=10, kDisplayRebinDigi=20,
+              kNLumDisplay=kNLumBins/kDisplayRebinLum, kNDigiDisplay=kNDigiBins/kDisplayRebinDigi};
+        static constexpr double kLumMin  = 1e6, kLumMax  = 4e8;
+        static constexpr double kDigiMin = 0. , kDigiMax = 20000.;
+
         struct  occupancyHist_    {
-        TH1F *_hOccInfo  [kNOcc][kNOccVar];
-        TH2F *_h2DOccInfo[kNOcc][kNOccVar];
+        TH1F            *_hOccInfo  [kNOcc][kNOccVar];
+        TH2F            *_h2DOccInfo[kNOcc][kNOccVar];
+        DQMSparseHist2D *_s2DOccInfo[kNOcc][kNOccVar];
 
         occupancyHist_ (){
         for (int i=0; i<kNOcc; ++i){ 
             for (int j=0; j<kNOccVar; ++j){
                 _hOccInfo    [i][j] = NULL;
                 _h2DOccInfo  [i][j] = NULL;
+                _s2DOccInfo  [i][j] = NULL;
             }
         }
       }
@@ -38,73 +59,125 @@ class OccupancyRootObjects
     const std::string _title;
     occupancyHist_ Hist;
 
+    // the general set is booked after the track, helix and calo trigger groups
+    static unsigned int generalIndex(size_t _nTrackTrig, size_t _nCaloTrig){
+        return _nTrackTrig*2 + _nCaloTrig;
+    }
+
+    void Fill2D(unsigned int i, unsigned int j, double x, double y){
+        if (Hist._s2DOccInfo[i][j]) Hist._s2DOccInfo[i][j]->Fill(x, y);
+    }
+
+    // project the sparse accumulators on the display histograms, O(occupied cells)
+    void UpdateHistos(){
+        for (int i=0; i<kNOcc; ++i){
+            for (int j=0; j<kNOccVar; ++j){
+                if (Hist._s2DOccInfo[i][j]) Hist._s2DOccInfo[i][j]->FillTH2(Hist._h2DOccInfo[i][j]);
+            }
+        }
+    }
+
+    // all the booked histograms, in booking order
+    void CollectHistos(std::vector<TObject*>& objects){
+        for (int i=0; i<kNOcc; ++i){
+            for (int j=0; j<kNOccVar; ++j){
+                if (Hist._hOccInfo  [i][j]) objects.push_back(Hist._hOccInfo  [i][j]);
+                if (Hist._h2DOccInfo[i][j]) objects.push_back(Hist._h2DOccInfo[i][j]);
+            }
+        }
+    }
+
     void BookHistos(art::ServiceHandle<art::TFileService>  Tfs, size_t _nTrackTrig, size_t _nCaloTrig){
+        checkIndexRange(_nTrackTrig, _nCaloTrig);
         
         for (unsigned int i=0; i<_nTrackTrig; ++i){
             art::TFileDirectory occInfoDir = Tfs->mkdir(Form("occInfoTrk_%i", i));
             this->Hist._hOccInfo  [i][0]  = occInfoDir.make<TH1F>(Form("hInstLum_%i"  ,i),"distrbution of instantaneous lum; p/#mu-bunch"  ,  1000, 1e6, 4e8);
 
-            this->Hist._h2DOccInfo[i][0]  = occInfoDir.make<TH2F>(Form("hNSDVsLum_%i" ,i),"inst lum vs nStrawDigi; p/#mu-bunch; nStrawDigi",  1000, 1e6, 4e8, 5000, 0., 20000.);
-            this->Hist._h2DOccInfo[i][1]  = occInfoDir.make<TH2F>(Form("hNCDVsLum_%i" ,i),"inst lum vs nCaloDigi; p/#mu-bunch; nCaloDigi"  ,  1000, 1e6, 4e8, 5000, 0., 20000.);
+            this->Hist._h2DOccInfo[i][0]  = occInfoDir.make<TH2F>(Form("hNSDVsLum_%i" ,i),"inst lum vs nStrawDigi; p/#mu-bunch; nStrawDigi",  kNLumDisplay, kLumMin, kLumMax, kNDigiDisplay, kDigiMin, kDigiMax);
+            this->Hist._h2DOccInfo[i][1]  = occInfoDir.make<TH2F>(Form("hNCDVsLum_%i" ,i),"inst lum vs nCaloDigi; p/#mu-bunch; nCaloDigi"  ,  kNLumDisplay, kLumMin, kLumMax, kNDigiDisplay, kDigiMin, kDigiMax);
          }
         
         for (unsigned int i=_nTrackTrig; i<_nTrackTrig*2; ++i){
             art::TFileDirectory occInfoDir = Tfs->mkdir(Form("occInfoHel_%i", i));
             this->Hist._hOccInfo  [i][0]  = occInfoDir.make<TH1F>(Form("hInstLum_%i"  ,i),"distrbution of instantaneous lum; p/#mu-bunch"  ,  1000, 1e6, 4e8);
 
-            this->Hist._h2DOccInfo[i][0]  = occInfoDir.make<TH2F>(Form("hNSDVsLum_%i" ,i),"inst lum vs nStrawDigi; p/#mu-bunch; nStrawDigi",  1000, 1e6, 4e8, 5000, 0., 20000.);
-            this->Hist._h2DOccInfo[i][1]  = occInfoDir.make<TH2F>(Form("hNCDVsLum_%i" ,i),"inst lum vs nCaloDigi; p/#mu-bunch; nCaloDigi"  ,  1000, 1e6, 4e8, 5000, 0., 20000.);
+            this->Hist._h2DOccInfo[i][0]  = occInfoDir.make<TH2F>(Form("hNSDVsLum_%i" ,i),"inst lum vs nStrawDigi; p/#mu-bunch; nStrawDigi",  kNLumDisplay, kLumMin, kLumMax, kNDigiDisplay, kDigiMin, kDigiMax);
+            this->Hist._h2DOccInfo[i][1]  = occInfoDir.make<TH2F>(Form("hNCDVsLum_%i" ,i),"inst lum vs nCaloDigi; p/#mu-bunch; nCaloDigi"  ,  kNLumDisplay, kLumMin, kLumMax, kNDigiDisplay, kDigiMin, kDigiMax);
         }
     
         for (unsigned int i=_nTrackTrig*2; i<_nTrackTrig*2+_nCaloTrig; ++i){
             art::TFileDirectory occInfoDir = Tfs->mkdir(Form("occInfoCaloTrig_%i", i));
             this->Hist._hOccInfo  [i][0]  = occInfoDir.make<TH1F>(Form("hInstLum_%i"  ,i),"distrbution of instantaneous lum; p/#mu-bunch"  ,  1000, 1e6, 4e8);
 		                
-            this->Hist._h2DOccInfo[i][0]  = occInfoDir.make<TH2F>(Form("hNSDVsLum_%i" ,i),"inst lum vs nStrawDigi; p/#mu-bunch; nStrawDigi",  1000, 1e6, 4e8, 5000, 0., 20000.);
-            this->Hist._h2DOccInfo[i][1]  = occInfoDir.make<TH2F>(Form("hNCDVsLum_%i" ,i),"inst lum vs nCaloDigi; p/#mu-bunch; nCaloDigi"  ,  1000, 1e6, 4e8, 5000, 0., 20000.);
+            this->Hist._h2DOccInfo[i][0]  = occInfoDir.make<TH2F>(Form("hNSDVsLum_%i" ,i),"inst lum vs nStrawDigi; p/#mu-bunch; nStrawDigi",  kNLumDisplay, kLumMin, kLumMax, kNDigiDisplay, kDigiMin, kDigiMax);
+            this->Hist._h2DOccInfo[i][1]  = occInfoDir.make<TH2F>(Form("hNCDVsLum_%i" ,i),"inst lum vs nCaloDigi; p/#mu-bunch; nCaloDigi"  ,  kNLumDisplay, kLumMin, kLumMax, kNDigiDisplay, kDigiMin, kDigiMax);
         }
     
-        unsigned int    index_last = _nTrackTrig+_nCaloTrig;
+        unsigned int    index_last = generalIndex(_nTrackTrig, _nCaloTrig);
         art::TFileDirectory occInfoDir = Tfs->mkdir("occInfoGeneral");
         this->Hist._hOccInfo  [index_last][0]  = occInfoDir.make<TH1F>(Form("hInstLum_%i"  ,index_last),"distrbution of instantaneous lum; p/#mu-bunch"  ,  1000, 1e6, 4e8);
 
-        this->Hist._h2DOccInfo[index_last][0]  = occInfoDir.make<TH2F>(Form("hNSDVsLum_%i" ,index_last),"inst lum vs nStrawDigi; p/#mu-bunch; nStrawDigi",  1000, 1e6, 4e8, 5000, 0., 20000.);
-        this->Hist._h2DOccInfo[index_last][1]  = occInfoDir.make<TH2F>(Form("hNCDVsLum_%i" ,index_last),"inst lum vs nCaloDigi; p/#mu-bunch; nCaloDigi"  ,  1000, 1e6, 4e8, 5000, 0., 20000.);
+        this->Hist._h2DOccInfo[index_last][0]  = occInfoDir.make<TH2F>(Form("hNSDVsLum_%i" ,index_last),"inst lum vs nStrawDigi; p/#mu-bunch; nStrawDigi",  kNLumDisplay, kLumMin, kLumMax, kNDigiDisplay, kDigiMin, kDigiMax);
+        this->Hist._h2DOccInfo[index_last][1]  = occInfoDir.make<TH2F>(Form("hNCDVsLum_%i" ,index_last),"inst lum vs nCaloDigi; p/#mu-bunch; nCaloDigi"  ,  kNLumDisplay, kLumMin, kLumMax, kNDigiDisplay, kDigiMin, kDigiMax);
+
+        bookSparse();
     }
 
     void BookHistos(TDirectory *occInfoDir, size_t _nTrackTrig, size_t _nCaloTrig){
+        checkIndexRange(_nTrackTrig, _nCaloTrig);
         
         for (unsigned int i=0; i<_nTrackTrig; ++i){
             occInfoDir->mkdir(Form("occInfoTrk_%i", i));
             this->Hist._hOccInfo  [i][0]  =  new TH1F(Form("hInstLum_%i"  ,i),"distrbution of instantaneous lum; p/#mu-bunch"  ,  1000, 1e6, 4e8);
 
-            this->Hist._h2DOccInfo[i][0]  = new TH2F(Form("hNSDVsLum_%i" ,i),"inst lum vs nStrawDigi; p/#mu-bunch; nStrawDigi",  1000, 1e6, 4e8, 5000, 0., 20000.);
-            this->Hist._h2DOccInfo[i][1]  = new TH2F(Form("hNCDVsLum_%i" ,i),"inst lum vs nCaloDigi; p/#mu-bunch; nCaloDigi"  ,  1000, 1e6, 4e8, 5000, 0., 20000.);
+            this->Hist._h2DOccInfo[i][0]  = new TH2F(Form("hNSDVsLum_%i" ,i),"inst lum vs nStrawDigi; p/#mu-bunch; nStrawDigi",  kNLumDisplay, kLumMin, kLumMax, kNDigiDisplay, kDigiMin, kDigiMax);
+            this->Hist._h2DOccInfo[i][1]  = new TH2F(Form("hNCDVsLum_%i" ,i),"inst lum vs nCaloDigi; p/#mu-bunch; nCaloDigi"  ,  kNLumDisplay, kLumMin, kLumMax, kNDigiDisplay, kDigiMin, kDigiMax);
          }
         
         for (unsigned int i=_nTrackTrig; i<_nTrackTrig*2; ++i){
             occInfoDir->mkdir(Form("occInfoHel_%i", i));
             this->Hist._hOccInfo  [i][0]  =  new TH1F(Form("hInstLum_%i"  ,i),"distrbution of instantaneous lum; p/#mu-bunch"  ,  1000, 1e6, 4e8);
 
-            this->Hist._h2DOccInfo[i][0]  = new TH2F(Form("hNSDVsLum_%i" ,i),"inst lum vs nStrawDigi; p/#mu-bunch; nStrawDigi",  1000, 1e6, 4e8, 5000, 0., 20000.);
-            this->Hist._h2DOccInfo[i][1]  = new TH2F(Form("hNCDVsLum_%i" ,i),"inst lum vs nCaloDigi; p/#mu-bunch; nCaloDigi"  ,  1000, 1e6, 4e8, 5000, 0., 20000.);
+            this->Hist._h2DOccInfo[i][0]  = new TH2F(Form("hNSDVsLum_%i" ,i),"inst lum vs nStrawDigi; p/#mu-bunch; nStrawDigi",  kNLumDisplay, kLumMin, kLumMax, kNDigiDisplay, kDigiMin, kDigiMax);
+            this->Hist._h2DOccInfo[i][1]  = new TH2F(Form("hNCDVsLum_%i" ,i),"inst lum vs nCaloDigi; p/#mu-bunch; nCaloDigi"  ,  kNLumDisplay, kLumMin, kLumMax, kNDigiDisplay, kDigiMin, kDigiMax);
         }
     
         for (unsigned int i=_nTrackTrig*2; i<_nTrackTrig*2+_nCaloTrig; ++i){
             occInfoDir->mkdir(Form("occInfoCaloTrig_%i", i));
             this->Hist._hOccInfo  [i][0]  =  new TH1F(Form("hInstLum_%i"  ,i),"distrbution of instantaneous lum; p/#mu-bunch"  ,  1000, 1e6, 4e8);
 		                
-            this->Hist._h2DOccInfo[i][0]  = new TH2F(Form("hNSDVsLum_%i" ,i),"inst lum vs nStrawDigi; p/#mu-bunch; nStrawDigi",  1000, 1e6, 4e8, 5000, 0., 20000.);
-            this->Hist._h2DOccInfo[i][1]  = new TH2F(Form("hNCDVsLum_%i" ,i),"inst lum vs nCaloDigi; p/#mu-bunch; nCaloDigi"  ,  1000, 1e6, 4e8, 5000, 0., 20000.);
+            this->Hist._h2DOccInfo[i][0]  = new TH2F(Form("hNSDVsLum_%i" ,i),"inst lum vs nStrawDigi; p/#mu-bunch; nStrawDigi",  kNLumDisplay, kLumMin, kLumMax, kNDigiDisplay, kDigiMin, kDigiMax);
+            this->Hist._h2DOccInfo[i][1]  = new TH2F(Form("hNCDVsLum_%i" ,i),"inst lum vs nCaloDigi; p/#mu-bunch; nCaloDigi"  ,  kNLumDisplay, kLumMin, kLumMax, kNDigiDisplay, kDigiMin, kDigiMax);
         }
     
-        unsigned int    index_last = _nTrackTrig+_nCaloTrig;
+        unsigned int    index_last = generalIndex(_nTrackTrig, _nCaloTrig);
         occInfoDir->mkdir("occInfoGeneral");
         this->Hist._hOccInfo  [index_last][0]  =  new TH1F(Form("hInstLum_%i"  ,index_last),"distrbution of instantaneous lum; p/#mu-bunch"  ,  1000, 1e6, 4e8);
 
-        this->Hist._h2DOccInfo[index_last][0]  =  new TH2F(Form("hNSDVsLum_%i" ,index_last),"inst lum vs nStrawDigi; p/#mu-bunch; nStrawDigi",  1000, 1e6, 4e8, 5000, 0., 20000.);
-        this->Hist._h2DOccInfo[index_last][1]  = new TH2F(Form("hNCDVsLum_%i" ,index_last),"inst lum vs nCaloDigi; p/#mu-bunch; nCaloDigi"  ,  1000, 1e6, 4e8, 5000, 0., 20000.);
-    
+        this->Hist._h2DOccInfo[index_last][0]  =  new TH2F(Form("hNSDVsLum_%i" ,index_last),"inst lum vs nStrawDigi; p/#mu-bunch; nStrawDigi",  kNLumDisplay, kLumMin, kLumMax, kNDigiDisplay, kDigiMin, kDigiMax);
+        this->Hist._h2DOccInfo[index_last][1]  = new TH2F(Form("hNCDVsLum_%i" ,index_last),"inst lum vs nCaloDigi; p/#mu-bunch; nCaloDigi"  ,  kNLumDisplay, kLumMin, kLumMax, kNDigiDisplay, kDigiMin, kDigiMax);
+
+        bookSparse();
+    }
+
+    private:
+    void checkIndexRange(size_t _nTrackTrig, size_t _nCaloTrig){
+        if (generalIndex(_nTrackTrig, _nCaloTrig) >= kNOcc){
+            throw cet::exception("OccupancyRootObjects")
+                << "too many trigger groups: nTrackTriggers=" << _nTrackTrig
+                << ", nCaloTriggers=" << _nCaloTrig << " (max " << kNOcc << " sets)";
+        }
+    }
+
+    // one full-resolution accumulator per booked display histogram
+    void bookSparse(){
+        for (int i=0; i<kNOcc; ++i){
+            for (int j=0; j<kNOccVar; ++j){
+                if (!Hist._h2DOccInfo[i][j] || Hist._s2DOccInfo[i][j]) continue;
+                Hist._s2DOccInfo[i][j] = new DQMSparseHist2D(kNLumBins, kLumMin, kLumMax, kNDigiBins, kDigiMin, kDigiMax);
+            }
+        }
     }
 };
 
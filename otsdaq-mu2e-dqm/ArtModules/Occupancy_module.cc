@@ -7,89 +7,30 @@
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/Handle.h"
 #include "art/Framework/Principal/Run.h"
-#include "canvas/Utilities/InputTag.h"
 #include "art_root_io/TFileService.h"
-#include "art_root_io/TFileDirectory.h"
 #include "canvas/Persistency/Common/TriggerResults.h"
-#include "art/Framework/Services/System/TriggerNamesService.h"
-#include "cetlib_except/exception.h"
+#include "canvas/Utilities/InputTag.h"
 #include "fhiclcpp/ParameterSet.h"
-#include "fhiclcpp/ParameterSetRegistry.h"
-
-#include "artdaq-core/Data/ContainerFragment.hh"
-#include "artdaq-core/Data/Fragment.hh"
-#include "artdaq/DAQdata/Globals.hh"
-
-#include "cetlib_except/exception.h"
-
-//OTS:
-#include "otsdaq/Macros/CoutMacros.h"
-#include "otsdaq/MessageFacility/MessageFacility.h"
 
 //ROOT:
-//#include "art/Framework/Services/Optional/TFileService.h"
-#include "art_root_io/TFileService.h" 
-#include <TBufferFile.h>
 #include <TH1F.h>
 #include <TH2F.h>
-#include <TH1.h>
-#include <TProfile.h>
 
 //Offline:
-#include <ConditionsService/inc/AcceleratorParams.hh>
-#include <ConditionsService/inc/ConditionsHandle.hh>
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wtype-limits" 
-#pragma GCC diagnostic ignored "-Wpedantic"
-#include <BFieldGeom/inc/BFieldManager.hh>
-#include <TrackerGeom/inc/Tracker.hh>
-//#include <GlobalConstantsService/inc/GlobalConstantsHandle.hh">
-#pragma GCC diagnostic pop
-
-#include <GeometryService/inc/GeomHandle.hh>
-#include <GeometryService/inc/DetectorSystem.hh>
-#include <RecoDataProducts/inc/CaloCluster.hh>
-#include <RecoDataProducts/inc/CaloTrigSeed.hh>
-#include <RecoDataProducts/inc/HelixSeed.hh>
-#include <RecoDataProducts/inc/KalSeed.hh>
-#include <RecoDataProducts/inc/TriggerInfo.hh>
-#include <RecoDataProducts/inc/ComboHit.hh>
-#include <RecoDataProducts/inc/StrawDigi.hh>
-#include <RecoDataProducts/inc/StrawDigiCollection.hh>
-#include <RecoDataProducts/inc/CaloDigi.hh>
-#include <RecoDataProducts/inc/CaloDigiCollection.hh>
-#include <DataProducts/inc/XYZVec.hh>
-
-#include <MCDataProducts/inc/SimParticle.hh>
-#include <MCDataProducts/inc/SimParticleCollection.hh>
-#include <MCDataProducts/inc/StrawDigiMC.hh>
-#include <MCDataProducts/inc/StrawDigiMCCollection.hh>
-#include <MCDataProducts/inc/StepPointMC.hh>
-#include <MCDataProducts/inc/StepPointMCCollection.hh>
-#include <MCDataProducts/inc/ProtonBunchIntensity.hh>
-
-
-#include <GlobalConstantsService/inc/ParticleDataTable.hh>
-
-//Utilities
-#include <Mu2eUtilities/inc/TriggerResultsNavigator.hh>
-#include <Mu2eUtilities/inc/HelixTool.hh>
+#include "Offline/MCDataProducts/inc/ProtonBunchIntensity.hh"
+#include "Offline/RecoDataProducts/inc/CaloDigi.hh"
+#include "Offline/RecoDataProducts/inc/StrawDigi.hh"
 
 //OTS:
-#include "otsdaq-dqm/ArtModules/OccupancyRootObjects.h"
-#include "otsdaq/MessageFacility/MessageFacility.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMPeriodicPublisher.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMTriggerTable.h"
+#include "otsdaq-mu2e-dqm/ArtModules/OccupancyRootObjects.h"
 #include "otsdaq/Macros/CoutMacros.h"
-#include "otsdaq/Macros/ProcessorPluginMacros.h"
+#include "otsdaq/MessageFacility/MessageFacility.h"
 #include "otsdaq/NetworkUtilities/TCPPublishServer.h"
+
 //C++:
-#include <algorithm>
-#include <functional>
-#include <initializer_list>
-#include <iostream>
-#include <limits>
-#include <numeric>
-#include <sstream>
-#include <unordered_map>
+#include <string>
 #include <vector>
 
 namespace ots
@@ -105,7 +46,6 @@ namespace ots
         void beginJob() override;
         void endJob() override;
 	   
-        void PlotOccupancu(art::Event const& e);
     private:
         art::RunNumber_t current_run_;
         std::string outputFileName_;
@@ -114,28 +54,30 @@ namespace ots
         bool doStreaming_;
         bool overwrite_mode_;
 
-        art::InputTag _trigAlgTag;
         art::InputTag _evtWeightTag;
         art::InputTag _cdTag;
         art::InputTag _sdTag;
  
         double _duty_cycle;
-        string _processName;
+        std::string _processName;
 
         float _nProcess;
         size_t _nTrackTrig;
         size_t _nCaloTrig;
-        double _bz0;
+        std::vector<std::string> _trigPaths;
         double _nPOT;
-          
-        const mu2e::Tracker*      _tracker;
-        const mu2e::StrawDigiCollection* SDCol; 
-        const mu2e::CaloDigiCollection* CDCol;
-      
-        const art::Event*                  _event;
+
         OccupancyRootObjects *rootobjects = new OccupancyRootObjects("occ_plots");
         TCPPublishServer *tcp ;
-       
+        DQMPeriodicPublisher *publisher_;
+        std::vector<TObject*> publishSet_;
+        DQMTriggerTable       trigTable_;   // rebuilt when the trigger menu changes
+
+        void publish_();
+        void fillEvent_(art::Event const& event);
+        void fillGroup_(unsigned int Index, int nSD, int nCD);
+        int  groupIndex_(const DQMTriggerTable::module_& Module) const;
+
     };
 }
 
@@ -150,18 +92,29 @@ ots::Occupancy::Occupancy(fhicl::ParameterSet const& pset)
     _cdTag         (pset.get<art::InputTag>("caloDigiCollection"   , "CaloDigiFromShower")),
     _sdTag         (pset.get<art::InputTag>("strawDigiCollection"  , "makeSD")),
     _duty_cycle    (pset.get<float> ("dutyCycle", 1.)),
-    _processName   (pset.get<string> ("processName", "globalTrigger")),
+    _processName   (pset.get<std::string> ("processName", "globalTrigger")),
     _nProcess      (pset.get<float> ("nEventsProcessed", 1.)),
     _nTrackTrig    (pset.get<size_t>("nTrackTriggers", 4)),
     _nCaloTrig     (pset.get<size_t>("nCaloTriggers", 4)),
-tcp(new TCPPublishServer(pset.get<int>("listenPort", 6000)))
+    _trigPaths     (pset.get<std::vector<std::string>>("triggerPathsList", std::vector<std::string>())),
+    _nPOT          (-1.),
+    tcp(new TCPPublishServer(pset.get<int>("listenPort", 6000))),
+    publisher_(new DQMPeriodicPublisher(tcp, "Occupancy",
+                                        pset.get<int>   ("publishEveryNEvents"   , 1000),
+                                        pset.get<double>("publishIntervalSeconds", 5.),
+                                        DQMPeriodicPublisher::format(pset.get<std::string>("packetFormat", "objects"))))
   {
     TLOG_INFO("Occupancy") << "Occuapncy Plotter construction is beginning " << TLOG_ENDL;
      
 	TLOG_DEBUG("Occupancy") << "TriggerRate Plotter construction complete" << TLOG_ENDL;
  }
 
-ots::Occupancy::~Occupancy() {}
+ots::Occupancy::~Occupancy()
+{
+    delete publisher_;
+    delete tcp;
+    delete rootobjects;
+}
 
 
 
@@ -169,28 +122,38 @@ void ots::Occupancy::beginJob(){
   TLOG_INFO("Occupancy - StartingJob")
 	    << "Started" << TLOG_ENDL;
     rootobjects->BookHistos(tfs, _nTrackTrig, _nCaloTrig);
+    rootobjects->CollectHistos(publishSet_);
 }
 
-void ots::Occupancy::analyze(art::Event const& event)
+void ots::Occupancy::publish_()
 {
-    TLOG_INFO("TriggerRate - Plotter")
-    << "TriggerRate Plotting Module is Analyzing Event #  " << event.event() << TLOG_ENDL;
-    double value = 1;
-    //get the StrawDigi Collection
-    art::Handle<mu2e::StrawDigiCollection> sdH;
-    event.getByLabel(_sdTag, sdH);
-    //const StrawDigiCollection* sdCol(0);
-    if (sdH.isValid()) {
-      SDCol = sdH.product();
-    }
+    rootobjects->UpdateHistos();
+    publisher_->publish(publishSet_);
+}
 
-    //get the CaloDigi Collection
-    art::Handle<mu2e::CaloDigiCollection> cdH;
-    event.getByLabel(_cdTag, cdH);
-    //const CaloDigiCollection* cdCol(0);
-    if (cdH.isValid()) {
-      CDCol = cdH.product();
+// occupancy set of a trigger filter module, -1 if it has none
+int ots::Occupancy::groupIndex_(const DQMTriggerTable::module_& Module) const
+{
+    int nTrack = int(_nTrackTrig), nCalo = int(_nCaloTrig);
+    switch (Module.category) {
+    case DQMTriggerTable::kTrack:    return (Module.index < nTrack) ? Module.index            : -1;
+    case DQMTriggerTable::kHelix:    return (Module.index < nTrack) ? nTrack + Module.index   : -1;
+    case DQMTriggerTable::kCaloOnly: return (Module.index < nCalo ) ? 2*nTrack + Module.index : -1;
+    default:                         return -1;
     }
+}
+
+void ots::Occupancy::fillGroup_(unsigned int Index, int nSD, int nCD)
+{
+    rootobjects->Hist._hOccInfo[Index][0]->Fill(_nPOT);
+    rootobjects->Fill2D(Index, 0, _nPOT, nSD);
+    rootobjects->Fill2D(Index, 1, _nPOT, nCD);
+}
+
+void ots::Occupancy::analyze(art::Event const& event)
+{
+    TLOG_DEBUG("Occupancy")
+    << "Occupancy Plotting Module is Analyzing Event #  " << event.event() << TLOG_ENDL;
     _nPOT  = -1.;
     art::Handle<mu2e::ProtonBunchIntensity> evtWeightH;
     event.getByLabel(_evtWeightTag, evtWeightH);
@@ -198,24 +161,63 @@ void ots::Occupancy::analyze(art::Event const& event)
       _nPOT  = (double)evtWeightH->intensity();
     }
 
-    if (_nPOT < 0)  return;
-    int   nSD(-1), nCD(-1);
-    if (SDCol) nSD = SDCol->size();
-    if (CDCol) nCD = CDCol->size(); //TODO - Index
-    int Index = _nTrackTrig+_nCaloTrig;
-    rootobjects->Hist._hOccInfo  [Index][0]->Fill(_nPOT);
-    			    
-    rootobjects->Hist._h2DOccInfo[Index][0]->Fill(_nPOT, nSD);
-    rootobjects->Hist._h2DOccInfo[Index][1]->Fill(_nPOT, nCD);
-
-    TBufferFile message(TBuffer::kWrite);
-    message.WriteObject(rootobjects->Hist._hOccInfo[0][0]);
-    tcp->broadcastPacket(message.Buffer(), message.Length());
+    //an event without intensity is not plotted, but still counts for the
+    //publishing cadence
+    if (_nPOT >= 0) fillEvent_(event);
+
+    if (publisher_->isDue()) publish_();
+
+}
 
+void ots::Occupancy::fillEvent_(art::Event const& event)
+{
+    //get the StrawDigi Collection
+    art::Handle<mu2e::StrawDigiCollection> sdH;
+    event.getByLabel(_sdTag, sdH);
+
+    //get the CaloDigi Collection
+    art::Handle<mu2e::CaloDigiCollection> cdH;
+    event.getByLabel(_cdTag, cdH);
+
+    int   nSD(-1), nCD(-1);
+    if (sdH.isValid()) nSD = sdH->size();
+    if (cdH.isValid()) nCD = cdH->size(); //TODO - Index
+    fillGroup_(OccupancyRootObjects::generalIndex(_nTrackTrig, _nCaloTrig), nSD, nCD);
+
+    //fill every trigger group that accepted the event, one bit per group: a
+    //filter module running in several accepted paths fills its group once
+    art::Handle<art::TriggerResults> trigResultsH;
+    event.getByLabel(art::InputTag("TriggerResults", "", _processName), trigResultsH);
+    if (trigResultsH.isValid()) {
+      if (trigTable_.Update(*trigResultsH, _trigPaths)) {
+        trigTable_.buildMasks([this](const DQMTriggerTable::module_& m) { return groupIndex_(m); });
+        TLOG_DEBUG("Occupancy") << "Trigger table rebuilt: " << trigTable_.paths().size() << " paths, "
+                                << trigTable_.modules().size() << " modules" << TLOG_ENDL;
+        int nUnbooked(0);
+        for (const DQMTriggerTable::module_& m : trigTable_.modules()) {
+          bool grouped = m.category == DQMTriggerTable::kTrack || m.category == DQMTriggerTable::kHelix ||
+                         m.category == DQMTriggerTable::kCaloOnly;
+          if (grouped && groupIndex_(m) < 0) ++nUnbooked;
+        }
+        if (nUnbooked > 0) {
+          TLOG_WARNING("Occupancy") << nUnbooked << " trigger filter modules are beyond the booked sets (nTrackTriggers="
+                                    << _nTrackTrig << ", nCaloTriggers=" << _nCaloTrig << ") and are not plotted" << TLOG_ENDL;
+        }
+      }
+      uint64_t groups = trigTable_.acceptedMask(*trigResultsH);
+      while (groups) {
+        fillGroup_(__builtin_ctzll(groups), nSD, nCD);
+        groups &= groups - 1;
+      }
+    }
 }
 
 
   void ots::Occupancy::endJob(){
+    //the 2D plots live in the sparse accumulators until here
+    publish_();
+    TLOG_INFO("Occupancy - EndingJob")
+	    << "Broadcast " << publisher_->nPackets() << " packets, " << publisher_->nBytes() << " bytes" << TLOG_ENDL;
     TLOG_INFO("Occupancy - EndingJob")
 	    << "Completed" << TLOG_ENDL;
   }
@@ -7,6 +7,7 @@
 #include "art_root_io/TFileDirectory.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include <string>
+#include <TDirectory.h>
 #include <TH1F.h>
 
 namespace ots
@@ -0,0 +1,193 @@
+// This module runs the DQM of the tracker, the calorimeter and the CRV on the
+// DTC data of each event, fetched once and dispatched by subsystem to
+// handlers that run concurrently. The handlers are the fills of TrackerDQM,
+// CaloDQM and CrvDQM (TrackerDQMHandler, CaloDQMHandler, CrvDQMHandler): one
+// RawDQM replaces the three modules and shares the fetch of the event
+
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "fhiclcpp/types/TableFragment.h"
+
+#include <TH1F.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#include "Offline/TrkHitReco/inc/PeakFit.hh"
+#pragma GCC diagnostic pop
+#include "otsdaq-mu2e-dqm/ArtModules/CaloDQMHandler.h"
+#include "otsdaq-mu2e-dqm/ArtModules/CaloDQMHistoContainer.h"
+#include "otsdaq-mu2e-dqm/ArtModules/CrvDQMHandler.h"
+#include "otsdaq-mu2e-dqm/ArtModules/CrvDQMHistoContainer.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMFragmentDispatcher.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMModule.h"
+#include "otsdaq-mu2e-dqm/ArtModules/TrackerDQMHandler.h"
+#include "otsdaq-mu2e-dqm/ArtModules/TrackerDQMHistoContainer.h"
+#include "otsdaq/Macros/CoutMacros.h"
+#include "otsdaq/MessageFacility/MessageFacility.h"
+
+#include <memory>
+
+namespace ots {
+  class RawDQM : public DQMModule<TrackerDQMHistoContainer> {
+  public:
+    struct Config {
+      using Name = fhicl::Name;
+      using Comment = fhicl::Comment;
+      fhicl::TableFragment<DQMModuleConfig> dqm;
+      fhicl::Atom<int>             nThreads  { Name("nThreads"),  Comment("Threads of the handler arena (0: TBB default)"), 0 };
+      fhicl::Atom<int>             fittype   { Name("FitType"),   Comment("Waveform Fit Type") };
+      fhicl::Atom<float>           ringWidth { Name("ringWidth"), Comment("Radial width [mm] of the rings used for the crystal-map roll-up"), 34.4 };
+      fhicl::Atom<int>             crvTimeMax { Name("crvTimeMax"), Comment("Upper edge [TDC] of the per-ROC CRV hit-time histograms"), 4096 };
+    };
+
+    typedef art::EDAnalyzer::Table<Config> Parameters;
+
+    explicit RawDQM(Parameters const& conf);
+
+    void analyze(art::Event const& event) override;
+    void beginJob() override;
+    void beginRun(art::Run const&) override;
+
+    // the raw sets are not split by spill state
+    void book_summary(TrackerDQMHistoContainer* histos, SpillState spill) override {}
+
+    enum CaloRawHist { kCaloBlocks = 0, kCaloPackets, kCaloPacketsPerBlock, kNCaloRawHists };
+
+    static constexpr DQMHistSpec kCaloRawSchema[kNCaloRawHists] = {
+      { "Calo raw, data blocks; nBlocks; Events"          , 200, 0, 400  },
+      { "Calo raw, packets; nPackets; Events/10"          , 200, 0, 2000 },
+      { "Calo raw, packets per block; nPackets; Blocks"   , 100, 0, 100  }};
+    static_assert(schemaIsValid(kCaloRawSchema), "invalid Calo raw schema");
+
+  private:
+    void tracker_handler_(const DQMSubsystemFragments& frags);
+    void calo_handler_(const art::Event& event, const DQMSubsystemFragments& frags);
+    void crv_handler_(const DQMSubsystemFragments& frags);
+
+    void collect_extra(packet_t& packet) override;
+
+    // the calo, CRV, pedestal and panel sets are published through the
+    // manifest, only their buffers are extra; the crystal maps and the CRV
+    // channel bank are all extra
+    DQMMemoryUsage memory_extra() const override {
+      DQMMemoryUsage usage = tracker_.memoryUsage();
+      usage += calo_.memoryUsage();
+      usage += crv_.memoryUsage();
+      usage.buffers += calo_histos_->fillBuffer.capacityBytes() + calo_summary_->fillBuffer.capacityBytes() +
+	crv_histos_->fillBuffer.capacityBytes();
+      return usage;
+    }
+
+    TrackerDQMHistoContainer*               tracker_histos_;
+    std::unique_ptr<CaloDQMHistoContainer>  calo_histos_, calo_summary_;
+    std::unique_ptr<CrvDQMHistoContainer>   crv_histos_;
+    bool                                    doCaloSummary_, doCaloReco_;
+    TrackerDQMHandler                       tracker_;
+    CaloDQMHandler                          calo_;
+    CrvDQMHandler                           crv_;
+    DQMFragmentDispatcher                   dispatcher_;
+    size_t                                  dispatchStage_, trackerStage_, caloStage_, crvStage_;
+  };
+} // namespace ots
+
+ots::RawDQM::RawDQM(Parameters const& conf)
+  : DQMModule<TrackerDQMHistoContainer>(conf, conf().dqm(), "Raw"),
+    tracker_histos_(NULL), calo_histos_(new CaloDQMHistoContainer("Calo_raw")),
+    calo_summary_(new CaloDQMHistoContainer("Calo_summary")), crv_histos_(new CrvDQMHistoContainer("CRV_raw")),
+    doCaloSummary_(hasHistType("caloSummary")),
+    doCaloReco_(doCaloSummary_ || hasHistType("Crystals")),
+    tracker_(conf().fittype() != mu2e::TrkHitReco::FitType::firmwarepmp, hasHistType("pedestals"), hasHistType("panels")),
+    calo_(hasHistType("Crystals"), conf().ringWidth()), crv_(hasHistType("crvChannels"), conf().crvTimeMax()),
+    dispatcher_(conf().nThreads()), dispatchStage_(addStage("dispatch")),
+    trackerStage_(addStage("tracker")), caloStage_(addStage("calorimeter")), crvStage_(addStage("crv")) {
+  checkHistTypes({"tracker", "pedestals", "panels", "calorimeter", "caloSummary", "Crystals", "crv", "crvChannels"});
+}
+
+void ots::RawDQM::beginJob() {
+  __MOUT__ << "[RawDQM::beginJob] Beginning job" << std::endl;
+  // each handler fills its own set only, so the handlers share no state
+  if (hasHistType("tracker")) {
+    tracker_histos_ = addSet(new TrackerDQMHistoContainer("Tracker_raw"));
+    bookSchema(tracker_histos_, tfs, TrackerDQMHistoContainer::kSchema);
+    manifestSet(moduleTag_ + "_tracker", tracker_histos_);
+    tracker_.BookHistos(tfs, manifest(), moduleTag_, tracker_histos_);
+    dispatcher_.add(mu2e::detail::Subsystem::Tracker, "tracker",
+		    [this](const art::Event&, const DQMSubsystemFragments& frags) { tracker_handler_(frags); });
+  }
+  if (hasHistType("calorimeter")) {
+    bookSchema(calo_histos_.get(), tfs, kCaloRawSchema);
+    size_t key = manifest().key(moduleTag_ + "_calorimeter");
+    for (auto& h : calo_histos_->histograms) manifest().add(key, h._Hist);
+    // the calo summary is not split by spill state either
+    if (doCaloSummary_) {
+      bookSchema(calo_summary_.get(), tfs, CaloDQMHistoContainer::kOnspillSchema);
+      key = manifest().key(moduleTag_ + "_calo_summary");
+      for (auto& h : calo_summary_->histograms) manifest().add(key, h._Hist);
+    }
+    dispatcher_.add(mu2e::detail::Subsystem::Calorimeter, "calorimeter",
+		    [this](const art::Event& event, const DQMSubsystemFragments& frags) { calo_handler_(event, frags); });
+  }
+  // the CRV summary is not split by spill state either
+  if (hasHistType("crv")) {
+    bookSchema(crv_histos_.get(), tfs, CrvDQMHistoContainer::kOnspillSchema);
+    size_t key = manifest().key(moduleTag_ + "_crv");
+    for (auto& h : crv_histos_->histograms) manifest().add(key, h._Hist);
+    crv_.BookHistos(tfs);
+    dispatcher_.add(mu2e::detail::Subsystem::CRV, "crv",
+		    [this](const art::Event&, const DQMSubsystemFragments& frags) { crv_handler_(frags); });
+  }
+  reportMemory();
+}
+
+void ots::RawDQM::beginRun(const art::Run& run) {
+  if (hasHistType("calorimeter")) calo_.beginRun(tfs);
+}
+
+void ots::RawDQM::analyze(art::Event const& event) {
+  ++evtCounter_;
+  {
+    // fetch and all the handlers; each handler is also timed in its thread
+    DQMStageTimers::Scope dispatch = timeStage(dispatchStage_);
+    dispatcher_.dispatch(event);
+  }
+  publishIfDue();
+}
+
+void ots::RawDQM::tracker_handler_(const DQMSubsystemFragments& frags) {
+  DQMStageTimers::Scope scope = timeStage(trackerStage_);
+  tracker_.fill(frags);
+}
+
+// the block and packet counts of the DTC data, then the CaloDQM fill of the
+// hits reconstructed from them
+void ots::RawDQM::calo_handler_(const art::Event& event, const DQMSubsystemFragments& frags) {
+  DQMStageTimers::Scope scope = timeStage(caloStage_);
+  DQMFillBuffer& buffer = calo_histos_->fillBuffer;
+  size_t nBlocks(0), nPackets(0);
+  for (const mu2e::CalorimeterDataDecoder* cc : frags.calorimeter) {
+    for (size_t curBlockIdx = 0; curBlockIdx < cc->block_count(); curBlockIdx++) {
+      auto block_data = cc->dataAtBlockIndex(curBlockIdx);
+      if (block_data == nullptr) continue;
+      size_t n = block_data->GetHeader()->GetPacketCount();
+      ++nBlocks;
+      nPackets += n;
+      buffer.AddUnchecked(kCaloPacketsPerBlock, n);
+    }
+  }
+  buffer.AddUnchecked(kCaloBlocks, nBlocks);
+  buffer.AddUnchecked(kCaloPackets, nPackets);
+  buffer.Flush();
+  if (doCaloReco_) calo_.fill(event, doCaloSummary_ ? calo_summary_.get() : NULL);
+}
+
+void ots::RawDQM::crv_handler_(const DQMSubsystemFragments& frags) {
+  DQMStageTimers::Scope scope = timeStage(crvStage_);
+  crv_.fill(frags, crv_histos_.get());
+}
+
+void ots::RawDQM::collect_extra(packet_t& packet) {
+  calo_.publish(packet, moduleTag_ + "_crystals");
+  crv_.publish(packet, moduleTag_ + "_crv_channels");
+}
+
+DEFINE_ART_MODULE(ots::RawDQM)
@@ -0,0 +1,115 @@
+#ifndef _TrackerDQMHandler_h_
+#define _TrackerDQMHandler_h_
+
+#include "Offline/DataProducts/inc/StrawId.hh"
+#include "Offline/DataProducts/inc/TrkTypes.hh"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileService.h"
+#include "artdaq-core-mu2e/Data/TrackerDataDecoder.hh"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMFragmentDispatcher.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMPublishManifest.h"
+#include "otsdaq-mu2e-dqm/ArtModules/TrackerDQM.h"
+#include "otsdaq-mu2e-dqm/ArtModules/TrackerDQMHistoContainer.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistMemory.h"
+#include "otsdaq/MessageFacility/MessageFacility.h"
+
+#include <memory>
+#include <string>
+
+namespace ots {
+
+  // The tracker DQM of the DTC data of an event, run as the tracker handler
+  // of a DQMFragmentDispatcher (TrackerDQM, RawDQM): the occupancy summary
+  // and, on request, the per-straw pedestals and the per-panel hit maps. The
+  // summary set belongs to the module, which books it with its schema; the
+  // pedestal and panel sets are owned here and published through the
+  // module's manifest. Only these sets are touched, so the handler can run
+  // concurrently with the other subsystems.
+  class TrackerDQMHandler {
+  public:
+    TrackerDQMHandler(bool UseADCWF, bool DoPedestals, bool DoPanels) :
+      useADCWF_(UseADCWF), doPedestals_(DoPedestals), doPanels_(DoPanels), summary_(NULL),
+      pedestals_(new TrackerDQMHistoContainer()), panels_(new TrackerDQMHistoContainer()){};
+    virtual ~TrackerDQMHandler(void){};
+
+    // the pedestal and panel histograms go in one sender directory per plane
+    // (and panel), resolved here once
+    void BookHistos(art::ServiceHandle<art::TFileService> tfs, DQMPublishManifest& pub,
+		    const std::string& moduleTag, TrackerDQMHistoContainer* summary) {
+      summary_ = summary;
+      if (doPedestals_) {
+	for (int plane = 0; plane < mu2e::StrawId::_nplanes; plane++) {
+	  for (int panel = 0; panel < mu2e::StrawId::_npanels; panel++) {
+	    size_t key = pub.key(moduleTag + "_pedestals/plane_" + std::to_string(plane) + "/panel_" + std::to_string(panel));
+	    for (int straw = 0; straw < mu2e::StrawId::_nstraws; straw++) {
+	      pedestals_->BookHistos(tfs, "Pedestal_" + std::to_string(plane) + "_" + std::to_string(panel) + "_" + std::to_string(straw),
+				     plane, panel, straw);
+	      pub.add(key, pedestals_->histograms.back()._Hist);
+	    }
+	  }
+	}
+      }
+      if (doPanels_) {
+	for (int plane = 0; plane < mu2e::StrawId::_nplanes; plane++) {
+	  size_t key = pub.key(moduleTag + "_panels/plane_" + std::to_string(plane));
+	  for (int panel = 0; panel < mu2e::StrawId::_npanels; panel++) {
+	    panels_->BookHistos(tfs, "Panel_" + std::to_string(plane) + "_" + std::to_string(panel), plane, panel, -1);
+	    pub.add(key, panels_->histograms.back()._Hist);
+	  }
+	}
+      }
+    }
+
+    // decode the blocks of every tracker DTC once and fill the histograms
+    // once per event
+    void fill(const DQMSubsystemFragments& frags) {
+      for (const mu2e::TrackerDataDecoder* cc : frags.tracker) fill_(*cc);
+      summary_->fillBuffer.Flush();
+      if (doPedestals_) pedestals_->fillBuffer.Flush();
+      if (doPanels_)    panels_->fillBuffer.Flush();
+    }
+
+    // the buffers of the pedestal and panel sets; their histograms are in
+    // the manifest
+    DQMMemoryUsage memoryUsage() const {
+      DQMMemoryUsage usage;
+      usage.buffers = pedestals_->fillBuffer.capacityBytes() + panels_->fillBuffer.capacityBytes();
+      return usage;
+    }
+
+  private:
+    void fill_(const mu2e::TrackerDataDecoder& cc) {
+      for (size_t curBlockIdx = 0; curBlockIdx < cc.block_count(); curBlockIdx++) {
+	auto block_data = cc.dataAtBlockIndex(curBlockIdx);
+	if (block_data == nullptr) {
+	  mf::LogError("TrackerDQM") << "Unable to retrieve header from block " << curBlockIdx << "!" << std::endl;
+	  continue;
+	}
+	if (block_data->GetHeader()->GetPacketCount() == 0) continue;
+	// the waveforms are only decoded for the pedestals
+	auto trkDatas = cc.GetTrackerData(curBlockIdx, useADCWF_ && doPedestals_);
+	if (trkDatas.empty()) {
+	  mf::LogError("TrackerDQM") << "Error retrieving Tracker data from DataBlock " << curBlockIdx << "!";
+	  continue;
+	}
+
+	for (auto& trkData : trkDatas) {
+	  mu2e::StrawId sid(trkData.first->StrawIndex);
+	  summary_fill(summary_, sid);
+	  if (doPedestals_) {
+	    mu2e::TrkTypes::ADCWaveform adcs(trkData.second.begin(), trkData.second.end());
+	    pedestal_fill(pedestals_.get(), pedestal_est(adcs), "Pedestal", sid);
+	  }
+	  if (doPanels_) panel_fill(panels_.get(), "Panel", sid);
+	}
+      }
+    }
+
+    bool                                       useADCWF_, doPedestals_, doPanels_;
+    TrackerDQMHistoContainer*                  summary_;     // owned by the module
+    std::unique_ptr<TrackerDQMHistoContainer>  pedestals_, panels_;
+  };
+
+} // namespace ots
+
+#endif
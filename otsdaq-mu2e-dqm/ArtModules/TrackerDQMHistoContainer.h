@@ -7,6 +7,9 @@
 #include "art_root_io/TFileService.h"
 #include "otsdaq/NetworkUtilities/TCPPublishServer.h"
 #include "otsdaq/Macros/CoutMacros.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMFillBuffer.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMHistSchema.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/TrackerFillEngine.h"
 #include <TH1F.h>
 #include <string>
 
@@ -14,8 +17,15 @@ namespace ots {
 
   class TrackerDQMHistoContainer {
   public:
-    TrackerDQMHistoContainer(){};
+    TrackerDQMHistoContainer(std::string DirName = "Tracker_summary") : dirName(DirName){};
     virtual ~TrackerDQMHistoContainer(void){};
+
+    // the schema is the one of the fill engine (TrackerFillEngine.h)
+    enum SummaryHist { kPanelOccupancy = kTrackerPanelOccupancy, kPlaneOccupancy = kTrackerPlaneOccupancy,
+		       kNSummaryHists  = kNTrackerSummaryHists };
+
+    static constexpr const DQMHistSpec (&kSchema)[kNSummaryHists] = kTrackerSummarySchema;
+
     struct summaryInfoHist_ {
       TH1F *_Hist;
       int   plane;
@@ -25,13 +35,16 @@ namespace ots {
     };
 
     std::vector<summaryInfoHist_> histograms;
+    std::string                   dirName;
+    DQMFillBuffer                 fillBuffer;   // per-event fills, the id is the position in histograms
 
     void BookSummaryHistos(art::ServiceHandle<art::TFileService> tfs, std::string Title,
 			   int nBins, float min, float max) {
       histograms.push_back(summaryInfoHist_());
-      art::TFileDirectory testDir = tfs->mkdir("Tracker_summary");
+      art::TFileDirectory testDir = tfs->mkdir(dirName);
       this->histograms[histograms.size() - 1]._Hist = 
 	testDir.make<TH1F>(Title.c_str(), Title.c_str(), nBins, min, max);
+      fillBuffer.AddTarget(this->histograms[histograms.size() - 1]._Hist);
     }
   
     void BookHistos(art::ServiceHandle<art::TFileService> tfs, std::string Title,
@@ -55,6 +68,7 @@ namespace ots {
       this->histograms[histograms.size() - 1].plane = plane;
       this->histograms[histograms.size() - 1].panel = panel;
       this->histograms[histograms.size() - 1].straw = straw;
+      fillBuffer.AddTarget(this->histograms[histograms.size() - 1]._Hist);
     }
 
   };
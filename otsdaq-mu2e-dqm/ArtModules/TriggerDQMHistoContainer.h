@@ -6,6 +6,9 @@
 #include "art_root_io/TFileService.h"
 #include "otsdaq/NetworkUtilities/TCPPublishServer.h"
 #include "otsdaq/Macros/CoutMacros.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMFillBuffer.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMHistSchema.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/TriggerFillEngine.h"
 #include <TH1F.h>
 #include <string>
 
@@ -13,8 +16,14 @@ namespace ots {
 
   class TriggerDQMHistoContainer {
   public:
-    TriggerDQMHistoContainer(){};
+    TriggerDQMHistoContainer(std::string DirName = "Trigger_summary") : dirName(DirName){};
     virtual ~TriggerDQMHistoContainer(void){};
+
+    // the schema is the one of the fill engine (TriggerFillEngine.h)
+    enum SummaryHist { kPaths = kTriggerPaths, kCounts = kTriggerCounts, kNSummaryHists = kNTriggerSummaryHists };
+
+    static constexpr const DQMHistSpec (&kSchema)[kNSummaryHists] = kTriggerSummarySchema;
+
     struct summaryInfoHist_ {
       TH1F *_Hist;
       int   plane;
@@ -24,13 +33,16 @@ namespace ots {
     };
 
     std::vector<summaryInfoHist_> histograms;
+    std::string                   dirName;
+    DQMFillBuffer                 fillBuffer;   // per-event fills, the id is the position in histograms
 
     void BookSummaryHistos(art::ServiceHandle<art::TFileService> tfs, std::string Title,
 			   int nBins, float min, float max) {
       histograms.push_back(summaryInfoHist_());
-      art::TFileDirectory testDir = tfs->mkdir("Trigger_summary");
+      art::TFileDirectory testDir = tfs->mkdir(dirName);
       this->histograms[histograms.size() - 1]._Hist = 
 	testDir.make<TH1F>(Title.c_str(), Title.c_str(), nBins, min, max);
+      fillBuffer.AddTarget(this->histograms[histograms.size() - 1]._Hist);
     }
   
     /* void BookHistos(art::ServiceHandle<art::TFileService> tfs, std::string Title, */
@@ -0,0 +1,306 @@
+// This module histograms the kinematics of the trigger objects (helices,
+// tracks, calo seeds and clusters) stored in the TriggerInfo of each filter
+// that accepted the event. It replaces fillTrackTrigInfo, fillHelixTrigInfo,
+// fillCaloTrigSeedInfo and fillCaloCalibTrigInfo of the old TriggerRates
+// module (OldTriggerRates_module.cc). With doMC the tracks are matched to
+// the SimParticle that made most of their hits, and the p_{MC} of the
+// primary particle is histogrammed in every event and for the tracks of
+// each filter matched to it: the efficiency of the filter versus p_{MC}.
+
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Principal/Run.h"
+#include "canvas/Persistency/Common/TriggerResults.h"
+#include "fhiclcpp/types/TableFragment.h"
+
+#include "Offline/BFieldGeom/inc/BFieldManager.hh"
+#include "Offline/GeometryService/inc/DetectorSystem.hh"
+#include "Offline/GeometryService/inc/GeomHandle.hh"
+#include "Offline/TrackerGeom/inc/Tracker.hh"
+
+#include "Offline/MCDataProducts/inc/PrimaryParticle.hh"
+#include "Offline/MCDataProducts/inc/SimParticle.hh"
+#include "Offline/MCDataProducts/inc/StrawDigiMC.hh"
+#include "Offline/Mu2eUtilities/inc/HelixTool.hh"
+#include "Offline/RecoDataProducts/inc/CaloCluster.hh"
+#include "Offline/RecoDataProducts/inc/CaloTrigSeed.hh"
+#include "Offline/RecoDataProducts/inc/HelixSeed.hh"
+#include "Offline/RecoDataProducts/inc/KalSeed.hh"
+#include "Offline/RecoDataProducts/inc/TriggerInfo.hh"
+
+#include "otsdaq-mu2e-dqm/ArtModules/DQMMCMatcher.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMModule.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMTriggerObjectBank.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMTriggerTable.h"
+#include "otsdaq-mu2e-dqm/ArtModules/TriggerDQMHistoContainer.h"
+#include "otsdaq/Macros/CoutMacros.h"
+#include "otsdaq/Macros/ProcessorPluginMacros.h"
+#include "otsdaq/MessageFacility/MessageFacility.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ots {
+  // The histograms are booked per filter in a DQMTriggerObjectBank, so the
+  // module books no summary set (histType is not used) and adds the bank to
+  // the packet in collect_extra.
+  class TriggerObjectDQM : public DQMModule<TriggerDQMHistoContainer> {
+  public:
+    struct Config {
+      using Name = fhicl::Name;
+      using Comment = fhicl::Comment;
+      fhicl::TableFragment<DQMModuleConfig> dqm;
+      fhicl::Atom<std::string>     processName { Name("processName"), Comment("Process that produced the TriggerResults"), "globalTrigger" };
+      fhicl::Sequence<std::string> trigPaths   { Name("triggerPathsList"), Comment("Trigger paths to monitor, all of them if empty"), std::vector<std::string>() };
+      fhicl::Atom<int>             nFilters    { Name("nFilters"),    Comment("Maximum number of filters of each category with histograms, 0 for no limit"), 20 };
+      fhicl::Atom<bool>            doMC        { Name("doMC"),        Comment("Match the trigger tracks to the MC truth"), false };
+      fhicl::Atom<art::InputTag>   sdMCTag     { Name("strawDigiMCCollection"), Comment("StrawDigiMC used for the MC matching"), art::InputTag("compressDigiMCs") };
+      fhicl::Atom<art::InputTag>   primaryTag  { Name("primaryParticle"), Comment("PrimaryParticle used for the efficiencies"), art::InputTag("compressDigiMCs") };
+    };
+
+    typedef art::EDAnalyzer::Table<Config> Parameters;
+
+    explicit TriggerObjectDQM(Parameters const& conf);
+
+    void analyze(art::Event const& event) override;
+    void beginJob() override;
+    void beginRun(art::Run const&) override;
+    void endJob() override;
+
+    void book_summary(TriggerDQMHistoContainer *histos, SpillState spill) override {}
+
+  private:
+    void collect_extra(packet_t& packet) override;
+    DQMMemoryUsage memory_extra() const override { return bank_.memoryUsage(); }
+
+    void fill_(const DQMTriggerTable::module_& mod, int offset, const mu2e::TriggerInfo& info);
+    void fillTrackMC_(int mcOffset, const mu2e::KalSeed& kseed, double p, double pt, double pz);
+    bool isPrimary_(const art::Ptr<mu2e::SimParticle>& simptr) const;
+
+    std::string               processName_;
+    std::vector<std::string>  trigPaths_;
+    int                       nFilters_;
+    bool                      doMC_;
+    art::InputTag             sdMCTag_, primaryTag_;
+    double                    bz0_;
+    const mu2e::Tracker*      tracker_;
+    size_t                    fetchStage_, fillStage_;
+    DQMTriggerTable           trigTable_;
+    DQMTriggerObjectBank      bank_;
+    DQMMCMatcher              matcher_;
+    const mu2e::StrawDigiMCCollection* mcDigis_;
+    const mu2e::PrimaryParticle*       primary_;
+
+    // a filter that runs in several accepted paths is filled once per event
+    std::vector<unsigned long> moduleStamp_;
+  };
+} // namespace ots
+
+ots::TriggerObjectDQM::TriggerObjectDQM(Parameters const& conf)
+  : DQMModule<TriggerDQMHistoContainer>(conf, conf().dqm(), "TriggerObject"),
+    processName_(conf().processName()), trigPaths_(conf().trigPaths()), nFilters_(conf().nFilters()),
+    doMC_(conf().doMC()), sdMCTag_(conf().sdMCTag()), primaryTag_(conf().primaryTag()), bz0_(0),
+    tracker_(NULL), fetchStage_(addStage("fetch")), fillStage_(addStage("fill")), mcDigis_(NULL),
+    primary_(NULL) {}
+
+void ots::TriggerObjectDQM::beginJob() {
+  __MOUT__ << "[TriggerObjectDQM::beginJob] Beginning job" << std::endl;
+  //the histograms are booked per filter, when the trigger table is built
+  bank_.Setup(tfs, nFilters_, doMC_);
+  reportMemory();
+}
+
+void ots::TriggerObjectDQM::beginRun(const art::Run& run) {
+  mu2e::GeomHandle<mu2e::BFieldManager>  bfmgr;
+  mu2e::GeomHandle<mu2e::DetectorSystem> det;
+  CLHEP::Hep3Vector vpoint_mu2e = det->toMu2e(CLHEP::Hep3Vector(0.0,0.0,0.0));
+  bz0_ = bfmgr->getBField(vpoint_mu2e).z();
+
+  mu2e::GeomHandle<mu2e::Tracker> th;
+  tracker_ = th.get();
+}
+
+void ots::TriggerObjectDQM::analyze(art::Event const& event) {
+  ++evtCounter_;
+
+  DQMStageTimers::Scope fetch = timeStage(fetchStage_);
+  art::Handle<art::TriggerResults> trigResultsH;
+  event.getByLabel(art::InputTag("TriggerResults", "", processName_), trigResultsH);
+  fetch.stop();
+
+  DQMStageTimers::Scope fill = timeStage(fillStage_);
+  if (trigResultsH.isValid()) {
+    const art::TriggerResults& results = *trigResultsH;
+    if (trigTable_.Update(results, trigPaths_)) {
+      int nSkipped = bank_.Update(trigTable_);
+      moduleStamp_.assign(trigTable_.modules().size(), 0);
+      if (nSkipped > 0) {
+	mf::LogWarning("TriggerObjectDQM") << nSkipped << " filters are not monitored, nFilters = " << nFilters_;
+      }
+      if (diagLevel_ > 0) {
+	__MOUT__ << "[TriggerObjectDQM::analyze] trigger table rebuilt: " << trigTable_.modules().size()
+		 << " modules, " << bank_.size() << " histograms booked" << std::endl;
+      }
+    }
+
+    mcDigis_ = NULL;
+    primary_ = NULL;
+    if (doMC_) {
+      art::Handle<mu2e::StrawDigiMCCollection> mcDigisH;
+      event.getByLabel(sdMCTag_, mcDigisH);
+      if (mcDigisH.isValid()) mcDigis_ = mcDigisH.product();
+
+      //the denominator of the efficiencies: every event with a primary
+      art::Handle<mu2e::PrimaryParticle> primaryH;
+      event.getByLabel(primaryTag_, primaryH);
+      if (primaryH.isValid() && !primaryH->primarySimParticles().empty()) {
+	primary_ = primaryH.product();
+	double pMC = primary_->primarySimParticles().front()->startMomentum().vect().mag();
+	bank_.fill(bank_.primaryOffset(), &pMC, 1);
+      }
+    }
+
+    //only the filters of the accepted paths are looked at
+    const std::vector<DQMTriggerTable::module_>& modules = trigTable_.modules();
+    for (const DQMTriggerTable::path_& path : trigTable_.paths()) {
+      if (!results.accept(path.bit)) continue;
+      for (int m : path.modules) {
+	if (moduleStamp_[m] == (unsigned long)evtCounter_) continue;
+	moduleStamp_[m] = evtCounter_;
+	int offset = bank_.offset(m);
+	if (offset < 0) continue;
+
+	art::Handle<mu2e::TriggerInfo> trigInfoH;
+	event.getByLabel(modules[m].label, trigInfoH);
+	if (!trigInfoH.isValid()) continue;
+	fill_(modules[m], offset, *trigInfoH);
+      }
+    }
+    bank_.Flush();
+  }
+  fill.stop();
+
+  publishIfDue();
+}
+
+void ots::TriggerObjectDQM::collect_extra(packet_t& packet) {
+  bank_.publish(packet, moduleTag_+"_trigObjects");
+}
+
+void ots::TriggerObjectDQM::fill_(const DQMTriggerTable::module_& mod, int offset, const mu2e::TriggerInfo& info) {
+  typedef DQMTriggerObjectBank B;
+  double values[B::kMaxVars];
+
+  switch (mod.category) {
+  case DQMTriggerTable::kTrack: {
+    const mu2e::KalSeed* kseed = info.track().get();
+    if (!kseed || kseed->segments().empty()) return;
+    mu2e::HelixTool           helTool(kseed->helix().get(), tracker_);
+    mu2e::KalSegment const&   fseg = kseed->segments().front();
+    int     nsh  = (int)kseed->hits().size();
+    double  ndof = std::max(1.0, nsh - 5.0);
+    values[B::kTrkP]      = fseg.mom();
+    values[B::kTrkPt]     = values[B::kTrkP]*std::cos(std::atan(fseg.helix().tanDip()));
+    values[B::kTrkPz]     = values[B::kTrkPt]*fseg.helix().tanDip();   // < 0 upstream
+    values[B::kTrkNSH]    = nsh;
+    values[B::kTrkD0]     = fseg.helix().d0();
+    values[B::kTrkChi2]   = kseed->chisquared()/ndof;
+    values[B::kTrkClE]    = kseed->caloCluster() ? kseed->caloCluster()->energyDep() : -1.;
+    values[B::kTrkNLoops] = helTool.nLoops();
+    bank_.fill(offset, values, B::kNTrackVars);
+
+    int mcOffset = bank_.mcOffset(offset, mod.category);
+    if (mcOffset >= 0 && mcDigis_) fillTrackMC_(mcOffset, *kseed, values[B::kTrkP], values[B::kTrkPt], values[B::kTrkPz]);
+    break;
+  }
+  case DQMTriggerTable::kHelix: {
+    const mu2e::HelixSeed* hseed = info.helix().get();
+    if (!hseed) return;
+    mu2e::HelixTool helTool(hseed, tracker_);
+    int nsh(0);
+    for (size_t i=0; i<hseed->hits().size(); ++i) nsh += hseed->hits().at(i).nStrawHits();
+    float   mm2MeV = (3./10.)*bz0_;
+    values[B::kHelP]         = hseed->helix().momentum()*mm2MeV;
+    values[B::kHelPt]        = hseed->helix().radius()*mm2MeV;
+    values[B::kHelNSH]       = nsh;
+    values[B::kHelD0]        = hseed->helix().rcent() - hseed->helix().radius();
+    values[B::kHelChi2XY]    = hseed->helix().chi2dXY();
+    values[B::kHelChi2ZPhi]  = hseed->helix().chi2dZPhi();
+    values[B::kHelClE]       = hseed->caloCluster() ? hseed->caloCluster()->energyDep() : -1.;
+    values[B::kHelLambda]    = std::fabs(hseed->helix().lambda());
+    values[B::kHelNLoops]    = helTool.nLoops();
+    values[B::kHelHitRatio]  = helTool.hitRatio();
+    bank_.fill(offset, values, B::kNHelixVars);
+    break;
+  }
+  case DQMTriggerTable::kCaloOnly: {
+    const mu2e::CaloTrigSeed* seed = info.caloTrigSeed().get();
+    if (!seed) return;
+    values[B::kSeedEPeak]  = seed->epeak();
+    values[B::kSeedR1Max1] = seed->ring1max();
+    values[B::kSeedR1Max2] = seed->ring1max2();
+    bank_.fill(offset, values, B::kNCaloOnlyVars);
+    break;
+  }
+  case DQMTriggerTable::kCaloCalib: {
+    const mu2e::CaloCluster* cluster = info.caloCluster().get();
+    if (!cluster) return;
+    values[B::kClE]    = cluster->energyDep();
+    values[B::kClSize] = cluster->size();
+    bank_.fill(offset, values, B::kNCaloCalibVars);
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+// linear in the number of hits: the SimParticles are counted in the matcher.
+// pz is signed, as the MC one, so an upstream track matched to a downstream
+// particle shows up far from 0 in dpzMC
+void ots::TriggerObjectDQM::fillTrackMC_(int mcOffset, const mu2e::KalSeed& kseed, double p, double pt, double pz) {
+  typedef DQMTriggerObjectBank B;
+
+  matcher_.clear();
+  for (const auto& hit : kseed.hits()) {
+    size_t index = hit.index();
+    if (index >= mcDigis_->size()) continue;
+    const auto& step = mcDigis_->at(index).earlyStrawGasStep();
+    if (step.isNull()) continue;
+    matcher_.add(step->simParticle()->id().asInt(), step->position().z(), index);
+  }
+
+  DQMMCMatcher::match_ match;
+  if (!matcher_.dominant(match)) return;
+
+  const art::Ptr<mu2e::SimParticle>& simptr = mcDigis_->at(match.hitIndex).earlyStrawGasStep()->simParticle();
+  double pXMC = simptr->startMomentum().x();
+  double pYMC = simptr->startMomentum().y();
+  double pZMC = simptr->startMomentum().z();
+  double pTMC = std::sqrt(pXMC*pXMC + pYMC*pYMC);
+  double pMC  = std::sqrt(pZMC*pZMC + pTMC*pTMC);
+
+  double values[B::kNTrackMCVars];
+  values[B::kMCP]      = pMC;
+  values[B::kMCDP]     = p  - pMC;
+  values[B::kMCDPt]    = pt - pTMC;
+  values[B::kMCDPz]    = pz - pZMC;
+  values[B::kMCPz]     = pZMC;
+  values[B::kMCPdg]    = simptr->pdgId();
+  values[B::kMCPurity] = match.purity();
+  bank_.fill(mcOffset, values, B::kMCPrimaryP);
+
+  //a filter has one track per event: the primary is counted at most once
+  if (isPrimary_(simptr)) bank_.fill(mcOffset + B::kMCPrimaryP, &pMC, 1);
+}
+
+bool ots::TriggerObjectDQM::isPrimary_(const art::Ptr<mu2e::SimParticle>& simptr) const {
+  if (!primary_) return false;
+  const auto& primaries = primary_->primarySimParticles();
+  return std::find(primaries.begin(), primaries.end(), simptr) != primaries.end();
+}
+
+void ots::TriggerObjectDQM::endJob() {}
+
+DEFINE_ART_MODULE(ots::TriggerObjectDQM)
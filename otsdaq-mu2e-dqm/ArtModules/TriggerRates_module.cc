@@ -0,0 +1,199 @@
+// This module produces trigger rates, rejections, correlations and bandwidth
+// from the TriggerResults. It replaces the label bookkeeping of the old
+// TriggerRates module (OldTriggerRates_module.cc) with DQMTriggerTable.
+
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "canvas/Persistency/Common/TriggerResults.h"
+#include "fhiclcpp/types/TableFragment.h"
+
+#include <TH1F.h>
+#include <TH2F.h>
+
+#include "otsdaq-mu2e-dqm/ArtModules/DQMModule.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMTriggerTable.h"
+#include "otsdaq-mu2e-dqm/ArtModules/TriggerDQMHistoContainer.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/TriggerPathCounter.h"
+#include "otsdaq/Macros/CoutMacros.h"
+#include "otsdaq/Macros/ProcessorPluginMacros.h"
+#include "otsdaq/MessageFacility/MessageFacility.h"
+
+#include <algorithm>
+
+namespace ots {
+  // The histograms are computed at publish time from the path counters, so
+  // the module books no summary set (histType is not used) and adds them to
+  // the packet in collect_extra.
+  class TriggerRates : public DQMModule<TriggerDQMHistoContainer> {
+  public:
+    struct Config {
+      using Name = fhicl::Name;
+      using Comment = fhicl::Comment;
+      fhicl::TableFragment<DQMModuleConfig> dqm;
+      fhicl::Atom<std::string>     processName { Name("processName"), Comment("Process that produced the TriggerResults"), "globalTrigger" };
+      fhicl::Sequence<std::string> trigPaths   { Name("triggerPathsList"), Comment("Trigger paths to monitor, all of them if empty"), std::vector<std::string>() };
+      fhicl::Atom<int>             nFilters    { Name("nFilters"),    Comment("Maximum number of filter modules shown in the per-module histograms"), 70 };
+      fhicl::Atom<float>           mbTime      { Name("mbTime"),      Comment("Microbunch period [ns]"), 1695. };
+      fhicl::Atom<float>           dutyCycle   { Name("dutyCycle"),   Comment("Fraction of the microbunches delivering beam"), 1. };
+    };
+
+    typedef art::EDAnalyzer::Table<Config> Parameters;
+
+    explicit TriggerRates(Parameters const& conf);
+
+    void analyze(art::Event const& event) override;
+    void beginJob() override;
+    void endJob() override;
+
+    void book_summary(TriggerDQMHistoContainer *histos, SpillState spill) override {}
+
+  private:
+    void collect_extra(packet_t& packet) override;
+    DQMMemoryUsage memory_extra() const override;
+
+    std::string               processName_;
+    std::vector<std::string>  trigPaths_;
+    int                       nFilters_;
+    double                    mbRate_;                 // microbunches per second
+    size_t                    fetchStage_, fillStage_;
+    DQMTriggerTable           trigTable_;
+
+    // per-event bookkeeping: events per combination of accepted paths
+    TriggerPathCounter            pathCounter_;
+    TriggerPathCounter::rollup_t  rollup_;         // reused across publishes
+
+    enum { kNPaths = DQMTriggerTable::kMaxMaskPaths };
+    TH1F *_hPathRejection, *_hPathRate, *_hPathUnique, *_hBandwidth, *_hCumBandwidth, *_hModuleRejection;
+    TH1F *_hCategoryRejection[DQMTriggerTable::kNCategories];
+    TH2F *_hPathCorrelation;
+  };
+} // namespace ots
+
+ots::TriggerRates::TriggerRates(Parameters const& conf)
+  : DQMModule<TriggerDQMHistoContainer>(conf, conf().dqm(), "TriggerRates"),
+    processName_(conf().processName()), trigPaths_(conf().trigPaths()), nFilters_(conf().nFilters()),
+    mbRate_(conf().dutyCycle()/(conf().mbTime()*1e-9)), fetchStage_(addStage("fetch")), fillStage_(addStage("fill")) {}
+
+void ots::TriggerRates::beginJob() {
+  __MOUT__ << "[TriggerRates::beginJob] Beginning job" << std::endl;
+
+  art::TFileDirectory dir = tfs->mkdir("TriggerRates");
+  _hPathRejection   = dir.make<TH1F>("hTrigInfo_paths"     , "Rejection of the trigger paths; ; rejection"            , kNPaths, -0.5, kNPaths-0.5);
+  _hPathRate        = dir.make<TH1F>("hTrigRate_paths"     , "Trigger path rate; ; rate [Hz]"                         , kNPaths, -0.5, kNPaths-0.5);
+  _hPathUnique      = dir.make<TH1F>("hTrigInfo_unique"    , "Events found only by each trigger path; ; events"       , kNPaths, -0.5, kNPaths-0.5);
+  _hBandwidth       = dir.make<TH1F>("hTrigBDW_global"     , "Trigger bandwidth; ; rate [Hz]"                         , kNPaths, -0.5, kNPaths-0.5);
+  _hCumBandwidth    = dir.make<TH1F>("hTrigBDW_cumulative" , "Cumulative trigger bandwidth; ; rate [Hz]"              , kNPaths, -0.5, kNPaths-0.5);
+  _hPathCorrelation = dir.make<TH2F>("h2DTrigInfo_map"     , "Trigger path correlation map"                           , kNPaths, -0.5, kNPaths-0.5, kNPaths, -0.5, kNPaths-0.5);
+  _hModuleRejection = dir.make<TH1F>("hTrigInfo_global"    , "Rejection of the trigger filters; ; rejection"          , nFilters_, -0.5, nFilters_-0.5);
+  for (int c=0; c<DQMTriggerTable::kNCategories; ++c){
+    const char* cat = DQMTriggerTable::categoryName(DQMTriggerTable::Category(c));
+    _hCategoryRejection[c] = dir.make<TH1F>(Form("hTrigInfo_%s", cat), Form("Rejection of the %s filters; ; rejection", cat), nFilters_, -0.5, nFilters_-0.5);
+  }
+  reportMemory();
+}
+
+void ots::TriggerRates::analyze(art::Event const& event) {
+  ++evtCounter_;
+
+  DQMStageTimers::Scope fetch = timeStage(fetchStage_);
+  art::Handle<art::TriggerResults> trigResultsH;
+  event.getByLabel(art::InputTag("TriggerResults", "", processName_), trigResultsH);
+  fetch.stop();
+
+  DQMStageTimers::Scope fill = timeStage(fillStage_);
+  if (trigResultsH.isValid()) {
+    if (trigTable_.Update(*trigResultsH, trigPaths_)) {
+      //counts from the previous menu cannot be mapped on the new one
+      pathCounter_.clear();
+      if (trigTable_.paths().size() > size_t(kNPaths)) {
+	mf::LogWarning("TriggerRates") << "Only the first " << int(kNPaths) << " of "
+				       << trigTable_.paths().size() << " trigger paths are monitored";
+      }
+      if (diagLevel_ > 0) {
+	__MOUT__ << "[TriggerRates::analyze] trigger table rebuilt: " << trigTable_.paths().size()
+		 << " paths, " << trigTable_.modules().size() << " modules" << std::endl;
+      }
+    }
+    pathCounter_.add(trigTable_.acceptedPaths(*trigResultsH));
+  }
+  fill.stop();
+
+  publishIfDue();
+}
+
+// everything is derived from the accepted-path combinations: the cost is
+// O(distinct combinations), independent of the number of events
+void ots::TriggerRates::collect_extra(packet_t& packet) {
+  const std::vector<DQMTriggerTable::path_>&   paths   = trigTable_.paths();
+  const std::vector<DQMTriggerTable::module_>& modules = trigTable_.modules();
+  size_t nPaths   = std::min(paths.size(), size_t(kNPaths));
+  size_t nModules = modules.size();
+  unsigned long nEvents = pathCounter_.nEvents();
+
+  TriggerPathCounter::rollup_t& r = rollup_;
+  pathCounter_.rollup(nPaths, nModules, [&](size_t p) -> const std::vector<int>& { return paths[p].modules; }, r);
+  const std::vector<unsigned long>& pathCounts   = r.pathCounts;
+  const std::vector<unsigned long>& moduleCounts = r.moduleCounts;
+  const std::vector<int>&           order        = r.order;
+
+  TH1* all[] = {_hPathRejection, _hPathRate, _hPathUnique, _hBandwidth, _hCumBandwidth, _hPathCorrelation, _hModuleRejection};
+  for (TH1* h : all) h->Reset();
+  for (TH1F* h : _hCategoryRejection) h->Reset();
+
+  double norm = (nEvents > 0) ? mbRate_/nEvents : 0.;
+  double cumulative(0);
+  for (size_t k=0; k<nPaths; ++k){
+    const char* name = paths[k].name.c_str();
+    _hPathRejection  ->GetXaxis()->SetBinLabel(k+1, name);
+    _hPathRate       ->GetXaxis()->SetBinLabel(k+1, name);
+    _hPathUnique     ->GetXaxis()->SetBinLabel(k+1, name);
+    _hPathCorrelation->GetXaxis()->SetBinLabel(k+1, name);
+    _hPathCorrelation->GetYaxis()->SetBinLabel(k+1, name);
+    if (pathCounts[k] > 0) _hPathRejection->SetBinContent(k+1, double(nEvents)/pathCounts[k]);
+    _hPathRate  ->SetBinContent(k+1, pathCounts[k]*norm);
+    _hPathUnique->SetBinContent(k+1, r.uniqueCounts[k]);
+    for (size_t l=0; l<nPaths; ++l) _hPathCorrelation->SetBinContent(k+1, l+1, r.pairCounts[k*nPaths + l]);
+
+    int p = order[k];
+    cumulative += r.firstCounts[k]*norm;
+    _hBandwidth   ->GetXaxis()->SetBinLabel(k+1, paths[p].name.c_str());
+    _hCumBandwidth->GetXaxis()->SetBinLabel(k+1, paths[p].name.c_str());
+    _hBandwidth   ->SetBinContent(k+1, pathCounts[p]*norm);
+    _hCumBandwidth->SetBinContent(k+1, cumulative);
+  }
+
+  for (size_t m=0; m<nModules; ++m){
+    const DQMTriggerTable::module_& mod = modules[m];
+    double rejection = (moduleCounts[m] > 0) ? double(nEvents)/moduleCounts[m] : 0.;
+    if (mod.globalIndex < nFilters_) {
+      _hModuleRejection->GetXaxis()->SetBinLabel(mod.globalIndex+1, mod.label.c_str());
+      _hModuleRejection->SetBinContent(mod.globalIndex+1, rejection);
+    }
+    if (mod.index < nFilters_) {
+      _hCategoryRejection[mod.category]->GetXaxis()->SetBinLabel(mod.index+1, mod.label.c_str());
+      _hCategoryRejection[mod.category]->SetBinContent(mod.index+1, rejection);
+    }
+  }
+
+  //the histograms are recomputed at every publish, the counters restart
+  std::vector<TH1*>& out = packet[moduleTag_+"_rates"];
+  for (TH1* h : all) out.push_back((TH1*)h->Clone());
+  for (TH1F* h : _hCategoryRejection) out.push_back((TH1*)h->Clone());
+
+  pathCounter_.clear();
+}
+
+ots::DQMMemoryUsage ots::TriggerRates::memory_extra() const {
+  DQMMemoryUsage usage;
+  const TH1* all[] = {_hPathRejection, _hPathRate, _hPathUnique, _hBandwidth, _hCumBandwidth, _hPathCorrelation, _hModuleRejection};
+  for (const TH1* h : all) usage.addHist(h);
+  for (const TH1F* h : _hCategoryRejection) usage.addHist(h);
+  usage.addVector(rollup_.pathCounts);   usage.addVector(rollup_.uniqueCounts); usage.addVector(rollup_.pairCounts);
+  usage.addVector(rollup_.moduleCounts); usage.addVector(rollup_.order);        usage.addVector(rollup_.firstCounts);
+  return usage;
+}
+
+void ots::TriggerRates::endJob() {}
+
+DEFINE_ART_MODULE(ots::TriggerRates)
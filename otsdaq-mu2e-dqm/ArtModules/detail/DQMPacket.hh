@@ -0,0 +1,151 @@
+#ifndef OTSDAQ_DQM_ARTMODULES_DETAIL_DQMPACKET_HH
+#define OTSDAQ_DQM_ARTMODULES_DETAIL_DQMPACKET_HH
+
+#include <TBufferFile.h>
+#include <TH1.h>
+#include <TList.h>
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Wire format of the histogram streams that can be merged by an aggregator:
+// a DQMPacketHeader followed by a serialized TList holding one TList per
+// sender directory (named after it) with the histograms of that directory.
+// The header is written in the same buffer as the objects, so a packet is
+// serialized once and broadcast as is. Header fields are in host byte order.
+//
+// Each directory is added to the outer list with its merge mode as the add
+// option (TList keeps it on the wire), which tells an aggregator how to
+// combine the directory across packets and sources:
+//   sum       the content accumulated since the previous packet (the
+//             modules reset after each publish): added bin-wise. Rates and
+//             means are sent as profiles (sums and entries), which add up
+//   snapshot  a state sent whole at every publish (trend rings, time series,
+//             timing percentiles): replaced by the latest packet
+// The mode follows from the directory name (dqmMergeMode); a packet without
+// modes, from an older publisher, is read the same way.
+namespace ots
+{
+enum DQMMergeMode
+{
+	kMergeSum = 0,
+	kMergeSnapshot
+};
+
+inline const char* dqmMergeModeName(DQMMergeMode Mode)
+{
+	static const char* names[] = {"sum", "snapshot"};
+	return names[Mode];
+}
+
+// directory suffixes: _timeseries, _trends and _timing are snapshots, the
+// rest are sums
+inline DQMMergeMode dqmMergeMode(const std::string& DirName)
+{
+	auto endsWith = [&](const char* suffix) {
+		size_t n = std::strlen(suffix);
+		return DirName.size() >= n && DirName.compare(DirName.size() - n, n, suffix) == 0;
+	};
+	if(endsWith("_timeseries") || endsWith("_trends") || endsWith("_timing"))
+		return kMergeSnapshot;
+	return kMergeSum;
+}
+
+// the mode written with a directory, from its name if there is none
+inline DQMMergeMode dqmMergeMode(const std::string& DirName, const char* Option)
+{
+	for(int m = kMergeSum; m <= kMergeSnapshot; ++m)
+		if(Option && std::strcmp(Option, dqmMergeModeName(DQMMergeMode(m))) == 0)
+			return DQMMergeMode(m);
+	return dqmMergeMode(DirName);
+}
+
+struct DQMPacketHeader
+{
+	uint64_t packet_magic;
+	uint32_t source;        // unique per publisher (process or aggregator)
+	uint32_t sequence;      // per source, incremented per packet, 0 after a restart
+	uint32_t n_histograms;
+	uint32_t version;
+
+	DQMPacketHeader()
+	    : packet_magic(0), source(0), sequence(0), n_histograms(0), version(0)
+	{
+	}
+	DQMPacketHeader(uint32_t s, uint32_t seq, uint32_t n)
+	    : packet_magic(0xD0D0ABCDD0D0ABCD), source(s), sequence(seq), n_histograms(n), version(1)
+	{
+	}
+	bool isValid() const { return packet_magic == 0xD0D0ABCDD0D0ABCD && version == 1; }
+};
+
+// serialize a packet in Buffer, which is reused across calls; the packet is
+// Buffer.Buffer(), Buffer.Length() bytes long. The histograms are not copied
+inline void writeDQMPacket(TBufferFile&                                    Buffer,
+                           uint32_t                                        Source,
+                           uint32_t                                        Sequence,
+                           const std::map<std::string, std::vector<TH1*>>& Packet)
+{
+	TList dirs;
+	dirs.SetOwner(kTRUE);  // the directory lists, not the histograms
+	uint32_t nHists = 0;
+	for(auto& dir : Packet)
+	{
+		TList* list = new TList();
+		list->SetName(dir.first.c_str());
+		for(TH1* h : dir.second)
+			list->Add(h);
+		nHists += dir.second.size();
+		dirs.Add(list, dqmMergeModeName(dqmMergeMode(dir.first)));
+	}
+
+	DQMPacketHeader header(Source, Sequence, nHists);
+	Buffer.SetBufferOffset(0);
+	Buffer.ResetMap();
+	Buffer.WriteFastArray(reinterpret_cast<const char*>(&header), sizeof(header));
+	Buffer.WriteObject(&dirs);
+
+	TIter next(&dirs);
+	while(TList* list = (TList*)next())
+		list->SetOwner(kFALSE);
+}
+
+// decode a packet; returns the directory lists (owning their histograms), or
+// nullptr if the packet is not a valid DQM packet. The merge mode of a
+// directory is the option of its link (dqmMergeMode(name, option))
+inline std::unique_ptr<TList> readDQMPacket(const std::string& Packet, DQMPacketHeader& Header)
+{
+	if(Packet.size() <= sizeof(Header))
+		return nullptr;
+	std::memcpy(&Header, Packet.data(), sizeof(Header));
+	if(!Header.isValid())
+		return nullptr;
+
+	// read in place, at the same offset the objects were written at
+	TBufferFile buffer(TBuffer::kRead, Packet.size(), const_cast<char*>(Packet.data()), kFALSE);
+	buffer.SetBufferOffset(sizeof(Header));
+	std::unique_ptr<TList> dirs((TList*)buffer.ReadObject(TList::Class()));
+	if(!dirs)
+		return nullptr;
+	dirs->SetOwner(kTRUE);
+	TIter next(dirs.get());
+	while(TObject* obj = next())
+	{
+		TList* list = dynamic_cast<TList*>(obj);
+		if(!list)
+			return nullptr;
+		list->SetOwner(kTRUE);
+		TIter nextHist(list);
+		while(TObject* h = nextHist())
+			if(TH1* hist = dynamic_cast<TH1*>(h))
+				hist->SetDirectory(nullptr);
+	}
+	return dirs;
+}
+}
+
+#endif  // OTSDAQ_DQM_ARTMODULES_DETAIL_DQMPACKET_HH
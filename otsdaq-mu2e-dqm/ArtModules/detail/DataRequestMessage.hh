@@ -1,24 +1,36 @@
 #ifndef OTSDAQ_DQM_ARTMODULES_DETAIL_DATAREQUESTMESSAGE_HH
 #define OTSDAQ_DQM_ARTMODULES_DETAIL_DATAREQUESTMESSAGE_HH
 
+#include <cstdint>
+
 namespace ots
 {
+// A request for the buffered raw fragments of the events eventNumber to
+// lastEventNumber (a single event if lastEventNumber is 0). The answer is a
+// DataResponseHeader followed by response_fragment_count DataFragmentHeader,
+// each followed by the fragment bytes.
 struct DataRequestMessage
 {
 	uint32_t eventNumber;
 	bool     wantMWPC;
 	bool     wantSTIB;
 	uint64_t request_magic;
+	uint32_t lastEventNumber;
 
 	DataRequestMessage()
-	    : eventNumber(0), wantMWPC(false), wantSTIB(false), request_magic(0)
+	    : eventNumber(0), wantMWPC(false), wantSTIB(false), request_magic(0), lastEventNumber(0)
 	{
 	}
 	DataRequestMessage(uint32_t e, bool m, bool s)
-	    : eventNumber(e), wantMWPC(m), wantSTIB(s), request_magic(0xAAAABBBBCCCCDDDD)
+	    : eventNumber(e), wantMWPC(m), wantSTIB(s), request_magic(0xAAAABBBBCCCCDDDD), lastEventNumber(0)
+	{
+	}
+	DataRequestMessage(uint32_t first, uint32_t last)
+	    : eventNumber(first), wantMWPC(false), wantSTIB(false), request_magic(0xAAAABBBBCCCCDDDD), lastEventNumber(last)
 	{
 	}
-	bool isValid() const { return request_magic == 0xAAAABBBBCCCCDDDD; }
+	bool     isValid() const { return request_magic == 0xAAAABBBBCCCCDDDD; }
+	uint32_t lastEvent() const { return lastEventNumber > eventNumber ? lastEventNumber : eventNumber; }
 };
 
 struct DataResponseHeader
@@ -44,6 +56,25 @@ struct DataResponseHeader
 	}
 	bool isValid() const { return response_magic == 0xABCDABCDABCDABCD; }
 };
+
+// precedes each fragment of a response
+struct DataFragmentHeader
+{
+	uint64_t event_number;
+	uint64_t fragment_size_bytes;
+	uint16_t fragment_id;
+	uint8_t  fragment_type;
+	uint8_t  reserved[5];
+
+	DataFragmentHeader()
+	    : event_number(0), fragment_size_bytes(0), fragment_id(0), fragment_type(0), reserved{}
+	{
+	}
+	DataFragmentHeader(uint64_t event, uint16_t id, uint8_t type, uint64_t size)
+	    : event_number(event), fragment_size_bytes(size), fragment_id(id), fragment_type(type), reserved{}
+	{
+	}
+};
 }
 
 #endif  // OTSDAQ_DQM_ARTMODULES_DETAIL_DATAREQUESTMESSAGE_HH
@@ -6,7 +6,8 @@ namespace detail {
 enum class Subsystem
 {
 	Tracker,
-	Calorimeter
+	Calorimeter,
+	CRV
 };
 }
 }  
@@ -0,0 +1,40 @@
+#ifndef _CaloFillEngine_h_
+#define _CaloFillEngine_h_
+
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMFillBuffer.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistSpec.h"
+
+#include <cstddef>
+
+namespace ots {
+
+  // Calo fill engine: the summary schemas and fills of the calo DQM,
+  // independent of art.
+
+  enum CaloSummaryHist { kCaloNHits = 0, kCaloNClusters, kCaloClusterEnergy, kNCaloSummaryHists };
+
+  // onspill and offspill (cosmics: few hits, MIP-like clusters) binnings
+  inline constexpr DQMHistSpec kCaloOnspillSchema[kNCaloSummaryHists] = {
+    { "Calo hits, nHits; nCaloHits; Events/60"             , 200, 0, 12e3 },
+    { "Calo clusters, nClusters; nClusters; Events"        , 100, 0, 100  },
+    { "Calo clusters, caloEnergy; E[MeV]; Events/(5 MeV)"  , 400, 0, 2e3  }};
+  inline constexpr DQMHistSpec kCaloOffspillSchema[kNCaloSummaryHists] = {
+    { "Calo hits, nHits; nCaloHits; Events/2"              , 200, 0, 400  },
+    { "Calo clusters, nClusters; nClusters; Events"        ,  20, 0, 20   },
+    { "Calo clusters, caloEnergy; E[MeV]; Events/(1 MeV)"  , 500, 0, 500  }};
+  static_assert(schemaIsValid(kCaloOnspillSchema) && schemaIsValid(kCaloOffspillSchema), "invalid Calo summary schema");
+
+  // Clusters is any range of objects with energyDep(), e.g. a
+  // mu2e::CaloClusterCollection
+  template <typename Clusters>
+  void calo_summary_fill(DQMFillBuffer& buffer, size_t nHits, const Clusters& clusters) {
+    buffer.AddUnchecked(kCaloNHits    , nHits);
+    buffer.AddUnchecked(kCaloNClusters, clusters.size());
+    for (const auto& cluster : clusters) {
+      buffer.AddUnchecked(kCaloClusterEnergy, cluster.energyDep());
+    }
+  }
+
+} // namespace ots
+
+#endif
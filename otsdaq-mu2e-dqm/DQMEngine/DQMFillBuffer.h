@@ -0,0 +1,112 @@
+#ifndef _DQMFillBuffer_h_
+#define _DQMFillBuffer_h_
+
+#include <TH1.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace ots {
+
+  // Event-scoped fill buffer.
+  //
+  // During the event the modules only append (histogram id, value) pairs; the
+  // id is the position of the target histogram in the order it was added with
+  // AddTarget. Flush() groups the values by histogram and issues one FillN per
+  // touched histogram, so each histogram is visited once per event instead of
+  // once per value. Sparse events (few values, many targets, e.g. the straw
+  // pedestals) are grouped with a sort, dense ones with a counting sort.
+  class DQMFillBuffer {
+  public:
+    DQMFillBuffer(){};
+    virtual ~DQMFillBuffer(void){};
+
+    // the id of the target is its position in the buffer
+    size_t AddTarget(TH1* Hist) {
+      targets_.push_back(Hist);
+      return targets_.size() - 1;
+    }
+
+    size_t nTargets() const { return targets_.size(); }
+    size_t size()     const { return entries_.size(); }
+
+    void Reserve(size_t n) { entries_.reserve(n); }
+
+    // bytes held by the buffer and its scratch space (grown to the largest event)
+    size_t capacityBytes() const {
+      return targets_.capacity()*sizeof(TH1*) + entries_.capacity()*sizeof(entry_) +
+	(offsets_.capacity() + cursor_.capacity())*sizeof(size_t) + sorted_.capacity()*sizeof(double);
+    }
+
+    // ids outside the booked targets are dropped
+    void Add(unsigned int id, double value) {
+      if (id >= targets_.size()) return;
+      entries_.push_back(entry_{id, value});
+    }
+
+    // for ids that are known to be booked, e.g. schema enums (DQMHistSchema.h)
+    void AddUnchecked(unsigned int id, double value) {
+      entries_.push_back(entry_{id, value});
+    }
+
+    // append a span of values for the same histogram
+    void Add(unsigned int id, const double* first, size_t n) {
+      if (id >= targets_.size()) return;
+      for (size_t i = 0; i < n; ++i) entries_.push_back(entry_{id, first[i]});
+    }
+
+    // fill the targets with all the values collected since the last flush
+    void Flush() {
+      size_t n = entries_.size();
+      if (n == 0) return;
+
+      sorted_.resize(n);
+      if (n*kSparseRatio < targets_.size()) {
+        std::sort(entries_.begin(), entries_.end(),
+                  [](const entry_& a, const entry_& b) { return a.id < b.id; });
+        for (size_t i = 0; i < n; ++i) sorted_[i] = entries_[i].value;
+        size_t first = 0;
+        for (size_t i = 1; i <= n; ++i) {
+          if (i < n && entries_[i].id == entries_[first].id) continue;
+          targets_[entries_[first].id]->FillN(int(i - first), &sorted_[first], nullptr);
+          first = i;
+        }
+      } else {
+        size_t nTargets = targets_.size();
+        offsets_.assign(nTargets + 1, 0);
+        for (const entry_& e : entries_) ++offsets_[e.id + 1];
+        for (size_t k = 1; k <= nTargets; ++k) offsets_[k] += offsets_[k - 1];
+
+        cursor_.assign(offsets_.begin(), offsets_.end() - 1);
+        for (const entry_& e : entries_) sorted_[cursor_[e.id]++] = e.value;
+
+        for (size_t id = 0; id < nTargets; ++id) {
+          size_t count = offsets_[id + 1] - offsets_[id];
+          if (count == 0) continue;
+          targets_[id]->FillN(int(count), &sorted_[offsets_[id]], nullptr);
+        }
+      }
+
+      entries_.clear();
+    }
+
+  private:
+    enum { kSparseRatio = 16 };
+
+    struct entry_ {
+      unsigned int id;
+      double       value;
+    };
+
+    std::vector<TH1*>    targets_;
+    std::vector<entry_>  entries_;
+
+    // scratch space reused across events
+    std::vector<size_t>  offsets_, cursor_;
+    std::vector<double>  sorted_;
+  };
+
+} // namespace ots
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef _DQMHistMemory_h_
+#define _DQMHistMemory_h_
+
+#include <TArrayC.h>
+#include <TArrayD.h>
+#include <TArrayF.h>
+#include <TArrayI.h>
+#include <TArrayS.h>
+#include <TClass.h>
+#include <TH1.h>
+#include <TH2.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace ots {
+
+  // Bytes owned by a DQM module or one of its sets, by kind:
+  //   bins     histogram bin and sumw2 arrays, dense per-channel counters
+  //   objects  ROOT object overhead (the TH1 and its axes, name, title)
+  //   buffers  fill buffers and serialization buffers, reused across events
+  //   queued   publish snapshots waiting for the sender
+  struct DQMMemoryUsage {
+    size_t bins = 0, objects = 0, buffers = 0, queued = 0;
+
+    size_t total() const { return bins + objects + buffers + queued; }
+
+    DQMMemoryUsage& operator+=(const DQMMemoryUsage& other) {
+      bins    += other.bins;
+      objects += other.objects;
+      buffers += other.buffers;
+      queued  += other.queued;
+      return *this;
+    }
+
+    // h may be NULL (not booked)
+    void addHist(const TH1* h) {
+      if (!h) return;
+      bins    += histBinBytes(h);
+      objects += histObjectBytes(h);
+    }
+
+    template <typename T>
+    void addVector(const std::vector<T>& v) { bins += v.capacity()*sizeof(T); }
+
+    // bin content and sumw2: the content is the TArray base of TH1F/TH1D/...
+    static size_t histBinBytes(const TH1* h) {
+      size_t nCells = h->GetNcells(), element = sizeof(double);
+      if      (dynamic_cast<const TArrayF*>(h)) element = sizeof(Float_t);
+      else if (dynamic_cast<const TArrayI*>(h)) element = sizeof(Int_t);
+      else if (dynamic_cast<const TArrayS*>(h)) element = sizeof(Short_t);
+      else if (dynamic_cast<const TArrayC*>(h)) element = sizeof(Char_t);
+      return nCells*element + h->GetSumw2N()*sizeof(double);
+    }
+
+    // the TH1 itself holds the three axes; variable bin edges are extra
+    static size_t histObjectBytes(const TH1* h) {
+      size_t edges = h->GetXaxis()->GetXbins()->GetSize() + h->GetYaxis()->GetXbins()->GetSize();
+      return h->IsA()->Size() + edges*sizeof(double) + std::string(h->GetName()).size() + std::string(h->GetTitle()).size();
+    }
+  };
+
+  // Degradation of a set above the module's soft memory limit: the bins are
+  // merged (each axis by its smallest divisor, so the range is unchanged),
+  // then reduced to a single bin per axis, which keeps the entries and the
+  // statistics (mean, RMS) only. An axis with a prime number of bins goes to
+  // a single bin at the first step.
+  enum DQMDegradeLevel { kFullBinning = 0, kCoarseBinning, kStatsOnly };
+
+  inline const char* degradeLevelName(DQMDegradeLevel Level) {
+    static const char* names[] = {"full binning", "coarse binning", "stats only"};
+    return names[Level];
+  }
+
+  namespace detail {
+    inline int smallestDivisor(int n) {
+      for (int d = 2; d*d <= n; ++d) {
+	if (n % d == 0) return d;
+      }
+      return n;
+    }
+  } // namespace detail
+
+  // rebins h in place to Level; the fill-buffer targets (the TH1 pointers)
+  // stay valid
+  inline void degradeHist(TH1* h, DQMDegradeLevel Level) {
+    if (Level == kFullBinning) return;
+    int nx = h->GetNbinsX(), ny = h->GetNbinsY();
+    int gx = (Level == kStatsOnly) ? nx : detail::smallestDivisor(nx);
+    int gy = (Level == kStatsOnly) ? ny : detail::smallestDivisor(ny);
+    if (h->GetDimension() == 1) {
+      if (nx > 1) h->Rebin(gx);
+    } else if (h->GetDimension() == 2) {
+      if (nx > 1 || ny > 1) static_cast<TH2*>(h)->Rebin2D(nx > 1 ? gx : 1, ny > 1 ? gy : 1);
+    }
+  }
+
+} // namespace ots
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef _DQMHistSet_h_
+#define _DQMHistSet_h_
+
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMFillBuffer.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistSpec.h"
+
+#include <TH1F.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ots {
+
+  // Histogram set owning its histograms, outside of any ROOT directory.
+  //
+  // The art-free counterpart of the XxxDQMHistoContainer: the same schemas
+  // and fill-buffer ids, without TFileService. Used by the front-ends, the
+  // tests and the benchmarks to drive the fill engines.
+  class DQMHistSet {
+  public:
+    DQMHistSet(std::string DirName = "summary") : dirName(DirName){};
+    virtual ~DQMHistSet(void){};
+
+    std::string   dirName;
+    DQMFillBuffer fillBuffer;   // the id is the position in the set
+
+    // in schema order, so the ids are the schema enum values
+    template <size_t N>
+    void book(const DQMHistSpec (&Schema)[N]) {
+      if (!hists_.empty()) throw std::logic_error("schema booked in a non-empty set (" + dirName + ")");
+      for (const DQMHistSpec& spec : Schema) add(spec.title, spec.nBins, spec.min, spec.max);
+    }
+
+    TH1F* add(const std::string& Title, int nBins, double min, double max) {
+      TH1F* h = new TH1F(Title.c_str(), Title.c_str(), nBins, min, max);
+      h->SetDirectory(nullptr);
+      hists_.emplace_back(h);
+      fillBuffer.AddTarget(h);
+      return h;
+    }
+
+    TH1F*  hist(size_t i) const { return hists_[i].get(); }
+    size_t size()         const { return hists_.size(); }
+
+    void Reset() {
+      for (auto& h : hists_) h->Reset();
+    }
+
+  private:
+    std::vector<std::unique_ptr<TH1F>> hists_;
+  };
+
+} // namespace ots
+
+#endif
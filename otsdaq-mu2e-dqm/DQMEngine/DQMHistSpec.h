@@ -0,0 +1,49 @@
+#ifndef _DQMHistSpec_h_
+#define _DQMHistSpec_h_
+
+#include <cstddef>
+#include <type_traits>
+
+namespace ots {
+
+  // One histogram of a summary set. The title doubles as the ROOT name, as
+  // the receivers key on it; the directory is the one of the set.
+  struct DQMHistSpec {
+    const char* title;
+    int         nBins;
+    double      min, max;
+  };
+
+  namespace detail {
+    constexpr bool sameString(const char* a, const char* b) {
+      while (*a && *a == *b) { ++a; ++b; }
+      return *a == *b;
+    }
+  }
+
+  // compile-time consistency of a schema: a valid binning for every entry and
+  // no two entries with the same name. The number of entries is checked
+  // against the enum that indexes it by the array bound itself.
+  template <size_t N>
+  constexpr bool schemaIsValid(const DQMHistSpec (&Schema)[N]) {
+    for (size_t i=0; i<N; ++i){
+      if (Schema[i].nBins <= 0 || !(Schema[i].min < Schema[i].max)) return false;
+      for (size_t j=0; j<i; ++j){
+	if (detail::sameString(Schema[i].title, Schema[j].title)) return false;
+      }
+    }
+    return true;
+  }
+
+  // fill of a set booked from a schema (a DQMHistSet or a XxxDQMHistoContainer)
+  // by the enum indexing the schema, which is the position of the histogram
+  // in the set: no range check, the schema fixes the booking
+  template <typename Set, typename Id>
+  inline void schemaFill(Set* set, Id Hist, double value) {
+    static_assert(std::is_enum<Id>::value, "schema fills take the schema enum");
+    set->fillBuffer.AddUnchecked(Hist, value);
+  }
+
+} // namespace ots
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef _DQMStageTimers_h_
+#define _DQMStageTimers_h_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ots {
+
+  // Hot-path timing of the stages of a DQM module (fetch, fill, publish, ...).
+  //
+  // A Scope reads the steady clock at construction and destruction and adds
+  // the duration to a log-bucketed histogram: 4 buckets per power of two of
+  // nanoseconds, so a percentile is known to 12% whatever the range. Each
+  // thread fills its own buckets (the handlers of a module may run in a TBB
+  // arena) with plain relaxed stores, found through a per-thread table
+  // indexed by the timer id, so a scope costs two clock reads and no shared
+  // writes. The publishing thread merges the threads; interval() returns
+  // the percentiles since the previous call.
+  class DQMStageTimers {
+  public:
+    enum { kMaxStages = 16, kSubBuckets = 4, kNBuckets = kSubBuckets*44 };   // up to 2^44 ns (5 h)
+
+    typedef std::chrono::steady_clock clock_t;
+
+    struct summary_t {
+      uint64_t n    = 0;
+      double   mean = 0, p50 = 0, p90 = 0, p99 = 0, max = 0;   // ns
+    };
+
+    // stops (records) the stage at destruction; a default Scope does nothing
+    class Scope {
+    public:
+      Scope() : timers_(nullptr), stage_(0){};
+      Scope(DQMStageTimers* Timers, size_t Stage) : timers_(Timers), stage_(Stage) {
+	if (timers_) start_ = clock_t::now();
+      }
+      Scope(Scope&& other) : timers_(other.timers_), stage_(other.stage_), start_(other.start_) { other.timers_ = nullptr; }
+      Scope(const Scope&)            = delete;
+      Scope& operator=(const Scope&) = delete;
+      ~Scope() { stop(); }
+
+      void stop() {
+	if (!timers_) return;
+	timers_->record(stage_, std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t::now() - start_).count());
+	timers_ = nullptr;
+      }
+
+    private:
+      DQMStageTimers*     timers_;
+      size_t              stage_;
+      clock_t::time_point start_;
+    };
+
+    DQMStageTimers() : id_(nextId_()++){};
+    virtual ~DQMStageTimers(void){};
+
+    // register the stages before the first event; returns the stage index
+    size_t addStage(const std::string& Name) {
+      if (names_.size() >= kMaxStages) {
+	throw std::logic_error("more than " + std::to_string(kMaxStages) + " timed stages (" + Name + ")");
+      }
+      names_.push_back(Name);
+      last_.emplace_back(kNBuckets, 0);
+      lastSums_.push_back(0);
+      return names_.size() - 1;
+    }
+
+    size_t             nStages()             const { return names_.size(); }
+    const std::string& stageName(size_t Stage) const { return names_[Stage]; }
+
+    Scope time(size_t Stage) { return Scope(this, Stage); }
+
+    void record(size_t Stage, uint64_t Nanoseconds) {
+      slot_t*                slot = slot_();
+      std::atomic<uint64_t>& c    = slot->counts[Stage][bucket(Nanoseconds)];
+      c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      std::atomic<uint64_t>& s    = slot->sums[Stage];
+      s.store(s.load(std::memory_order_relaxed) + Nanoseconds, std::memory_order_relaxed);
+    }
+
+    // the summary of each stage over the records since the previous call
+    std::vector<summary_t> interval() {
+      std::vector<summary_t> out(names_.size());
+      std::vector<uint64_t>  merged(kNBuckets);
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (size_t st = 0; st < names_.size(); ++st) {
+	std::fill(merged.begin(), merged.end(), 0);
+	uint64_t sum(0);
+	for (auto& slot : slots_) {
+	  for (size_t b = 0; b < kNBuckets; ++b) merged[b] += slot->counts[st][b].load(std::memory_order_relaxed);
+	  sum += slot->sums[st].load(std::memory_order_relaxed);
+	}
+	summary_t& s = out[st];
+	for (size_t b = 0; b < kNBuckets; ++b) {
+	  uint64_t n = merged[b];
+	  merged[b] -= last_[st][b];
+	  last_[st][b] = n;
+	  s.n += merged[b];
+	}
+	uint64_t lastSum = lastSums_[st];
+	lastSums_[st]    = sum;
+	if (s.n == 0) continue;
+	s.mean = double(sum - lastSum)/s.n;
+	s.p50  = quantile_(merged, s.n, 0.50);
+	s.p90  = quantile_(merged, s.n, 0.90);
+	s.p99  = quantile_(merged, s.n, 0.99);
+	for (size_t b = kNBuckets; b-- > 0;) {
+	  if (merged[b] > 0) {
+	    s.max = bucketHigh(b);
+	    break;
+	  }
+	}
+      }
+      return out;
+    }
+
+    // kSubBuckets buckets per power of two, exact below 2*kSubBuckets ns
+    static size_t bucket(uint64_t ns) {
+      if (ns < kSubBuckets) return ns;
+      int    msb = 63 - __builtin_clzll(ns);
+      size_t b   = kSubBuckets*(msb - 1) + ((ns >> (msb - 2)) & (kSubBuckets - 1));
+      return (b < kNBuckets) ? b : kNBuckets - 1;
+    }
+
+    static double bucketLow(size_t b) {
+      if (b < kSubBuckets) return b;
+      int msb = b/kSubBuckets + 1;
+      return double((kSubBuckets + b%kSubBuckets) << (msb - 2));
+    }
+
+    static double bucketHigh(size_t b) { return (b < kSubBuckets) ? b + 1 : bucketLow(b + 1); }
+
+  private:
+    struct slot_t {
+      std::array<std::array<std::atomic<uint64_t>, kNBuckets>, kMaxStages> counts{};
+      std::array<std::atomic<uint64_t>, kMaxStages>                         sums{};
+    };
+
+    static std::atomic<size_t>& nextId_() {
+      static std::atomic<size_t> id(0);
+      return id;
+    }
+
+    // the buckets of the calling thread, created at its first record
+    slot_t* slot_() {
+      thread_local std::vector<slot_t*> table;
+      if (id_ < table.size() && table[id_]) return table[id_];
+      std::lock_guard<std::mutex> lock(mutex_);
+      slots_.emplace_back(new slot_t());
+      if (table.size() <= id_) table.resize(id_ + 1, nullptr);
+      table[id_] = slots_.back().get();
+      return table[id_];
+    }
+
+    // linear interpolation inside the bucket holding the quantile
+    static double quantile_(const std::vector<uint64_t>& counts, uint64_t n, double q) {
+      double   target = q*n;
+      uint64_t below(0);
+      for (size_t b = 0; b < counts.size(); ++b) {
+	if (counts[b] == 0) continue;
+	if (below + counts[b] >= target) {
+	  double f = (target - below)/counts[b];
+	  return bucketLow(b) + f*(bucketHigh(b) - bucketLow(b));
+	}
+	below += counts[b];
+      }
+      return bucketHigh(counts.size() - 1);
+    }
+
+    size_t                                id_;        // index in the per-thread tables, never reused
+    std::vector<std::string>              names_;
+    std::mutex                            mutex_;
+    std::vector<std::unique_ptr<slot_t>>  slots_;     // one per thread that recorded
+    std::vector<std::vector<uint64_t>>    last_;      // merged counts at the previous interval()
+    std::vector<uint64_t>                 lastSums_;
+  };
+
+} // namespace ots
+
+#endif
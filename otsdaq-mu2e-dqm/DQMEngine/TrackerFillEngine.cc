@@ -0,0 +1,50 @@
+#include "otsdaq-mu2e-dqm/DQMEngine/TrackerFillEngine.h"
+
+#include <algorithm>
+
+namespace ots {
+
+  int pedestal_est(const mu2e::TrkTypes::ADCWaveform& adc) {
+    int sum{0};
+
+    if (adc.size() == 0) return 0;
+
+    size_t i_max = adc.size() > 3 ? 3 : adc.size();
+
+    for (size_t i = 0; i < i_max; ++i) {
+      sum += adc[i];
+    }
+    int average = sum / i_max;
+    return average;
+  }
+
+  unsigned short max_adc(const mu2e::TrkTypes::ADCWaveform& adcs) {
+    unsigned short maxadc{0};
+
+    for (auto adc : adcs) {
+      maxadc = std::max(maxadc, adc);
+    }
+
+    return maxadc;
+  }
+
+  void tracker_summary_fill(DQMFillBuffer& buffer, const mu2e::StrawId& sid) {
+    buffer.AddUnchecked(kTrackerPanelOccupancy, sid.uniquePanel());
+    buffer.AddUnchecked(kTrackerPlaneOccupancy, sid.plane());
+  }
+
+  bool tracker_pedestal_fill(DQMFillBuffer& buffer, int data, const mu2e::StrawId& sid) {
+    unsigned int histIdx = pedestal_hist_id(sid);
+    if (histIdx >= buffer.nTargets()) return false;
+    buffer.AddUnchecked(histIdx, data);
+    return true;
+  }
+
+  bool tracker_panel_fill(DQMFillBuffer& buffer, const mu2e::StrawId& sid) {
+    unsigned int histIdx = panel_hist_id(sid);
+    if (histIdx >= buffer.nTargets()) return false;
+    buffer.AddUnchecked(histIdx, sid.straw());
+    return true;
+  }
+
+} // namespace ots
@@ -0,0 +1,47 @@
+#ifndef _TrackerFillEngine_h_
+#define _TrackerFillEngine_h_
+
+#include "Offline/DataProducts/inc/StrawId.hh"
+#include "Offline/DataProducts/inc/TrkTypes.hh"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMFillBuffer.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistSpec.h"
+
+namespace ots {
+
+  // Tracker fill engine: the per-hit quantities and fill-buffer ids of the
+  // tracker DQM, independent of art. The fills only append to the fill
+  // buffer; the caller flushes it once per event.
+
+  enum TrackerSummaryHist { kTrackerPanelOccupancy = 0, kTrackerPlaneOccupancy, kNTrackerSummaryHists };
+
+  inline constexpr DQMHistSpec kTrackerSummarySchema[kNTrackerSummaryHists] = {
+    { "PanelOccupancy", 220, 0, 220 },
+    { "PlaneOccupancy",  40, 0, 40  }};
+  static_assert(schemaIsValid(kTrackerSummarySchema), "invalid Tracker summary schema");
+
+  // mean of the first (up to) 3 samples
+  int pedestal_est(const mu2e::TrkTypes::ADCWaveform& adc);
+
+  unsigned short max_adc(const mu2e::TrkTypes::ADCWaveform& adcs);
+
+  // pedestals are booked plane -> panel -> straw
+  inline unsigned int pedestal_hist_id(const mu2e::StrawId& sid) {
+    return (sid.plane()*mu2e::StrawId::_npanels + sid.panel())*mu2e::StrawId::_nstraws + sid.straw();
+  }
+
+  // panel histograms are booked plane -> panel
+  inline unsigned int panel_hist_id(const mu2e::StrawId& sid) {
+    return sid.plane()*mu2e::StrawId::_npanels + sid.panel();
+  }
+
+  // the summary ids come from kTrackerSummarySchema
+  void tracker_summary_fill(DQMFillBuffer& buffer, const mu2e::StrawId& sid);
+
+  // the pedestal and panel ids are range-checked against the booked targets,
+  // as the straw ids come from the raw data: false if out of range
+  bool tracker_pedestal_fill(DQMFillBuffer& buffer, int data, const mu2e::StrawId& sid);
+  bool tracker_panel_fill(DQMFillBuffer& buffer, const mu2e::StrawId& sid);
+
+} // namespace ots
+
+#endif
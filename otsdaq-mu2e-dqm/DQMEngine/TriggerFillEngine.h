@@ -0,0 +1,21 @@
+#ifndef _TriggerFillEngine_h_
+#define _TriggerFillEngine_h_
+
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistSpec.h"
+
+namespace ots {
+
+  // Trigger fill engine: the summary schema of the trigger DQM, independent
+  // of art. The fill reads the TriggerResults and stays in TriggerDQM.
+
+  enum TriggerSummaryHist { kTriggerPaths = 0, kTriggerCounts, kNTriggerSummaryHists };
+
+  // the path IDs are the same in both spill states, only the sets differ
+  inline constexpr DQMHistSpec kTriggerSummarySchema[kNTriggerSummaryHists] = {
+    { "Trigger paths" , 101, 99.5, 200.5 },
+    { "Trigger counts",   1, 0   , 1     }};
+  static_assert(schemaIsValid(kTriggerSummarySchema), "invalid Trigger summary schema");
+
+} // namespace ots
+
+#endif
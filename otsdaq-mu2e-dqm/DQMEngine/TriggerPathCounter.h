@@ -0,0 +1,110 @@
+#ifndef _TriggerPathCounter_h_
+#define _TriggerPathCounter_h_
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+namespace ots {
+
+  // Trigger path fill engine: events per combination of accepted paths.
+  //
+  // Per event only the mask of the accepted paths (one bit per path, see
+  // DQMTriggerTable::acceptedPaths) is counted; the path and module counts,
+  // the path correlations and the bandwidth ordering are derived at publish
+  // time from the distinct combinations, so that cost is independent of the
+  // number of events.
+  class TriggerPathCounter {
+  public:
+    enum { kMaxPaths = 64 };
+
+    struct rollup_t {
+      std::vector<unsigned long> pathCounts;    // events accepted by the path
+      std::vector<unsigned long> uniqueCounts;  // events accepted by that path only
+      std::vector<unsigned long> pairCounts;    // [p*nPaths + q]: accepted by both
+      std::vector<unsigned long> moduleCounts;  // events passing the module, once per event
+      std::vector<int>           order;         // paths by decreasing rate
+      std::vector<unsigned long> firstCounts;   // [k]: events whose highest-rate path is order[k]
+    };
+
+    TriggerPathCounter() : nEvents_(0){};
+    virtual ~TriggerPathCounter(void){};
+
+    void add(uint64_t AcceptedPaths) {
+      ++nEvents_;
+      ++maskCounts_[AcceptedPaths];
+    }
+
+    void clear() {
+      maskCounts_.clear();
+      nEvents_ = 0;
+    }
+
+    unsigned long nEvents()       const { return nEvents_; }
+    size_t        nCombinations() const { return maskCounts_.size(); }
+
+    // PathModules(p) gives the module indices (< nModules) run by path p
+    template <typename PathModules>
+    void rollup(size_t nPaths, size_t nModules, PathModules pathModules, rollup_t& r) const {
+      nPaths = std::min(nPaths, size_t(kMaxPaths));
+      r.pathCounts  .assign(nPaths, 0);
+      r.uniqueCounts.assign(nPaths, 0);
+      r.pairCounts  .assign(nPaths*nPaths, 0);
+      r.moduleCounts.assign(nModules, 0);
+      moduleStamp_  .assign(nModules, 0);
+      unsigned long stamp(0);
+
+      for (const auto& mc : maskCounts_) {
+	uint64_t      mask = mc.first;
+	unsigned long n    = mc.second;
+	if (mask == 0) continue;
+	++stamp;
+	for (uint64_t bits = mask; bits; bits &= bits - 1) {
+	  size_t p = __builtin_ctzll(bits);
+	  if (p >= nPaths) break;
+	  r.pathCounts[p] += n;
+	  if ((mask & (mask - 1)) == 0) r.uniqueCounts[p] += n;
+	  for (uint64_t other = mask; other; other &= other - 1) {
+	    size_t q = __builtin_ctzll(other);
+	    if (q < nPaths) r.pairCounts[p*nPaths + q] += n;
+	  }
+	  //a module is counted once per event even if several accepted paths run it
+	  for (int m : pathModules(p)) {
+	    if (moduleStamp_[m] == stamp) continue;
+	    moduleStamp_[m]    = stamp;
+	    r.moduleCounts[m] += n;
+	  }
+	}
+      }
+
+      //bandwidth: the cumulative rate counts each event once, in the
+      //highest-rate path that accepted it
+      r.order.resize(nPaths);
+      rank_  .resize(nPaths);
+      std::iota(r.order.begin(), r.order.end(), 0);
+      std::sort(r.order.begin(), r.order.end(), [&](int a, int b) { return r.pathCounts[a] > r.pathCounts[b]; });
+      for (size_t k=0; k<nPaths; ++k) rank_[r.order[k]] = k;
+      r.firstCounts.assign(nPaths, 0);
+      for (const auto& mc : maskCounts_) {
+	size_t first = nPaths;
+	for (uint64_t bits = mc.first; bits; bits &= bits - 1) {
+	  size_t p = __builtin_ctzll(bits);
+	  if (p >= nPaths) break;
+	  first = std::min(first, rank_[p]);
+	}
+	if (first < nPaths) r.firstCounts[first] += mc.second;
+      }
+    }
+
+  private:
+    unsigned long                               nEvents_;
+    std::unordered_map<uint64_t, unsigned long> maskCounts_;
+    mutable std::vector<unsigned long>          moduleStamp_;   // rollup scratch
+    mutable std::vector<size_t>                 rank_;
+  };
+
+} // namespace ots
+
+#endif
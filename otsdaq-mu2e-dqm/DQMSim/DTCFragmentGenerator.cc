@@ -0,0 +1,356 @@
+#include "otsdaq-mu2e-dqm/DQMSim/DTCFragmentGenerator.h"
+
+#include "Offline/DataProducts/inc/StrawId.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace ots {
+
+  namespace {
+
+    enum { kTrackerChannelsPerROC = 96, kCaloChannelsPerROC = 20 };
+    enum { kTrackerFirstSamples = 3, kTrackerSamplesPerPacket = 12, kCaloSamplesPerPacket = 8 };
+    enum { kNoiseTableSize = 4096, kMaxPacketsPerBlock = 0x7FF };
+
+    void put16(uint8_t* p, uint16_t v) {
+      p[0] = v & 0xFF;
+      p[1] = v >> 8;
+    }
+
+    void put32(uint8_t* p, uint32_t v) {
+      for (int i = 0; i < 4; ++i) p[i] = (v >> 8*i) & 0xFF;
+    }
+
+    void put48(uint8_t* p, uint64_t v) {
+      for (int i = 0; i < 6; ++i) p[i] = (v >> 8*i) & 0xFF;
+    }
+
+    uint32_t get32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24); }
+
+    // the hit packets are bit fields packed LSB first over 128 bits
+    struct bitPacker_ {
+      uint64_t word[2] = {0, 0};
+      int      pos     = 0;
+
+      void put(uint64_t value, int nBits) {
+	value &= (nBits == 64) ? ~0ULL : ((1ULL << nBits) - 1);
+	int w = pos/64, b = pos%64;
+	word[w] |= value << b;
+	if (b + nBits > 64 && w == 0) word[1] |= value >> (64 - b);
+	pos += nBits;
+      }
+
+      void write(uint8_t* p) const {
+	for (int i = 0; i < 8; ++i) {
+	  p[i]     = word[0] >> 8*i;
+	  p[i + 8] = word[1] >> 8*i;
+	}
+      }
+    };
+
+    // value of the normalized pulse at t samples after its start
+    double pulse(double t, double rise, double fall) {
+      if (t <= 0) return 0;
+      if (std::fabs(fall - rise) < 1e-6) return t/rise*std::exp(1. - t/rise);
+      return std::exp(-t/fall) - std::exp(-t/rise);
+    }
+
+  } // namespace
+
+  DTCFragmentGenerator::DTCFragmentGenerator(const DTCGeneratorConfig& Config) :
+    config_(Config), rng_(Config.seed ? Config.seed : 0x9E3779B97F4A7C15ULL) {
+    config_.nDTCs = std::max(1, config_.nDTCs);
+    config_.nROCs = std::min(6, std::max(1, config_.nROCs));
+    nChannels_    = nChannelsPerROC();
+
+    if (config_.subsystem == dtc_format::kTracker) {
+      int nExtra      = std::max(0, (config_.nSamples - kTrackerFirstSamples + kTrackerSamplesPerPacket - 1)/kTrackerSamplesPerPacket);
+      nExtra          = std::min(nExtra, 15);
+      config_.nSamples = kTrackerFirstSamples + nExtra*kTrackerSamplesPerPacket;
+      nPacketsPerHit_ = 1 + nExtra;
+    } else {
+      config_.nSamples = std::min(255, std::max(1, config_.nSamples));
+      nPacketsPerHit_ = 1 + (config_.nSamples + kCaloSamplesPerPacket - 1)/kCaloSamplesPerPacket;
+    }
+    samples_.resize(config_.nSamples);
+
+    // Gaussian draws (Box-Muller), also used for the pedestals
+    std::vector<double> gauss(kNoiseTableSize);
+    for (int i = 0; i < kNoiseTableSize; i += 2) {
+      double r   = std::sqrt(-2.*std::log(1. - uniform_()));
+      double phi = 2.*M_PI*uniform_();
+      gauss[i]     = r*std::cos(phi);
+      gauss[i + 1] = r*std::sin(phi);
+    }
+    noise_.resize(kNoiseTableSize);
+    for (int i = 0; i < kNoiseTableSize; ++i) noise_[i] = std::lround(config_.noise*gauss[i]);
+
+    // exponential pulse heights, as quantiles
+    amplitude_.resize(kNoiseTableSize);
+    for (int i = 0; i < kNoiseTableSize; ++i) amplitude_[i] = -config_.pulseAmplitude*std::log(1. - (i + 0.5)/kNoiseTableSize);
+
+    // channel map: pedestal and state, then the per-ROC draw pools
+    size_t nAll = size_t(config_.nDTCs)*config_.nROCs*nChannels_;
+    pedestals_.resize(nAll);
+    state_.resize(nAll);
+    for (size_t i = 0; i < nAll; ++i) {
+      pedestals_[i] = std::lround(config_.pedestal + config_.pedestalSpread*gauss[next_() % kNoiseTableSize]);
+      double u  = uniform_();
+      state_[i] = (u < config_.deadFraction) ? kDead : (u < config_.deadFraction + config_.hotFraction) ? kHot : kLive;
+    }
+    int hotWeight = std::max(1, int(std::lround(config_.hotFactor)));
+    poolOffsets_.assign(1, 0);
+    for (int d = 0; d < config_.nDTCs; ++d) {
+      for (int r = 0; r < config_.nROCs; ++r) {
+	for (int c = 0; c < nChannels_; ++c) {
+	  uint8_t s = state_[index_(d, r, c)];
+	  int     n = (s == kDead) ? 0 : (s == kHot) ? hotWeight : 1;
+	  pool_.insert(pool_.end(), n, c);
+	}
+	poolOffsets_.push_back(pool_.size());
+      }
+    }
+
+    // hits per ROC
+    double lambda = std::max(0., config_.occupancy);
+    double cdf    = 0;
+    for (int k = 0; lambda > 0 && cdf < 1. - 1e-12 && k < lambda + 20*std::sqrt(lambda) + 20; ++k) {
+      cdf += std::exp(-lambda + k*std::log(lambda) - std::lgamma(k + 1.));
+      poissonCDF_.push_back(cdf);
+    }
+
+    // pulse shape, maximum 1 at peakSample
+    double rise = std::max(0.1, config_.riseSamples), fall = std::max(0.1, config_.fallSamples);
+    double tMax = (std::fabs(fall - rise) < 1e-6) ? rise : std::log(fall/rise)*rise*fall/(fall - rise);
+    double norm = pulse(tMax, rise, fall);
+    double t0   = config_.peakSample - tMax;
+    shape_.resize(config_.nSamples);
+    for (int i = 0; i < config_.nSamples; ++i) shape_[i] = pulse(i - t0, rise, fall)/norm;
+  }
+
+  int DTCFragmentGenerator::nChannelsPerROC() const {
+    return (config_.subsystem == dtc_format::kTracker) ? kTrackerChannelsPerROC : kCaloChannelsPerROC;
+  }
+
+  uint16_t DTCFragmentGenerator::strawIndex(int dtc, int nROCs, int roc, int channel) {
+    int uniquePanel = (dtc*nROCs + roc) % (mu2e::StrawId::_nplanes*mu2e::StrawId::_npanels);
+    return mu2e::StrawId(uniquePanel/mu2e::StrawId::_npanels, uniquePanel % mu2e::StrawId::_npanels, channel).asUint16();
+  }
+
+  unsigned DTCFragmentGenerator::nHits_() {
+    if (poissonCDF_.empty()) return 0;
+    return std::upper_bound(poissonCDF_.begin(), poissonCDF_.end(), uniform_()) - poissonCDF_.begin();
+  }
+
+  void DTCFragmentGenerator::waveform_(int pedestal, int maxADC) {
+    // one draw gives the amplitude and the noise of the first 4 samples
+    uint64_t r         = next_();
+    float    amplitude = amplitude_[r % kNoiseTableSize];
+    for (int i = 0; i < config_.nSamples; ++i) {
+      if (i % 5 == 4) r = next_();
+      else            r >>= 12;
+      int adc     = pedestal + int(amplitude*shape_[i]) + noise_[r % kNoiseTableSize];
+      samples_[i] = std::min(maxADC, std::max(0, adc));
+    }
+  }
+
+  void DTCFragmentGenerator::writeTrackerHit_(uint8_t* p, uint16_t straw, bool error) {
+    uint64_t r = next_();
+    bitPacker_ hit;
+    hit.put(straw, 16);
+    hit.put(r & 0xFFFFFF, 24);             // TDC0
+    hit.put((r >> 24) & 0xF, 4);           // TOT0
+    hit.put(0, 4);                         // EWM counter
+    hit.put((r >> 28) & 0xFFFFFF, 24);     // TDC1
+    hit.put((r >> 52) & 0xF, 4);           // TOT1
+    hit.put(error ? 0x1 : 0, 4);           // error flags
+    hit.put(nPacketsPerHit_ - 1, 4);       // ADC packets
+    hit.put(0, 10);                        // PMP
+    for (int i = 0; i < kTrackerFirstSamples; ++i) hit.put(samples_[i], 10);
+    hit.write(p);
+    p += dtc_format::kPacketBytes;
+
+    for (int k = 1; k < nPacketsPerHit_; ++k, p += dtc_format::kPacketBytes) {
+      bitPacker_ adc;
+      const uint16_t* s = &samples_[kTrackerFirstSamples + (k - 1)*kTrackerSamplesPerPacket];
+      for (int i = 0; i < kTrackerSamplesPerPacket; ++i) adc.put(s[i], 10);
+      adc.write(p);
+    }
+  }
+
+  void DTCFragmentGenerator::writeCaloHit_(uint8_t* p, int roc, int channel, bool error) {
+    int iMax = std::max_element(samples_.begin(), samples_.end()) - samples_.begin();
+    put16(p    , (channel & 0x3F) | ((roc & 0x3FF) << 6));
+    put16(p + 2, error ? 0x1 : 0);
+    put16(p + 4, next_() & 0xFFFF);        // time
+    p[6] = config_.nSamples;
+    p[7] = iMax;
+    p += dtc_format::kPacketBytes;
+    for (int i = 0; i < config_.nSamples; ++i) put16(p + 2*i, samples_[i]);
+  }
+
+  size_t DTCFragmentGenerator::writeBlock_(uint64_t tag, int iDTC, int roc, std::vector<uint8_t>& out) {
+    bool     timeout = accept_(config_.blockErrorRate);
+    unsigned nHits   = timeout ? 0 : nHits_();
+    size_t   begin   = poolOffsets_[iDTC*config_.nROCs + roc], poolSize = poolOffsets_[iDTC*config_.nROCs + roc + 1] - begin;
+    if (poolSize == 0) nHits = 0;
+    nHits = std::min<unsigned>(nHits, kMaxPacketsPerBlock/nPacketsPerHit_);   // 11-bit packet count
+
+    size_t nPackets = size_t(nHits)*nPacketsPerHit_;
+    size_t nBytes   = (1 + nPackets)*dtc_format::kPacketBytes;
+    size_t offset   = out.size();
+    out.resize(offset + nBytes, 0);   // the calo sample packets rely on the zero padding
+    uint8_t* p   = &out[offset];
+    int      dtc = config_.firstDTC + iDTC;
+
+    put16(p, nBytes);
+    p[2] = dtc_format::kDataHeaderPacketType << 4;
+    p[3] = 0x80 | ((config_.subsystem & 0x7) << 4) | (roc & 0x7);
+    put16(p + 4, nPackets & 0x7FF);
+    put48(p + 6, tag);
+    p[12] = timeout ? 0x1 : 0;
+    p[13] = dtc_format::kFormatVersion;
+    p[14] = dtc;
+    p += dtc_format::kPacketBytes;
+
+    int maxADC = (config_.subsystem == dtc_format::kTracker) ? 0x3FF : 0xFFF;
+    for (unsigned h = 0; h < nHits; ++h, p += nPacketsPerHit_*dtc_format::kPacketBytes) {
+      int  channel = pool_[begin + next_() % poolSize];
+      bool error   = accept_(config_.hitErrorRate);
+      bool bad     = accept_(config_.badChannelRate);
+      waveform_(pedestals_[index_(iDTC, roc, channel)], maxADC);
+      if (config_.subsystem == dtc_format::kTracker) {
+	writeTrackerHit_(p, bad ? 0xFFFF : strawIndex(dtc, config_.nROCs, roc, channel), error);
+      } else {
+	writeCaloHit_(p, roc, bad ? 0x3F : channel, error);
+      }
+      stats_.hitErrors   += error;
+      stats_.badChannels += bad;
+    }
+
+    ++stats_.blocks;
+    stats_.blockErrors += timeout;
+    stats_.hits        += nHits;
+    stats_.packets     += nPackets;
+    return nBytes;
+  }
+
+  size_t DTCFragmentGenerator::generateSubEvent(uint64_t EventTag, int iDTC, std::vector<uint8_t>& out) {
+    size_t offset = out.size();
+    out.resize(offset + dtc_format::kSubEventHeaderBytes, 0);
+    size_t nBytes = dtc_format::kSubEventHeaderBytes;
+    for (int r = 0; r < config_.nROCs; ++r) nBytes += writeBlock_(EventTag, iDTC, r, out);
+
+    uint8_t* h = &out[offset];   // out may have been reallocated by the blocks
+    put32(h, nBytes & 0x1FFFFFF);
+    put48(h + 4, EventTag);
+    h[10] = config_.nROCs;
+    h[18] = config_.firstDTC + iDTC;
+    h[19] = config_.subsystem;
+
+    ++stats_.subEvents;
+    return nBytes;
+  }
+
+  size_t DTCFragmentGenerator::writeEvent_(uint64_t EventTag, int firstDTC, int nDTCs, std::vector<uint8_t>& out) {
+    size_t offset = out.size();
+    out.resize(offset + dtc_format::kEventHeaderBytes, 0);
+    size_t nBytes = dtc_format::kEventHeaderBytes;
+    for (int d = firstDTC; d < firstDTC + nDTCs; ++d) nBytes += generateSubEvent(EventTag, d, out);
+
+    uint8_t* h = &out[offset];
+    put32(h, nBytes & 0xFFFFFF);
+    put48(h + 4, EventTag);
+    h[10] = nDTCs;
+
+    ++stats_.events;
+    stats_.bytes += nBytes;
+    return nBytes;
+  }
+
+  size_t DTCFragmentGenerator::generateEvent(uint64_t EventTag, std::vector<uint8_t>& out) {
+    return writeEvent_(EventTag, 0, config_.nDTCs, out);
+  }
+
+  size_t DTCFragmentGenerator::generateDTCEvent(uint64_t EventTag, int iDTC, std::vector<uint8_t>& out) {
+    return writeEvent_(EventTag, iDTC, 1, out);
+  }
+
+  size_t readTrackerHit(const uint8_t* Packet, uint16_t& StrawIndex, std::vector<uint16_t>& Samples) {
+    auto bits = [](const uint8_t* p, int pos, int nBits) {
+      uint32_t v = 0;
+      for (int i = 0; i < nBits; ++i, ++pos) v |= uint32_t((p[pos/8] >> (pos%8)) & 1) << i;
+      return v;
+    };
+    StrawIndex    = Packet[0] | (Packet[1] << 8);
+    size_t nExtra = Packet[10] & 0xF;
+    Samples.resize(kTrackerFirstSamples + nExtra*kTrackerSamplesPerPacket);
+    for (int i = 0; i < kTrackerFirstSamples; ++i) Samples[i] = bits(Packet, 94 + 10*i, 10);
+    for (size_t k = 0; k < nExtra; ++k) {
+      const uint8_t* p = Packet + (k + 1)*dtc_format::kPacketBytes;
+      for (int i = 0; i < kTrackerSamplesPerPacket; ++i) Samples[kTrackerFirstSamples + k*kTrackerSamplesPerPacket + i] = bits(p, 10*i, 10);
+    }
+    return 1 + nExtra;
+  }
+
+  bool walkDTCSubEvent(const uint8_t* SubEvent, size_t Size,
+		       const std::function<void(const DTCBlockView&)>& Block, std::string* Error) {
+    auto fail = [Error](const std::string& what) {
+      if (Error) *Error = what;
+      return false;
+    };
+    if (Size < dtc_format::kSubEventHeaderBytes) return fail("sub-event shorter than its header");
+    size_t nBytes = get32(SubEvent) & 0x1FFFFFF;
+    if (nBytes != Size) return fail("sub-event byte count " + std::to_string(nBytes) + " != " + std::to_string(Size));
+
+    int    nROCs = SubEvent[10], nBlocks = 0;
+    size_t pos   = dtc_format::kSubEventHeaderBytes;
+    while (pos < Size) {
+      const uint8_t* p = SubEvent + pos;
+      if (Size - pos < dtc_format::kPacketBytes) return fail("truncated data header packet");
+      if ((p[2] >> 4) != dtc_format::kDataHeaderPacketType) return fail("not a data header packet");
+      DTCBlockView block;
+      block.byteCount   = p[0] | (p[1] << 8);
+      block.packetCount = (p[4] | (p[5] << 8)) & 0x7FF;
+      block.link        = p[3] & 0x7;
+      block.subsystem   = (p[3] >> 4) & 0x7;
+      block.status      = p[12];
+      block.dtcID       = p[14];
+      block.payload     = p + dtc_format::kPacketBytes;
+      if (block.byteCount != (1 + block.packetCount)*dtc_format::kPacketBytes) return fail("block byte count does not match its packet count");
+      if (block.byteCount > Size - pos) return fail("block beyond the end of the sub-event");
+      Block(block);
+      pos += block.byteCount;
+      ++nBlocks;
+    }
+    if (nBlocks != nROCs) return fail("found " + std::to_string(nBlocks) + " blocks for " + std::to_string(nROCs) + " ROCs");
+    return true;
+  }
+
+  bool walkDTCEvent(const uint8_t* Event, size_t Size,
+		    const std::function<void(const uint8_t* subEvent, size_t size)>& SubEvent, std::string* Error) {
+    auto fail = [Error](const std::string& what) {
+      if (Error) *Error = what;
+      return false;
+    };
+    if (Size < dtc_format::kEventHeaderBytes) return fail("event shorter than its header");
+    size_t nBytes = get32(Event) & 0xFFFFFF;
+    if (nBytes != Size) return fail("event byte count " + std::to_string(nBytes) + " != " + std::to_string(Size));
+
+    int    nDTCs = Event[10], nSubEvents = 0;
+    size_t pos   = dtc_format::kEventHeaderBytes;
+    while (pos < Size) {
+      if (Size - pos < dtc_format::kSubEventHeaderBytes) return fail("truncated sub-event header");
+      size_t n = get32(Event + pos) & 0x1FFFFFF;
+      if (n < dtc_format::kSubEventHeaderBytes || n > Size - pos) return fail("bad sub-event byte count");
+      SubEvent(Event + pos, n);
+      pos += n;
+      ++nSubEvents;
+    }
+    if (nSubEvents != nDTCs) return fail("found " + std::to_string(nSubEvents) + " sub-events for " + std::to_string(nDTCs) + " DTCs");
+    return true;
+  }
+
+} // namespace ots
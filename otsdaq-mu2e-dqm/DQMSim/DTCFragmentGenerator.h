@@ -0,0 +1,166 @@
+#ifndef _DTCFragmentGenerator_h_
+#define _DTCFragmentGenerator_h_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ots {
+
+  // DTC event layout written by the generator (DTC format v2, little endian):
+  //
+  //   event header      24 bytes: byte count (24 bits), event tag (48 bits),
+  //                               number of DTCs, event mode
+  //   sub-event header  48 bytes: byte count (25 bits), event tag, number of
+  //                               ROCs, event mode, source DTC id, subsystem,
+  //                               link status
+  //   data block        one per ROC: a 16-byte data header packet (byte
+  //                               count, packet type 5, link, subsystem,
+  //                               packet count, event tag, status, version,
+  //                               DTC id) and packet count 16-byte packets
+  //
+  // The tracker packets are the hit packets of the TrackerDataDecoder: straw
+  // index, TDC/TOT, error flags, number of extra ADC packets, PMP and the first
+  // 3 samples, followed by ADC packets of 12 10-bit samples. The calo packets
+  // are a 16-byte hit packet (channel, board, error flags, time, number of
+  // samples, sample of the maximum) followed by the 12-bit samples, one per
+  // 16-bit word.
+  namespace dtc_format {
+    enum { kEventHeaderBytes = 24, kSubEventHeaderBytes = 48, kPacketBytes = 16 };
+    enum { kDataHeaderPacketType = 5, kFormatVersion = 2 };
+    enum Subsystem { kTracker = 0, kCalorimeter = 1, kCRV = 2 };
+  }
+
+  struct DTCGeneratorConfig {
+    int      subsystem       = dtc_format::kTracker;
+    int      firstDTC        = 0;       // DTC id of the first sub-event
+    int      nDTCs           = 1;       // sub-events per event
+    int      nROCs           = 6;       // links per DTC
+    double   occupancy       = 10;      // mean hits per ROC and event (Poisson)
+    int      nSamples        = 15;      // tracker: 3 + 12*n; calo: any
+    double   pedestal        = 100;     // mean pedestal [ADC]
+    double   pedestalSpread  = 5;       // channel-to-channel RMS of the pedestal
+    double   noise           = 2;       // sample noise RMS [ADC]
+    double   pulseAmplitude  = 200;     // mean of the (exponential) pulse height
+    double   peakSample      = 5;       // position of the pulse maximum
+    double   riseSamples     = 1.5;     // pulse rise time
+    double   fallSamples     = 4;       // pulse decay time
+    double   deadFraction    = 0;       // channels never hit
+    double   hotFraction     = 0;       // channels hit HotFactor times more often
+    double   hotFactor       = 20;
+    double   blockErrorRate  = 0;       // per block: bad status, no packets (ROC timeout)
+    double   hitErrorRate    = 0;       // per hit: non-zero error flags
+    double   badChannelRate  = 0;       // per hit: channel id outside the detector
+    uint64_t seed            = 1;
+  };
+
+  // Synthesizes DTC events of one subsystem.
+  //
+  // All the channel properties (pedestals, dead and hot channels) are drawn
+  // once from the seed at construction; the per-event work is a few draws of
+  // a xorshift generator and table lookups (Poisson, Gaussian noise, pulse
+  // shape), written into a caller-owned buffer, so the generation runs far
+  // above the DAQ rates and a benchmark is bound by the code it feeds.
+  // Generation is deterministic for a given seed and sequence of calls.
+  class DTCFragmentGenerator {
+  public:
+    struct stats_t {
+      uint64_t events = 0, subEvents = 0, blocks = 0, hits = 0, packets = 0, bytes = 0;
+      uint64_t blockErrors = 0, hitErrors = 0, badChannels = 0;
+    };
+
+    explicit DTCFragmentGenerator(const DTCGeneratorConfig& Config);
+    virtual ~DTCFragmentGenerator(void){};
+
+    // appends one DTC event (event header + nDTCs sub-events); returns the size
+    size_t generateEvent(uint64_t EventTag, std::vector<uint8_t>& out);
+
+    // appends a DTC event holding the sub-event of DTC iDTC only, as read out
+    // by that DTC (one artdaq fragment per DTC); returns the size
+    size_t generateDTCEvent(uint64_t EventTag, int iDTC, std::vector<uint8_t>& out);
+
+    // appends the sub-event of DTC iDTC (0 <= iDTC < nDTCs); returns the size
+    size_t generateSubEvent(uint64_t EventTag, int iDTC, std::vector<uint8_t>& out);
+
+    const DTCGeneratorConfig& config()        const { return config_; }
+    const stats_t&            stats()         const { return stats_; }
+    void                      resetStats()          { stats_ = stats_t(); }
+
+    int  nChannelsPerROC() const;
+    int  pedestal(int iDTC, int roc, int channel) const { return pedestals_[index_(iDTC, roc, channel)]; }
+    bool isDead  (int iDTC, int roc, int channel) const { return state_[index_(iDTC, roc, channel)] == kDead; }
+    bool isHot   (int iDTC, int roc, int channel) const { return state_[index_(iDTC, roc, channel)] == kHot; }
+
+    // tracker: straw index (mu2e::StrawId) of a channel, the ROCs of the DTCs
+    // are the panels in order
+    static uint16_t strawIndex(int dtc, int nROCs, int roc, int channel);
+
+  private:
+    enum ChannelState : uint8_t { kLive = 0, kDead, kHot };
+
+    size_t index_(int iDTC, int roc, int channel) const {
+      return (size_t(iDTC)*config_.nROCs + roc)*nChannels_ + channel;
+    }
+
+    uint64_t next_() {   // xorshift64*
+      rng_ ^= rng_ >> 12;
+      rng_ ^= rng_ << 25;
+      rng_ ^= rng_ >> 27;
+      return rng_*0x2545F4914F6CDD1DULL;
+    }
+    double uniform_() { return (next_() >> 11)*(1./9007199254740992.); }
+    bool   accept_(double rate) { return rate > 0 && uniform_() < rate; }
+
+    unsigned nHits_();
+    size_t   writeEvent_(uint64_t tag, int firstDTC, int nDTCs, std::vector<uint8_t>& out);
+    size_t   writeBlock_(uint64_t tag, int iDTC, int roc, std::vector<uint8_t>& out);
+    void     waveform_(int pedestal, int maxADC);
+    void     writeTrackerHit_(uint8_t* p, uint16_t straw, bool error);
+    void     writeCaloHit_(uint8_t* p, int roc, int channel, bool error);
+
+    DTCGeneratorConfig        config_;
+    int                       nChannels_;
+    int                       nPacketsPerHit_;
+    uint64_t                  rng_;
+    stats_t                   stats_;
+
+    std::vector<int16_t>      pedestals_;    // per channel
+    std::vector<uint8_t>      state_;        // per channel
+    std::vector<uint16_t>     pool_;         // per ROC: the channels to draw hits from
+    std::vector<size_t>       poolOffsets_;  // start of the pool of each ROC
+    std::vector<double>       poissonCDF_;
+    std::vector<int16_t>      noise_;        // Gaussian draws, scaled to the noise
+    std::vector<float>        amplitude_;    // pulse heights
+    std::vector<float>        shape_;        // normalized pulse, per sample
+    std::vector<uint16_t>     samples_;      // scratch waveform
+  };
+
+  // One data block of a sub-event, as read back from the bytes.
+  struct DTCBlockView {
+    int            link;
+    int            subsystem;
+    int            status;
+    int            dtcID;
+    size_t         packetCount;
+    size_t         byteCount;       // including the header packet
+    const uint8_t* payload;         // packetCount*16 bytes
+  };
+
+  // Walk the blocks of a sub-event and check its byte counts; false (and the
+  // reason in Error) if the sub-event is inconsistent with Size
+  bool walkDTCSubEvent(const uint8_t* SubEvent, size_t Size,
+		       const std::function<void(const DTCBlockView&)>& Block, std::string* Error = nullptr);
+
+  // unpack the tracker hit starting at Packet (a block payload): straw index
+  // and ADC samples; returns the number of 16-byte packets of the hit
+  size_t readTrackerHit(const uint8_t* Packet, uint16_t& StrawIndex, std::vector<uint16_t>& Samples);
+
+  // same for an event: the sub-events in order
+  bool walkDTCEvent(const uint8_t* Event, size_t Size,
+		    const std::function<void(const uint8_t* subEvent, size_t size)>& SubEvent, std::string* Error = nullptr);
+
+} // namespace ots
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef _ots_DQMHistoAggregator_h_
+#define _ots_DQMHistoAggregator_h_
+
+#include "otsdaq-mu2e-dqm/FEInterfaces/DQMHistoMerger.h"
+#include "otsdaq/NetworkUtilities/TCPSubscribeClient.h"
+
+#include <TROOT.h>
+
+#include <sys/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ots {
+
+// Subscriber side of a DQM aggregator.
+//
+// One receiving thread per upstream publisher (a DQM module with a sourceId,
+// a load generator or a lower-level aggregator): each thread decodes its
+// packets on its own and only takes the merger lock to add them, so the
+// deserialization of the streams runs in parallel. A thread that loses its
+// upstream reconnects. The merged content is taken out with collect().
+class DQMHistoAggregator {
+public:
+  typedef DQMHistoMerger::packet_t packet_t;
+  typedef std::pair<std::string, int> upstream_t; // address, port
+
+  DQMHistoAggregator(const std::vector<upstream_t> &Upstreams)
+      : upstreams_(Upstreams), running_(false), nPackets_(0), nBytes_(0), nCorrupt_(0) {}
+  virtual ~DQMHistoAggregator(void) { stop(); }
+
+  DQMHistoAggregator(const DQMHistoAggregator &) = delete;
+  DQMHistoAggregator &operator=(const DQMHistoAggregator &) = delete;
+
+  void start() {
+    if (running_) return;
+    ROOT::EnableThreadSafety();
+    running_ = true;
+    clients_.resize(upstreams_.size());
+    for (size_t i = 0; i < upstreams_.size(); ++i)
+      threads_.emplace_back(&DQMHistoAggregator::receive_, this, i);
+  }
+
+  // a thread may be blocked reading an idle upstream: the sockets are shut
+  // down, which fails the reads, so the threads leave without waiting for
+  // the next packet
+  void stop() {
+    running_ = false;
+    {
+      std::lock_guard<std::mutex> lock(clientMutex_);
+      for (auto &client : clients_)
+        if (client) ::shutdown(client->getSocketId(), SHUT_RDWR);
+    }
+    for (std::thread &t : threads_) t.join();
+    threads_.clear();
+    clients_.clear();
+  }
+
+  void collect(packet_t &packet) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    merger_.collect(packet);
+  }
+
+  // copy of the per-source bookkeeping
+  std::map<uint32_t, DQMHistoMerger::source_> sources() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return merger_.sources();
+  }
+
+  unsigned long nPackets() const { return nPackets_; }
+  unsigned long nBytes() const { return nBytes_; }
+  unsigned long nCorrupt() const { return nCorrupt_; }
+
+private:
+  void receive_(size_t index) {
+    TCPSubscribeClient *client = nullptr;
+    while (running_) {
+      if (!client) {
+        client = connect_(index);
+        if (!client) {
+          std::this_thread::sleep_for(std::chrono::seconds(1));
+          continue;
+        }
+      }
+
+      std::string packet;
+      try {
+        packet = client->receivePacket();
+      } catch (...) {
+        // upstream gone (or stop()), reconnect
+        {
+          std::lock_guard<std::mutex> lock(clientMutex_);
+          clients_[index].reset();
+        }
+        client = nullptr;
+        if (running_) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        continue;
+      }
+      if (packet.empty()) continue;
+
+      DQMPacketHeader header;
+      std::unique_ptr<TList> dirs = readDQMPacket(packet, header);
+      if (!dirs) {
+        ++nCorrupt_;
+        continue;
+      }
+      ++nPackets_;
+      nBytes_ += packet.size();
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      merger_.merge(header, dirs.get());
+    }
+  }
+
+  // a client is only published in clients_ while running, so that stop()
+  // sees every socket a thread may block on; it is destroyed by its thread
+  // or after the join
+  TCPSubscribeClient *connect_(size_t index) {
+    const upstream_t &upstream = upstreams_[index];
+    std::unique_ptr<TCPSubscribeClient> client;
+    try {
+      client.reset(new TCPSubscribeClient(upstream.first, upstream.second));
+      client->connect(1);
+    } catch (...) {
+      return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(clientMutex_);
+    if (!running_) return nullptr;
+    clients_[index] = std::move(client);
+    return clients_[index].get();
+  }
+
+  std::vector<upstream_t> upstreams_;
+  std::atomic<bool> running_;
+  std::atomic<unsigned long> nPackets_, nBytes_, nCorrupt_;
+  std::vector<std::thread> threads_;
+  std::mutex clientMutex_;
+  std::vector<std::unique_ptr<TCPSubscribeClient>> clients_;
+  std::mutex mutex_;
+  DQMHistoMerger merger_;
+};
+
+} // namespace ots
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef _ots_DQMHistoMerger_h_
+#define _ots_DQMHistoMerger_h_
+
+#include "otsdaq-mu2e-dqm/ArtModules/detail/DQMPacket.hh"
+
+#include <TH1.h>
+#include <TList.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ots {
+
+// Bin-wise merge of the DQM streams of several publishers.
+//
+// The publishers send the content accumulated since their previous packet
+// (the DQM modules reset after each publish), so the histograms of every
+// accepted packet are added to the merged ones, matched by directory and
+// name. collect() takes the merged content out and restarts from zero: the
+// output is again a delta stream, which lets aggregators be chained into a
+// tree. Packets are tracked per source by sequence number: repeated or
+// older packets are dropped, gaps are counted as lost, and a sequence
+// restarting from 0 is a restarted publisher. Not thread safe: the caller
+// serializes merge() and collect().
+//
+// Each directory of a packet carries its merge mode (see DQMPacket.hh).
+// Snapshot directories (trend rings, time series, timing percentiles) are
+// sent whole at every publish: adding them would sum the same events again
+// at every packet, so they are replaced by the latest packet instead, kept
+// across collect() and only sent again once updated. With several sources
+// publishing the same snapshot the latest packet wins. The rates and means
+// are profiles, whose sums and entries add up like the counts.
+class DQMHistoMerger {
+public:
+  typedef std::map<std::string, std::vector<TH1 *>> packet_t;
+
+  struct source_ {
+    uint32_t lastSequence = 0;
+    unsigned long nPackets = 0, nLost = 0, nDuplicates = 0, nRestarts = 0;
+  };
+
+  DQMHistoMerger() : nMerged_(0), nIncompatible_(0) {}
+  virtual ~DQMHistoMerger(void) {}
+
+  // add the histograms of a decoded packet; false if the packet is dropped
+  bool merge(const DQMPacketHeader &header, TList *dirs) {
+    auto it = sources_.find(header.source);
+    if (it == sources_.end()) {
+      it = sources_.emplace(header.source, source_()).first;
+    } else {
+      source_ &source = it->second;
+      if (header.sequence == 0 && source.lastSequence != 0) {
+        ++source.nRestarts;
+      } else if (header.sequence <= source.lastSequence) {
+        ++source.nDuplicates;
+        return false;
+      } else {
+        source.nLost += header.sequence - source.lastSequence - 1;
+      }
+    }
+    it->second.lastSequence = header.sequence;
+    ++it->second.nPackets;
+
+    for (TObjLink *lnk = dirs->FirstLink(); lnk; lnk = lnk->Next()) {
+      TList *dir = dynamic_cast<TList *>(lnk->GetObject());
+      if (!dir) continue;
+      dir_ &merged = dirs_[dir->GetName()];
+      merged.snapshot = dqmMergeMode(dir->GetName(), lnk->GetOption()) == kMergeSnapshot;
+      merged.updated = true;
+      TIter nextHist(dir);
+      while (TObject *obj = nextHist()) {
+        TH1 *h = dynamic_cast<TH1 *>(obj);
+        if (!h) continue;
+        std::unique_ptr<TH1> &target = merged.hists[h->GetName()];
+        if (!target || merged.snapshot) {
+          target.reset((TH1 *)h->Clone());
+          target->SetDirectory(nullptr);
+        } else if (compatible_(target.get(), h)) {
+          target->Add(h);
+        } else {
+          ++nIncompatible_;
+          continue;
+        }
+        ++nMerged_;
+      }
+    }
+    return true;
+  }
+
+  // detached copies of the merged histograms, which are then reset (the
+  // snapshots are kept, and skipped until updated); the caller owns the
+  // copies
+  void collect(packet_t &packet) {
+    for (auto &dir : dirs_) {
+      if (dir.second.hists.empty()) continue;
+      if (dir.second.snapshot && !dir.second.updated) continue;
+      std::vector<TH1 *> &out = packet[dir.first];
+      out.reserve(out.size() + dir.second.hists.size());
+      for (auto &h : dir.second.hists) {
+        TH1 *copy = (TH1 *)h.second->Clone();
+        copy->SetDirectory(nullptr);
+        if (!dir.second.snapshot) h.second->Reset();
+        out.push_back(copy);
+      }
+      dir.second.updated = false;
+    }
+  }
+
+  const std::map<uint32_t, source_> &sources() const { return sources_; }
+  unsigned long nMerged() const { return nMerged_; }
+  unsigned long nIncompatible() const { return nIncompatible_; }
+
+private:
+  struct dir_ {
+    bool snapshot = false, updated = false;
+    std::unordered_map<std::string, std::unique_ptr<TH1>> hists;
+  };
+
+  // same binning; a mismatch means two publishers disagree on a booking
+  static bool compatible_(const TH1 *a, const TH1 *b) {
+    return a->GetNbinsX() == b->GetNbinsX() && a->GetNbinsY() == b->GetNbinsY() &&
+           a->GetXaxis()->GetXmin() == b->GetXaxis()->GetXmin() &&
+           a->GetXaxis()->GetXmax() == b->GetXaxis()->GetXmax() &&
+           a->GetYaxis()->GetXmin() == b->GetYaxis()->GetXmin() &&
+           a->GetYaxis()->GetXmax() == b->GetYaxis()->GetXmax();
+  }
+
+  std::unordered_map<std::string, dir_> dirs_;
+  std::map<uint32_t, source_> sources_;
+  unsigned long nMerged_, nIncompatible_;
+};
+
+} // namespace ots
+
+#endif
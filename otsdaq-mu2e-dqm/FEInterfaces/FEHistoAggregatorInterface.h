@@ -0,0 +1,70 @@
+#ifndef _ots_FEHistoAggregatorInterface_h_
+#define _ots_FEHistoAggregatorInterface_h_
+
+#include "otsdaq-mu2e-dqm/FEInterfaces/DQMHistoAggregator.h"
+#include "otsdaq/FECore/FEVInterface.h"
+#include "otsdaq/NetworkUtilities/TCPPublishServer.h"
+
+#include <TBufferFile.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ots {
+
+class DQMAsyncSender;
+
+// DQM aggregator front-end.
+//
+// Subscribes to the DQM packet streams of several publishers (art processes
+// running the DQM modules with a sourceId, or lower-level aggregators),
+// merges the same-named histograms with the merge mode of their directory
+// (bin-wise sums, or the latest snapshot, see DQMPacket.hh) and republishes
+// one combined set every PublishPeriodSeconds: on ServerPort, in the same
+// packet format with its own SourceId, so aggregators can be stacked into a
+// reduction tree across nodes; and, optionally, to the visualizer at
+// VisualizerAddress:VisualizerPort through a HistoSender.
+class FEHistoAggregatorInterface : public FEVInterface, public TCPPublishServer {
+public:
+  FEHistoAggregatorInterface(const std::string &interfaceUID,
+                             const ConfigurationTree &theXDAQContextConfigTree,
+                             const std::string &configurationPath);
+  virtual ~FEHistoAggregatorInterface(void);
+
+  void configure(void);
+  void halt(void);
+  void pause(void);
+  void resume(void);
+  void start(std::string runNumber) override;
+  void stop(void);
+
+  bool running(void);
+
+  void universalRead(char *address, char *readValue) override { ; }
+  void universalWrite(char *address, char *writeValue) override { ; }
+
+private:
+  template <typename T>
+  T getParameter_(const std::string &name, T defaultValue);
+  void publish_(void);
+  void report_(void);
+
+  // configuration
+  std::vector<DQMHistoAggregator::upstream_t> upstreams_;
+  uint32_t sourceId_;
+  double   publishSeconds_;
+
+  std::unique_ptr<DQMHistoAggregator> aggregator_;
+  std::unique_ptr<DQMAsyncSender>     visualizer_;
+  TBufferFile                         buffer_;    // reused across packets
+  uint32_t                            sequence_;
+  unsigned long                       nPublished_;
+  std::chrono::steady_clock::time_point nextPublish_;
+};
+
+} // namespace ots
+
+#endif
@@ -0,0 +1,166 @@
+#include "otsdaq-mu2e-dqm/FEInterfaces/FEHistoAggregatorInterface.h"
+#include "otsdaq-mu2e-dqm/ArtModules/DQMAsyncSender.h"
+#include "otsdaq/Macros/CoutMacros.h"
+#include "otsdaq/Macros/InterfacePluginMacros.h"
+#include "otsdaq/MessageFacility/MessageFacility.h"
+
+#include <sstream>
+#include <thread>
+
+#include <iostream>
+
+using namespace ots;
+
+//========================================================================================================================
+FEHistoAggregatorInterface::FEHistoAggregatorInterface(
+    const std::string &interfaceUID,
+    const ConfigurationTree &theXDAQContextConfigTree,
+    const std::string &configurationPath)
+    : FEVInterface(interfaceUID, theXDAQContextConfigTree, configurationPath),
+      TCPPublishServer(theXDAQContextConfigTree.getNode(configurationPath)
+                           .getNode("ServerPort")
+                           .getValue<unsigned int>(),
+                       4),
+      sourceId_(0), publishSeconds_(2), buffer_(TBuffer::kWrite), sequence_(0),
+      nPublished_(0) {
+  std::cout << "[In FEHistoAggregatorInterface () ] Initiating ..." << std::endl;
+  TCPPublishServer::startAccept();
+}
+
+//========================================================================================================================
+FEHistoAggregatorInterface::~FEHistoAggregatorInterface(void) {}
+
+//========================================================================================================================
+template <typename T>
+T FEHistoAggregatorInterface::getParameter_(const std::string &name,
+                                            T defaultValue) {
+  try {
+    return getSelfNode().getNode(name).getValue<T>();
+  } catch (...) {
+    __COUT__ << "Parameter " << name << " not set, using " << defaultValue
+             << std::endl;
+    return defaultValue;
+  }
+}
+
+//========================================================================================================================
+// Upstreams is a comma-separated list of address:port of the publishers
+void FEHistoAggregatorInterface::configure(void) {
+  sourceId_       = getParameter_<unsigned int>("SourceId", 1000);
+  publishSeconds_ = getParameter_<double>("PublishPeriodSeconds", 2.);
+  if (publishSeconds_ <= 0) publishSeconds_ = 1.;
+
+  upstreams_.clear();
+  std::stringstream list(getParameter_<std::string>("Upstreams", ""));
+  std::string item;
+  while (std::getline(list, item, ',')) {
+    size_t colon = item.rfind(':');
+    if (colon == std::string::npos) {
+      __COUT_ERR__ << "Invalid upstream '" << item << "', expected address:port"
+                   << std::endl;
+      continue;
+    }
+    size_t first = item.find_first_not_of(' ');
+    upstreams_.emplace_back(item.substr(first, colon - first),
+                            std::stoi(item.substr(colon + 1)));
+  }
+
+  std::string visualizer = getParameter_<std::string>("VisualizerAddress", "");
+  int visualizerPort = getParameter_<int>("VisualizerPort", 0);
+  visualizer_.reset();
+  if (!visualizer.empty() && visualizerPort > 0)
+    visualizer_.reset(new DQMAsyncSender(visualizer, visualizerPort));
+
+  __COUT_INFO__ << "DQM aggregator " << sourceId_ << ": merging "
+                << upstreams_.size() << " streams, publishing every "
+                << publishSeconds_ << " s" << std::endl;
+  std::cout << __PRETTY_FUNCTION__ << "ConfigureDone!" << std::endl;
+}
+
+//========================================================================================================================
+void FEHistoAggregatorInterface::halt(void) {
+  std::cout << "[In FEHistoAggregatorInterface () ] Halting ..." << std::endl;
+  aggregator_.reset();
+}
+
+//========================================================================================================================
+void FEHistoAggregatorInterface::pause(void) {
+  std::cout << "[In FEHistoAggregatorInterface () ] Pausing ..." << std::endl;
+}
+
+//========================================================================================================================
+void FEHistoAggregatorInterface::resume(void) {
+  std::cout << "[In FEHistoAggregatorInterface () ] Resuming ..." << std::endl;
+  nextPublish_ = std::chrono::steady_clock::now();
+}
+
+//========================================================================================================================
+// the subscriptions live for the run, so the merged content of a run never
+// mixes with the previous one
+void FEHistoAggregatorInterface::start(std::string runNumber) {
+  std::cout << "[In FEHistoAggregatorInterface () ] Starting ..." << std::endl;
+  aggregator_.reset(new DQMHistoAggregator(upstreams_));
+  aggregator_->start();
+  sequence_ = 0;
+  nPublished_ = 0;
+  nextPublish_ = std::chrono::steady_clock::now();
+}
+
+//========================================================================================================================
+bool FEHistoAggregatorInterface::running(void) {
+  auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(publishSeconds_));
+  nextPublish_ += period;
+  std::this_thread::sleep_until(nextPublish_);
+  if (std::chrono::steady_clock::now() > nextPublish_ + period)
+    nextPublish_ = std::chrono::steady_clock::now();
+
+  publish_();
+  return WorkLoop::continueWorkLoop_; // otherwise it stops!!!!!
+}
+
+//========================================================================================================================
+void FEHistoAggregatorInterface::publish_(void) {
+  if (!aggregator_) return;
+  DQMHistoAggregator::packet_t packet;
+  aggregator_->collect(packet);
+  if (packet.empty()) return;
+
+  writeDQMPacket(buffer_, sourceId_, sequence_++, packet);
+  TCPPublishServer::broadcastPacket(buffer_.Buffer(), buffer_.Length());
+
+  // the visualizer sender takes the histograms over
+  if (visualizer_) {
+    visualizer_->send(std::move(packet));
+  } else {
+    for (auto &dir : packet)
+      for (TH1 *h : dir.second) delete h;
+  }
+  if (++nPublished_ % 10 == 0) report_();
+}
+
+//========================================================================================================================
+void FEHistoAggregatorInterface::report_(void) {
+  if (!aggregator_) return;
+  __COUT_INFO__ << "DQM aggregator " << sourceId_ << ": "
+                << aggregator_->nPackets() << " packets ("
+                << aggregator_->nBytes() / 1e6 << " MB) received, "
+                << aggregator_->nCorrupt() << " invalid" << std::endl;
+  for (auto &source : aggregator_->sources()) {
+    __COUT_INFO__ << "  source " << source.first << ": "
+                  << source.second.nPackets << " merged, "
+                  << source.second.nLost << " lost, "
+                  << source.second.nDuplicates << " duplicates, "
+                  << source.second.nRestarts << " restarts" << std::endl;
+  }
+}
+
+//========================================================================================================================
+void FEHistoAggregatorInterface::stop(void) {
+  std::cout << "[In FEHistoAggregatorInterface () ] Stoping ..." << std::endl;
+  publish_();
+  report_();
+  if (aggregator_) aggregator_->stop();
+}
+
+DEFINE_OTS_INTERFACE(FEHistoAggregatorInterface)
@@ -4,11 +4,26 @@
 #include "otsdaq/FECore/FEVInterface.h"
 #include "otsdaq/NetworkUtilities/TCPPublishServer.h"
 
+#include <TBufferFile.h>
+#include <TH1F.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <random>
 #include <string>
+#include <vector>
 
 namespace ots {
 
+// Synthetic DQM traffic generator.
+//
+// Books histogram families shaped like the ones the DQM modules publish
+// (tracker pedestals and panels, calo and trigger summaries), fills them
+// with a configurable pattern and broadcasts them through the
+// TCPPublishServer as DQM packets, at a configurable update rate. The
+// achieved update, packet and byte rates are reported periodically, to load
+// test the visualizer and the network path without beam.
 class FEHistoMakerInterface : public FEVInterface, public TCPPublishServer {
 public:
 public:
@@ -30,8 +45,41 @@ public:
   void universalWrite(char *address, char *writeValue) override { ; }
 
 private:
+  enum FillPattern { kGaussian = 0, kUniform, kExponential };
+
+  struct family_ {
+    std::string                         name;
+    std::vector<std::unique_ptr<TH1F>>  hists;
+    std::vector<double>                 centers;  // per-histogram mean, fraction of the axis
+  };
+
+  template <typename T>
+  T getParameter_(const std::string &name, T defaultValue);
+  void book_(family_ &family, const std::string &title, int nBins, double min,
+             double max, double center);
+  void fillFamily_(family_ &family);
+  void publish_(void);
+  void report_(bool force);
+
   std::default_random_engine generator_;
   std::normal_distribution<double> distribution_;
+
+  // configuration
+  int         nPedestalHists_, nPanelHists_, nBins_;
+  int         fillsPerUpdate_, histsPerPacket_;
+  double      updateRateHz_, reportSeconds_;
+  bool        resetAfterPublish_;
+  FillPattern fillPattern_;
+  uint32_t    sourceId_, sequence_;
+
+  std::vector<family_> families_;
+  std::vector<double>  values_;   // fill scratch, reused across updates
+  TBufferFile          buffer_;   // reused across packets
+
+  // throughput bookkeeping
+  std::chrono::steady_clock::time_point nextUpdate_, lastReport_;
+  unsigned long nUpdates_, nPackets_, nBytes_;
+  unsigned long lastUpdates_, lastPackets_, lastBytes_;
 };
 
 } // namespace ots
@@ -1,9 +1,12 @@
 #include "otsdaq-mu2e-dqm/FEInterfaces/FEHistoMakerInterface.h"
+#include "otsdaq-mu2e-dqm/ArtModules/detail/DQMPacket.hh"
+#include "otsdaq-mu2e-dqm/DQMEngine/CaloFillEngine.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/TriggerFillEngine.h"
 #include "otsdaq/Macros/CoutMacros.h"
 #include "otsdaq/Macros/InterfacePluginMacros.h"
 #include "otsdaq/MessageFacility/MessageFacility.h"
 
-#include <chrono>
+#include <algorithm>
 #include <thread>
 
 #include <iostream>
@@ -20,7 +23,11 @@ FEHistoMakerInterface::FEHistoMakerInterface(
                            .getNode("ServerPort")
                            .getValue<unsigned int>(),
                        1),
-      distribution_(50, 10) {
+      distribution_(0, 1), nPedestalHists_(0), nPanelHists_(0), nBins_(0),
+      fillsPerUpdate_(1), histsPerPacket_(0), updateRateHz_(0.2),
+      reportSeconds_(10), resetAfterPublish_(true), fillPattern_(kGaussian),
+      sourceId_(0), sequence_(0), buffer_(TBuffer::kWrite), nUpdates_(0), nPackets_(0), nBytes_(0),
+      lastUpdates_(0), lastPackets_(0), lastBytes_(0) {
   std::cout << "[In FEHistoMakerInterface () ] Initiating ..." << std::endl;
   TCPPublishServer::startAccept();
 }
@@ -28,11 +35,88 @@ FEHistoMakerInterface::FEHistoMakerInterface(
 //========================================================================================================================
 FEHistoMakerInterface::~FEHistoMakerInterface(void) {}
 
+//========================================================================================================================
+// optional parameters: the defaults reproduce a small DQM load
+template <typename T>
+T FEHistoMakerInterface::getParameter_(const std::string &name,
+                                       T defaultValue) {
+  try {
+    return getSelfNode().getNode(name).getValue<T>();
+  } catch (...) {
+    __COUT__ << "Parameter " << name << " not set, using " << defaultValue
+             << std::endl;
+    return defaultValue;
+  }
+}
+
 //========================================================================================================================
 void FEHistoMakerInterface::configure(void) {
+  nPedestalHists_    = getParameter_<int>("PedestalHistograms", 96);
+  nPanelHists_       = getParameter_<int>("PanelHistograms", 216);
+  nBins_             = getParameter_<int>("BinsPerHistogram", 0);
+  fillsPerUpdate_    = getParameter_<int>("FillsPerUpdate", 100);
+  histsPerPacket_    = getParameter_<int>("HistogramsPerPacket", 0);
+  updateRateHz_      = getParameter_<double>("UpdateRateHz", 1.);
+  reportSeconds_     = getParameter_<double>("ReportIntervalSeconds", 10.);
+  resetAfterPublish_ = getParameter_<bool>("ResetAfterPublish", true);
+  sourceId_          = getParameter_<unsigned int>("SourceId", 0);
+
+  std::string pattern = getParameter_<std::string>("FillPattern", "gaussian");
+  if (pattern == "uniform")
+    fillPattern_ = kUniform;
+  else if (pattern == "exponential")
+    fillPattern_ = kExponential;
+  else
+    fillPattern_ = kGaussian;
+
+  // the families mimic the DQM modules; BinsPerHistogram > 0 overrides the
+  // binning of the tracker families, which dominate the traffic
+  TH1::AddDirectory(kFALSE);
+  families_.clear();
+  std::uniform_real_distribution<double> centers(0.2, 0.5);
+
+  families_.push_back(family_{"Tracker_pedestals", {}, {}});
+  for (int i = 0; i < nPedestalHists_; ++i) {
+    book_(families_.back(), "Pedestal_" + std::to_string(i),
+          nBins_ > 0 ? nBins_ : 200, 0, 500, centers(generator_));
+  }
+  families_.push_back(family_{"Tracker_panels", {}, {}});
+  for (int i = 0; i < nPanelHists_; ++i) {
+    book_(families_.back(), "Panel_" + std::to_string(i),
+          nBins_ > 0 ? nBins_ : 100, 0, 100, 0.5);
+  }
+  // the calo and trigger summaries are booked from the CaloDQM and
+  // TriggerDQM schemas themselves
+  const double caloCenters[kNCaloSummaryHists] = {0.3, 0.2, 0.05};
+  families_.push_back(family_{"Calo_summary", {}, {}});
+  for (int i = 0; i < kNCaloSummaryHists; ++i) {
+    const DQMHistSpec &spec = kCaloOnspillSchema[i];
+    book_(families_.back(), spec.title, spec.nBins, spec.min, spec.max,
+          caloCenters[i]);
+  }
+  families_.push_back(family_{"Trigger_summary", {}, {}});
+  for (const DQMHistSpec &spec : kTriggerSummarySchema) {
+    book_(families_.back(), spec.title, spec.nBins, spec.min, spec.max, 0.5);
+  }
+
+  size_t nHists(0);
+  for (const family_ &family : families_) nHists += family.hists.size();
+  __COUT_INFO__ << "Synthetic DQM load: " << nHists << " histograms, "
+                << fillsPerUpdate_ << " fills each per update, "
+                << updateRateHz_ << " updates/s, pattern " << pattern
+                << std::endl;
   std::cout << __PRETTY_FUNCTION__ << "ConfigureDone!" << std::endl;
 }
 
+//========================================================================================================================
+void FEHistoMakerInterface::book_(family_ &family, const std::string &title,
+                                  int nBins, double min, double max,
+                                  double center) {
+  family.hists.emplace_back(
+      new TH1F(title.c_str(), title.c_str(), nBins, min, max));
+  family.centers.push_back(center);
+}
+
 //========================================================================================================================
 void FEHistoMakerInterface::halt(void) {
   std::cout << "[In FEHistoMakerInterface () ] Halting ..." << std::endl;
@@ -46,31 +130,119 @@ void FEHistoMakerInterface::pause(void) {
 //========================================================================================================================
 void FEHistoMakerInterface::resume(void) {
   std::cout << "[In FEHistoMakerInterface () ] Resuming ..." << std::endl;
+  nextUpdate_ = std::chrono::steady_clock::now();
 }
 
 //========================================================================================================================
 void FEHistoMakerInterface::start(std::string runNumber) {
   std::cout << "[In FEHistoMakerInterface () ] Starting ..." << std::endl;
+  nUpdates_ = nPackets_ = nBytes_ = 0;
+  sequence_ = 0;
+  lastUpdates_ = lastPackets_ = lastBytes_ = 0;
+  nextUpdate_ = lastReport_ = std::chrono::steady_clock::now();
+  for (family_ &family : families_) {
+    for (auto &h : family.hists) h->Reset();
+  }
 }
 
 //========================================================================================================================
-// The running state is a thread
+// The running state is a thread: one update (fill, serialize, broadcast) per
+// call, paced to UpdateRateHz (as fast as possible if <= 0)
 bool FEHistoMakerInterface::running(void) {
-  std::cout << "[In FEHistoMakerInterface () ] Running ..." << std::endl;
-  double value = distribution_(generator_);
-  std::string buffer(8, '0');
-  memcpy(&buffer.at(0), &value, sizeof(double));
-  std::cout << __PRETTY_FUNCTION__ << " Value: " << value
-            << " Buffer: " << buffer << std::endl;
-
-  TCPPublishServer::broadcast(buffer);
-  std::this_thread::sleep_for(std::chrono::milliseconds(5000));
+  for (family_ &family : families_) fillFamily_(family);
+  publish_();
+  ++nUpdates_;
+  report_(false);
+
+  if (updateRateHz_ > 0) {
+    auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1. / updateRateHz_));
+    nextUpdate_ += period;
+    auto now = std::chrono::steady_clock::now();
+    // when the updates cannot keep up, do not try to catch up in a burst
+    if (nextUpdate_ < now)
+      nextUpdate_ = now;
+    else
+      std::this_thread::sleep_until(nextUpdate_);
+  }
   return WorkLoop::continueWorkLoop_; // otherwise it stops!!!!!
 }
 
+//========================================================================================================================
+void FEHistoMakerInterface::fillFamily_(family_ &family) {
+  values_.resize(fillsPerUpdate_);
+  for (size_t i = 0; i < family.hists.size(); ++i) {
+    TH1F *h = family.hists[i].get();
+    double min = h->GetXaxis()->GetXmin();
+    double width = h->GetXaxis()->GetXmax() - min;
+    for (double &v : values_) {
+      double x(0);
+      switch (fillPattern_) {
+      case kUniform:
+        x = std::uniform_real_distribution<double>(0, 1)(generator_);
+        break;
+      case kExponential:
+        x = std::exponential_distribution<double>(1. / family.centers[i])(generator_);
+        break;
+      default:
+        x = family.centers[i] * (1. + 0.1 * distribution_(generator_));
+        break;
+      }
+      v = min + x * width;
+    }
+    h->FillN(fillsPerUpdate_, values_.data(), nullptr);
+  }
+}
+
+//========================================================================================================================
+// each family is sent in packets of at most HistogramsPerPacket histograms
+// (the whole family if 0), in the DQMPacket format with the family name as
+// directory, so a DQM aggregator can merge several generators
+void FEHistoMakerInterface::publish_(void) {
+  std::map<std::string, std::vector<TH1 *>> packet;
+  for (family_ &family : families_) {
+    size_t nHists = family.hists.size();
+    size_t chunk = histsPerPacket_ > 0 ? size_t(histsPerPacket_) : nHists;
+    for (size_t first = 0; first < nHists; first += chunk) {
+      packet.clear();
+      std::vector<TH1 *> &hists = packet[family.name];
+      for (size_t i = first; i < std::min(nHists, first + chunk); ++i)
+        hists.push_back(family.hists[i].get());
+
+      writeDQMPacket(buffer_, sourceId_, sequence_++, packet);
+      TCPPublishServer::broadcastPacket(buffer_.Buffer(), buffer_.Length());
+      ++nPackets_;
+      nBytes_ += buffer_.Length();
+    }
+    if (resetAfterPublish_) {
+      for (auto &h : family.hists) h->Reset();
+    }
+  }
+}
+
+//========================================================================================================================
+void FEHistoMakerInterface::report_(bool force) {
+  auto now = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(now - lastReport_).count();
+  if (!force && elapsed < reportSeconds_) return;
+  if (elapsed <= 0) return;
+
+  __COUT_INFO__ << "Synthetic DQM load: "
+                << (nUpdates_ - lastUpdates_) / elapsed << " updates/s (target "
+                << updateRateHz_ << "), "
+                << (nPackets_ - lastPackets_) / elapsed << " packets/s, "
+                << (nBytes_ - lastBytes_) / elapsed / 1e6 << " MB/s, "
+                << nBytes_ / 1e6 << " MB in total" << std::endl;
+  lastReport_ = now;
+  lastUpdates_ = nUpdates_;
+  lastPackets_ = nPackets_;
+  lastBytes_ = nBytes_;
+}
+
 //========================================================================================================================
 void FEHistoMakerInterface::stop(void) {
   std::cout << "[In FEHistoMakerInterface () ] Stoping ..." << std::endl;
+  report_(true);
 }
 
 DEFINE_OTS_INTERFACE(FEHistoMakerInterface)
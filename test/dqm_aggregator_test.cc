@@ -0,0 +1,325 @@
+// Local multi-process test of the DQM histogram aggregation.
+//
+// Forks nSources publisher processes, each serving DQM packets with a known
+// content on its own port, and merges them in the parent through a two-level
+// reduction tree: two first-level aggregators take half of the sources each
+// and republish their merged content on a port, a top-level aggregator
+// subscribes to both. The ports are picked free by the system.
+//
+// A source sends hello packets until the parent has seen it at the top of
+// the tree, so that no counted packet can be published before the whole
+// chain is subscribed; it then sends nPackets packets and waits for the
+// parent to finish. The entries merged at the top must be exactly the ones
+// sent, and the trend of every source (a snapshot directory) must be its
+// last packet, not a sum. The directories mirror the ones of the DQM
+// modules: the rates and means of the crystals and channels are profiles,
+// whose merged values must be the means over all the sources, weighted by
+// their events and hits; the correlation trend rings and the timing
+// percentiles are snapshots, replaced rather than added. Every wait is
+// bounded by a deadline.
+//
+// usage: dqm_aggregator_test [nSources] [nPackets]
+
+#include "otsdaq-mu2e-dqm/ArtModules/detail/DQMPacket.hh"
+#include "otsdaq-mu2e-dqm/FEInterfaces/DQMHistoAggregator.h"
+#include "otsdaq/NetworkUtilities/TCPPublishServer.h"
+
+#include <TH1F.h>
+#include <TProfile.h>
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <thread>
+
+using namespace ots;
+
+namespace {
+
+  typedef std::chrono::steady_clock clock_;
+
+  // entries per packet of a source, all in one bin per directory
+  double entriesPerPacket(uint32_t source) { return source + 1; }
+
+  std::string suffix(uint32_t source) { return "_" + std::to_string(source); }
+
+  // per packet of a source: events behind the rate, hit rate, mean hit energy
+  // (the hits are entriesPerPacket), and the stage timing
+  const double kEventsPerPacket = 10;
+  double hitRate(uint32_t source) { return source; }
+  double meanEnergy(uint32_t source) { return 10 + source; }
+  double timing(uint32_t source) { return 100 + source; }
+
+  // the correlation trend ring of a source after its nPackets packets:
+  // interval i stored at i%kRing
+  const int kRing = 10;
+  double ringSum(int nPackets) {
+    double ring[kRing] = {0};
+    for (int i = 0; i < nPackets; ++i) ring[i % kRing] = i + 1;
+    double sum(0);
+    for (double v : ring) sum += v;
+    return sum;
+  }
+
+  // distinct ports free at the time of the call: all are bound at once, so
+  // the system cannot return one twice
+  std::vector<int> freePorts(int n) {
+    std::vector<int> fds, ports;
+    for (int i = 0; i < n; ++i) {
+      int fd = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in addr{};
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      addr.sin_port = 0;
+      socklen_t length = sizeof(addr);
+      if (fd < 0 || bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0 ||
+          getsockname(fd, (sockaddr *)&addr, &length) != 0) {
+        std::cerr << "cannot find a free port" << std::endl;
+        std::exit(2);
+      }
+      fds.push_back(fd);
+      ports.push_back(ntohs(addr.sin_port));
+    }
+    for (int fd : fds) close(fd);
+    return ports;
+  }
+
+  // pipe: the parent writes a byte to start the counted packets, and closes
+  // it when done
+  void runSource(uint32_t source, int nPackets, int port, int pipeFd) {
+    TH1::AddDirectory(kFALSE);
+    TCPPublishServer server(port, 1);
+    server.startAccept();
+
+    TH1F hello(("Hello" + suffix(source)).c_str(), "hello", 1, 0, 1);
+    TH1F pedestal("Pedestal_0", "Pedestal_0", 100, 0, 100);
+    TH1F panel("Panel_0", "Panel_0", 10, 0, 10);
+    TH1F trend(("Trend" + suffix(source)).c_str(), "trend", 10, 0, 10);
+    TProfile rate("crvChannelRate", "rate", 1, 0, 1);
+    TProfile energy("crystalEnergy", "energy", 1, 0, 1);
+    TH1F slopeTrend(("slopeTrend" + suffix(source)).c_str(), "slope trend", kRing, 0, kRing);
+    TH1F stages("test_timing_p50", "p50", 1, 0, 1);
+    TBufferFile buffer(TBuffer::kWrite);
+    std::map<std::string, std::vector<TH1 *>> helloPacket, packet;
+    helloPacket["test_hello"].push_back(&hello);
+    packet["test_pedestals"].push_back(&pedestal);
+    packet["test_panels"].push_back(&panel);
+    packet["test_timeseries"].push_back(&trend);
+    packet["test_channels"].push_back(&rate);
+    packet["test_crystals"].push_back(&energy);
+    packet["test_correlations_trends"].push_back(&slopeTrend);
+    packet["test_timing"].push_back(&stages);
+    hello.Fill(0.5);
+
+    uint32_t sequence = 0;
+    pollfd go{pipeFd, POLLIN, 0};
+    while (poll(&go, 1, 20) == 0) {
+      writeDQMPacket(buffer, source, sequence++, helloPacket);
+      server.broadcastPacket(buffer.Buffer(), buffer.Length());
+    }
+    char byte;
+    if (read(pipeFd, &byte, 1) != 1) return; // parent gone
+
+    for (int i = 0; i < nPackets; ++i) {
+      pedestal.Reset();
+      panel.Reset();
+      for (double n = 0; n < entriesPerPacket(source); ++n) {
+        pedestal.Fill(10 * source + 0.5);
+        panel.Fill(source % 10 + 0.5);
+      }
+      trend.Fill(i % 10 + 0.5); // the whole trend is sent every time
+      rate.Reset();
+      energy.Reset();
+      rate.Fill(0.5, hitRate(source), kEventsPerPacket);
+      energy.Fill(0.5, meanEnergy(source), entriesPerPacket(source));
+      slopeTrend.SetBinContent(i % kRing + 1, i + 1);
+      stages.SetBinContent(1, timing(source));
+      writeDQMPacket(buffer, source, sequence++, packet);
+      server.broadcastPacket(buffer.Buffer(), buffer.Length());
+      std::this_thread::sleep_for(std::chrono::milliseconds(5)); // paced like a DQM module
+    }
+    while (read(pipeFd, &byte, 1) > 0) {
+    }
+  }
+
+  double entries(const DQMHistoAggregator::packet_t &packet, const std::string &dir) {
+    auto it = packet.find(dir);
+    if (it == packet.end()) return 0;
+    double n(0);
+    for (TH1 *h : it->second) n += h->GetEntries();
+    return n;
+  }
+
+  void release(DQMHistoAggregator::packet_t &packet) {
+    for (auto &dir : packet)
+      for (TH1 *h : dir.second) delete h;
+    packet.clear();
+  }
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int nSources = argc > 1 ? std::atoi(argv[1]) : 4;
+  int nPackets = argc > 2 ? std::atoi(argv[2]) : 40;
+  if (nSources < 2 || nPackets < 1) {
+    std::cerr << "usage: dqm_aggregator_test [nSources>=2] [nPackets>=1]" << std::endl;
+    return 2;
+  }
+  std::vector<int> ports = freePorts(nSources + 2);
+
+  std::vector<pid_t> children;
+  std::vector<int> pipes;
+  for (int i = 0; i < nSources; ++i) {
+    int fds[2];
+    if (pipe(fds) != 0) return 2;
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(fds[1]);
+      runSource(i, nPackets, ports[i], fds[0]);
+      _exit(0);
+    }
+    close(fds[0]);
+    children.push_back(pid);
+    pipes.push_back(fds[1]);
+  }
+
+  TH1::AddDirectory(kFALSE);
+  // first level: two aggregators, each republishing on its own port
+  int levelPort[2] = {ports[nSources], ports[nSources + 1]};
+  std::vector<DQMHistoAggregator::upstream_t> half[2];
+  for (int i = 0; i < nSources; ++i) half[i % 2].emplace_back("127.0.0.1", ports[i]);
+
+  std::unique_ptr<DQMHistoAggregator> level1[2];
+  std::unique_ptr<TCPPublishServer> server[2];
+  for (int k = 0; k < 2; ++k) {
+    server[k].reset(new TCPPublishServer(levelPort[k], 1));
+    server[k]->startAccept();
+    level1[k].reset(new DQMHistoAggregator(half[k]));
+    level1[k]->start();
+  }
+  DQMHistoAggregator top({{"127.0.0.1", levelPort[0]}, {"127.0.0.1", levelPort[1]}});
+  top.start();
+
+  // what the top level has merged so far
+  std::map<std::string, double> hello, trend, slopeTrend;
+  std::map<std::string, std::unique_ptr<TH1>> profiles; // summed over the collects
+  double merged(0), stages(0);
+  TBufferFile buffer(TBuffer::kWrite);
+  uint32_t sequence[2] = {0, 0};
+  auto republish = [&]() {
+    for (int k = 0; k < 2; ++k) {
+      DQMHistoAggregator::packet_t packet;
+      level1[k]->collect(packet);
+      if (packet.empty()) continue;
+      writeDQMPacket(buffer, 1000 + k, sequence[k]++, packet);
+      server[k]->broadcastPacket(buffer.Buffer(), buffer.Length());
+      release(packet);
+    }
+    DQMHistoAggregator::packet_t packet;
+    top.collect(packet);
+    merged += entries(packet, "test_pedestals");
+    for (TH1 *h : packet["test_hello"]) hello[h->GetName()] += h->GetEntries();
+    for (TH1 *h : packet["test_timeseries"]) trend[h->GetName()] = h->GetEntries();
+    for (TH1 *h : packet["test_correlations_trends"]) slopeTrend[h->GetName()] = h->Integral();
+    for (TH1 *h : packet["test_timing"]) stages = h->GetBinContent(1);
+    for (const char *dir : {"test_channels", "test_crystals"}) {
+      for (TH1 *h : packet[dir]) {
+        std::unique_ptr<TH1> &sum = profiles[h->GetName()];
+        if (sum) {
+          sum->Add(h);
+        } else {
+          sum.reset((TH1 *)h->Clone());
+        }
+      }
+    }
+    release(packet);
+  };
+
+  // republishes until Condition holds or the deadline passes
+  auto deadline = clock_::now() + std::chrono::seconds(60);
+  auto waitFor = [&](const std::function<bool()> &Condition) {
+    while (!Condition()) {
+      if (clock_::now() > deadline) return false;
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      republish();
+    }
+    return true;
+  };
+
+  double expected(0);
+  for (int i = 0; i < nSources; ++i) expected += nPackets * entriesPerPacket(i);
+
+  bool ok = waitFor([&]() {
+    for (int i = 0; i < nSources; ++i)
+      if (hello["Hello" + suffix(i)] == 0) return false;
+    return true;
+  });
+  if (!ok) std::cout << "the sources were not all seen at the top level" << std::endl;
+  for (int fd : pipes) ok &= write(fd, "g", 1) == 1;
+  ok = ok && waitFor([&]() { return merged >= expected; });
+
+  // a late extra packet would show up here
+  republish();
+  std::cout << "top level: " << merged << " entries merged, " << expected << " sent" << std::endl;
+  if (merged != expected) ok = false;
+
+  for (int i = 0; i < nSources; ++i) {
+    double seen = trend["Trend" + suffix(i)];
+    std::cout << "source " << i << ": trend " << seen << " entries, " << nPackets << " in the last packet" << std::endl;
+    if (seen != nPackets) ok = false;
+    double ring = slopeTrend["slopeTrend" + suffix(i)];
+    std::cout << "source " << i << ": slope trend " << ring << ", " << ringSum(nPackets) << " in the last packet" << std::endl;
+    if (ring != ringSum(nPackets)) ok = false;
+  }
+
+  // the profiles: means weighted by the events (rate) and the hits (energy)
+  double events(0), rateSum(0), hits(0), energySum(0);
+  for (int i = 0; i < nSources; ++i) {
+    events += nPackets * kEventsPerPacket;
+    rateSum += nPackets * kEventsPerPacket * hitRate(i);
+    hits += nPackets * entriesPerPacket(i);
+    energySum += nPackets * entriesPerPacket(i) * meanEnergy(i);
+  }
+  std::pair<const char *, double> means[] = {{"crvChannelRate", rateSum / events},
+                                             {"crystalEnergy", energySum / hits}};
+  for (auto &mean : means) {
+    TProfile *p = dynamic_cast<TProfile *>(profiles[mean.first].get());
+    double seen = p ? p->GetBinContent(1) : 0;
+    std::cout << mean.first << ": " << seen << ", expected " << mean.second << std::endl;
+    if (std::fabs(seen - mean.second) > 1e-6 * mean.second) ok = false;
+  }
+  // one source's percentile, not a sum
+  std::cout << "timing p50: " << stages << std::endl;
+  if (stages < timing(0) || stages > timing(nSources - 1)) ok = false;
+  for (int k = 0; k < 2; ++k) {
+    for (auto &source : level1[k]->sources()) {
+      std::cout << "source " << source.first << ": " << source.second.nPackets << " packets merged, "
+                << source.second.nLost << " lost, " << source.second.nDuplicates << " duplicates" << std::endl;
+      if (source.second.nLost > 0 || source.second.nDuplicates > 0) ok = false;
+    }
+  }
+
+  // every upstream is still connected and idle: the aggregators must leave
+  // without waiting for a packet. The sources are released afterwards.
+  auto t0 = clock_::now();
+  top.stop();
+  for (int k = 0; k < 2; ++k) level1[k]->stop();
+  double stopSeconds = std::chrono::duration<double>(clock_::now() - t0).count();
+  std::cout << "stopped in " << stopSeconds << " s" << std::endl;
+  if (stopSeconds > 5) ok = false;
+  for (int k = 0; k < 2; ++k) server[k].reset();
+  for (int fd : pipes) close(fd);
+  for (pid_t pid : children) waitpid(pid, nullptr, 0);
+
+  std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,493 @@
+// Microbenchmarks of the DQM hot paths, across occupancies.
+//
+//   waveform_features   pedestal_est + max_adc per tracker hit
+//   tracker_fill        straw id lookup, summary/pedestal/panel fills, flush
+//   calo_summary_fill   calo summary fills and flush, per cluster
+//   trigger_accumulate  accepted-path masks counted per event
+//   trigger_rollup      path/module/bandwidth rollup, per publish
+//   stage_timer         scoped stage timer (DQMStageTimers), per scope
+//   publish_serialize   snapshot (Clone) of a histogram set + DQM packet
+//   tcp_send            DQM packets through a loopback TCPPublishServer
+//
+// The tracker and calo inputs come from the synthetic DTC generator
+// (DQMSim). Each case runs for at least the minimum time and reports the
+// best of the repetitions, per event and per item, as one JSON document so
+// that results can be compared across releases. A case that cannot
+// complete (packets lost by tcp_send) is listed in the failures and makes
+// the exit status 1.
+//
+// usage: dqm_benchmark [-o file.json] [-t minSeconds] [-r repetitions]
+//                      [-f nameFilter] [-p port] [-q]
+//
+// tcp_send listens on the given port, or on a port picked free by the
+// system (the default, -p 0).
+
+#include "otsdaq-mu2e-dqm/ArtModules/detail/DQMPacket.hh"
+#include "otsdaq-mu2e-dqm/DQMEngine/CaloFillEngine.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistSet.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMStageTimers.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/TrackerFillEngine.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/TriggerPathCounter.h"
+#include "otsdaq-mu2e-dqm/DQMSim/DTCFragmentGenerator.h"
+#include "otsdaq/NetworkUtilities/TCPPublishServer.h"
+#include "otsdaq/NetworkUtilities/TCPSubscribeClient.h"
+
+#include <TH1F.h>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ots;
+
+namespace {
+
+  typedef std::chrono::steady_clock clock_;
+
+  double  minSeconds  = 0.5;
+  int     repetitions = 3;
+  std::string filter;
+
+  struct result_ {
+    std::string name;
+    std::string parameter;   // what the occupancy counts
+    double      occupancy;
+    std::string item;        // what ns_per_item counts
+    double      events;      // per repetition
+    double      items;
+    double      seconds;     // best repetition
+    double      bytes;       // per repetition, 0 if not relevant
+  };
+
+  std::vector<result_>     results;
+  std::vector<std::string> failures;   // cases that could not complete
+
+  bool selected(const std::string& name) { return filter.empty() || name.find(filter) != std::string::npos; }
+
+  // runs Pass (one pass over the inputs, returns the events and items it
+  // processed) until minSeconds, repetitions times
+  void measure(const std::string& name, const std::string& parameter, double occupancy, const std::string& item,
+	       const std::function<std::pair<double, double>()>& Pass, double bytesPerEvent = 0) {
+    result_ best{name, parameter, occupancy, item, 0, 0, 0, 0};
+    double  bestRate = -1;
+    for (int r = 0; r < repetitions; ++r) {
+      double events(0), items(0), seconds(0);
+      auto   t0 = clock_::now();
+      do {
+	auto n = Pass();
+	events += n.first;
+	items  += n.second;
+	seconds = std::chrono::duration<double>(clock_::now() - t0).count();
+      } while (seconds < minSeconds);
+      if (events/seconds > bestRate) {
+	bestRate     = events/seconds;
+	best.events  = events;
+	best.items   = items;
+	best.seconds = seconds;
+	best.bytes   = events*bytesPerEvent;
+      }
+    }
+    results.push_back(best);
+    std::cerr << name << " " << parameter << "=" << occupancy << ": " << 1e9*best.seconds/best.events << " ns/event, "
+	      << (best.items > 0 ? 1e9*best.seconds/best.items : 0) << " ns/" << item << std::endl;
+  }
+
+  // tracker: decoded hits of the full detector (36 DTCs, 6 panels each)
+  struct trackerEvent_ {
+    std::vector<uint16_t>                    straws;
+    std::vector<mu2e::TrkTypes::ADCWaveform> waveforms;
+  };
+
+  std::vector<trackerEvent_> trackerEvents(double occupancy, int nEvents) {
+    DTCGeneratorConfig config;
+    config.nDTCs     = 36;
+    config.occupancy = occupancy;
+    config.seed      = 12345;
+    DTCFragmentGenerator generator(config);
+
+    std::vector<trackerEvent_> events(nEvents);
+    std::vector<uint8_t>       buffer;
+    std::vector<uint16_t>      samples;
+    for (int i = 0; i < nEvents; ++i) {
+      buffer.clear();
+      size_t n = generator.generateEvent(i, buffer);
+      walkDTCEvent(buffer.data(), n, [&](const uint8_t* subEvent, size_t size) {
+	walkDTCSubEvent(subEvent, size, [&](const DTCBlockView& block) {
+	  for (size_t k = 0; k < block.packetCount;) {
+	    uint16_t straw;
+	    k += readTrackerHit(block.payload + k*dtc_format::kPacketBytes, straw, samples);
+	    events[i].straws.push_back(straw);
+	    events[i].waveforms.emplace_back(samples.begin(), samples.end());
+	  }
+	});
+      });
+    }
+    return events;
+  }
+
+  // the tracker sets of TrackerDQM, same order and binning
+  void bookTracker(DQMHistSet& summary, DQMHistSet& pedestals, DQMHistSet& panels) {
+    summary.book(kTrackerSummarySchema);
+    for (int plane = 0; plane < mu2e::StrawId::_nplanes; plane++) {
+      for (int panel = 0; panel < mu2e::StrawId::_npanels; panel++) {
+	panels.add("Panel_" + std::to_string(plane) + "_" + std::to_string(panel), 100, 0, 100);
+	for (int straw = 0; straw < mu2e::StrawId::_nstraws; straw++) {
+	  pedestals.add("Pedestal_" + std::to_string(plane) + "_" + std::to_string(panel) + "_" + std::to_string(straw), 200, 0, 500);
+	}
+      }
+    }
+  }
+
+  volatile long sink;
+
+  void benchWaveform(double occupancy, const std::vector<trackerEvent_>& events) {
+    measure("waveform_features", "hits_per_panel", occupancy, "hit", [&]() {
+      double nHits(0);
+      long   sum(0);
+      for (const trackerEvent_& ev : events) {
+	for (const auto& adc : ev.waveforms) sum += pedestal_est(adc) + max_adc(adc);
+	nHits += ev.waveforms.size();
+      }
+      sink = sum;
+      return std::make_pair(double(events.size()), nHits);
+    });
+  }
+
+  void benchTrackerFill(double occupancy, const std::vector<trackerEvent_>& events,
+			DQMHistSet& summary, DQMHistSet& pedestals, DQMHistSet& panels) {
+    measure("tracker_fill", "hits_per_panel", occupancy, "hit", [&]() {
+      double nHits(0);
+      for (const trackerEvent_& ev : events) {
+	for (size_t h = 0; h < ev.straws.size(); ++h) {
+	  mu2e::StrawId sid(ev.straws[h]);
+	  tracker_summary_fill(summary.fillBuffer, sid);
+	  tracker_pedestal_fill(pedestals.fillBuffer, pedestal_est(ev.waveforms[h]), sid);
+	  tracker_panel_fill(panels.fillBuffer, sid);
+	}
+	summary.fillBuffer.Flush();
+	pedestals.fillBuffer.Flush();
+	panels.fillBuffer.Flush();
+	nHits += ev.straws.size();
+      }
+      return std::make_pair(double(events.size()), nHits);
+    });
+  }
+
+  struct cluster_ {
+    double e;
+    double energyDep() const { return e; }
+  };
+
+  void benchCalo(double nHits) {
+    // one cluster per ~20 hits, energies from the generator pulse heights
+    std::mt19937 gen(7);
+    std::poisson_distribution<int>       hits(nHits);
+    std::exponential_distribution<double> energy(1./40.);
+    std::vector<std::pair<size_t, std::vector<cluster_>>> events(1000);
+    for (auto& ev : events) {
+      ev.first = hits(gen);
+      ev.second.resize(ev.first/20);
+      for (cluster_& c : ev.second) c.e = energy(gen);
+    }
+    DQMHistSet calo("Calo_summary");
+    calo.book(kCaloOnspillSchema);
+    measure("calo_summary_fill", "hits_per_event", nHits, "cluster", [&]() {
+      double nClusters(0);
+      for (const auto& ev : events) {
+	calo_summary_fill(calo.fillBuffer, ev.first, ev.second);
+	calo.fillBuffer.Flush();
+	nClusters += ev.second.size();
+      }
+      return std::make_pair(double(events.size()), nClusters);
+    });
+  }
+
+  void benchTrigger(double acceptance) {
+    // 32 paths, each running a prescaler and 3 filters out of 64 modules
+    const size_t nPaths = 32, nModules = 64, nEventsPerPublish = 10000;
+    std::vector<std::vector<int>> modules(nPaths);
+    for (size_t p = 0; p < nPaths; ++p) modules[p] = {int(p % 4), int(4 + p), int(36 + p % 28), int(4 + (p + 1) % nPaths)};
+
+    std::mt19937 gen(11);
+    std::bernoulli_distribution accept(acceptance);
+    std::vector<uint64_t> masks(nEventsPerPublish);
+    for (uint64_t& m : masks) {
+      m = 0;
+      for (size_t p = 0; p < nPaths; ++p) if (accept(gen)) m |= uint64_t(1) << p;
+    }
+
+    TriggerPathCounter counter;
+    measure("trigger_accumulate", "path_acceptance", acceptance, "path", [&]() {
+      counter.clear();
+      for (uint64_t m : masks) counter.add(m);
+      return std::make_pair(double(masks.size()), double(masks.size()*nPaths));
+    });
+
+    TriggerPathCounter::rollup_t rollup;
+    double combinations = counter.nCombinations();
+    measure("trigger_rollup", "path_acceptance", acceptance, "combination", [&]() {
+      counter.rollup(nPaths, nModules, [&](size_t p) -> const std::vector<int>& { return modules[p]; }, rollup);
+      return std::make_pair(1., combinations);
+    });
+  }
+
+  // each thread times its own scopes into the same timers, as the RawDQM
+  // handlers do
+  void benchStageTimer(int nThreads) {
+    const int nScopes = 100000;
+    DQMStageTimers timers;
+    size_t stage = timers.addStage("fill");
+    measure("stage_timer", "threads", nThreads, "scope", [&]() {
+      std::vector<std::thread> threads;
+      for (int t = 0; t < nThreads; ++t) {
+	threads.emplace_back([&] { for (int i = 0; i < nScopes; ++i) DQMStageTimers::Scope scope = timers.time(stage); });
+      }
+      for (std::thread& t : threads) t.join();
+      return std::make_pair(double(nThreads*nScopes), double(nThreads*nScopes));
+    });
+    timers.interval();
+  }
+
+  // the sets are published as TrackerDQM does: one directory per plane
+  std::map<std::string, std::vector<TH1*>> trackerPacket(DQMHistSet& set, bool pedestals) {
+    std::map<std::string, std::vector<TH1*>> packet;
+    int perPlane = set.size()/mu2e::StrawId::_nplanes;
+    for (size_t i = 0; i < set.size(); ++i) {
+      std::string dir = (set.size() < size_t(mu2e::StrawId::_nplanes)) ? std::string("Tracker_summary")
+	: std::string(pedestals ? "Tracker_pedestals" : "Tracker_panels") + "/plane_" + std::to_string(i/perPlane);
+      packet[dir].push_back(set.hist(i));
+    }
+    return packet;
+  }
+
+  size_t benchPublish(const std::string& setName, DQMHistSet& set, bool pedestals, TBufferFile& buffer) {
+    std::map<std::string, std::vector<TH1*>> source = trackerPacket(set, pedestals);
+    uint32_t sequence = 0;
+    measure("publish_serialize", setName, set.size(), "histogram", [&]() {
+      std::map<std::string, std::vector<TH1*>> snapshot;
+      for (auto& dir : source) {
+	for (TH1* h : dir.second) snapshot[dir.first].push_back((TH1*)h->Clone());
+      }
+      writeDQMPacket(buffer, 1, sequence++, snapshot);
+      for (auto& dir : snapshot) {
+	for (TH1* h : dir.second) delete h;
+      }
+      return std::make_pair(1., double(set.size()));
+    });
+    results.back().bytes = results.back().events*buffer.Length();
+    return buffer.Length();
+  }
+
+  // a loopback port free at the time of the call
+  int freePort() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = 0;
+    socklen_t length = sizeof(addr);
+    if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || getsockname(fd, (sockaddr*)&addr, &length) != 0) {
+      if (fd >= 0) close(fd);
+      throw std::runtime_error("cannot find a free port");
+    }
+    close(fd);
+    return ntohs(addr.sin_port);
+  }
+
+  void benchTCP(const std::string& setName, double nHists, const TBufferFile& buffer, int port) {
+    static const std::string hello("hello");
+    TCPPublishServer server(port, 1);
+    server.startAccept();
+    std::atomic<long> received(0), hellos(0);
+    std::atomic<bool> running(true);
+    std::thread receiver([&]() {
+      TCPSubscribeClient client("127.0.0.1", port);
+      client.connect();
+      while (running) {
+	try {
+	  std::string packet = client.receivePacket();
+	  if (packet == hello)      ++hellos;
+	  else if (!packet.empty()) ++received;
+	} catch (...) {
+	  break;
+	}
+      }
+    });
+
+    // hello packets until the subscriber gets one: it is then connected, and
+    // the hellos still in flight are not counted as data
+    auto connected = clock_::now() + std::chrono::seconds(10);
+    while (hellos == 0 && clock_::now() < connected) {
+      server.broadcastPacket(hello.data(), hello.size());
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (hellos == 0) {
+      failures.push_back("tcp_send " + setName + ": the subscriber did not connect");
+      std::cerr << failures.back() << std::endl;
+      running = false;
+      server.broadcastPacket(hello.data(), hello.size());   // wakes up the receiver if connected late
+      receiver.join();
+      return;
+    }
+
+    // a pass is a batch of packets, done when the receiver has all of them;
+    // a batch not received within the deadline fails the case
+    size_t nBytes   = buffer.Length();
+    long   perBatch = std::max<long>(1, long(64e6/nBytes));
+    try {
+      measure("tcp_send", setName, nHists, "byte", [&]() {
+	long target = received + perBatch;
+	for (long i = 0; i < perBatch; ++i) server.broadcastPacket(buffer.Buffer(), nBytes);
+	auto deadline = clock_::now() + std::chrono::seconds(10);
+	while (received < target) {
+	  if (clock_::now() > deadline) {
+	    throw std::runtime_error(std::to_string(target - received) + " of " + std::to_string(perBatch) +
+				     " packets lost");
+	  }
+	  std::this_thread::yield();
+	}
+	return std::make_pair(double(perBatch), double(perBatch*nBytes));
+      }, nBytes);
+    } catch (const std::runtime_error& e) {
+      failures.push_back("tcp_send " + setName + ": " + e.what());
+      std::cerr << failures.back() << std::endl;
+    }
+
+    running = false;
+    server.broadcastPacket(buffer.Buffer(), nBytes);   // wakes up the receiver
+    receiver.join();
+  }
+
+  std::string json(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+      if (c == '"' || c == '\\') out += '\\';
+      out += c;
+    }
+    return out + "\"";
+  }
+
+  void writeJSON(std::ostream& out) {
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    out << "{\n  \"suite\": \"dqm_benchmark\",\n  \"format\": 1,\n"
+	<< "  \"host\": " << json(host) << ",\n"
+	<< "  \"compiler\": " << json(__VERSION__) << ",\n"
+	<< "  \"timestamp\": " << std::time(nullptr) << ",\n"
+	<< "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+	<< "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+      const result_& r = results[i];
+      out << (i ? "," : "") << "\n    {\"name\": " << json(r.name) << ", \"parameter\": " << json(r.parameter)
+	  << ", \"occupancy\": " << r.occupancy << ", \"item\": " << json(r.item)
+	  << ", \"events\": " << r.events << ", \"items\": " << r.items << ", \"seconds\": " << r.seconds
+	  << ", \"ns_per_event\": " << 1e9*r.seconds/r.events
+	  << ", \"ns_per_item\": " << (r.items > 0 ? 1e9*r.seconds/r.items : 0)
+	  << ", \"items_per_second\": " << r.items/r.seconds;
+      if (r.bytes > 0) out << ", \"bytes_per_second\": " << r.bytes/r.seconds;
+      out << "}";
+    }
+    out << "\n  ],\n  \"failures\": [";
+    for (size_t i = 0; i < failures.size(); ++i) out << (i ? ", " : "") << json(failures[i]);
+    out << "]\n}" << std::endl;
+  }
+
+} // namespace
+
+int main(int argc, char** argv) {
+  std::string outName;
+  int  port  = 0;
+  bool quick = false;
+  int  opt;
+  while ((opt = getopt(argc, argv, "o:t:r:f:p:q")) != -1) {
+    switch (opt) {
+    case 'o': outName     = optarg; break;
+    case 't': minSeconds  = atof(optarg); break;
+    case 'r': repetitions = atoi(optarg); break;
+    case 'f': filter      = optarg; break;
+    case 'p': port        = atoi(optarg); break;
+    case 'q': quick       = true; break;
+    default:
+      std::cerr << "usage: " << argv[0] << " [-o file.json] [-t minSeconds] [-r repetitions] [-f nameFilter] [-p port] [-q]" << std::endl;
+      return 1;
+    }
+  }
+  if (quick) {
+    minSeconds  = 0.01;
+    repetitions = 1;
+  }
+  TH1::AddDirectory(kFALSE);
+
+  // tracker: quiet, nominal and noisy panels
+  DQMHistSet summary("Tracker_summary"), pedestals("Tracker_pedestals"), panels("Tracker_panels");
+  bookTracker(summary, pedestals, panels);
+  for (double occupancy : {2., 10., 40.}) {
+    if (!selected("waveform_features") && !selected("tracker_fill")) break;
+    std::vector<trackerEvent_> events = trackerEvents(occupancy, quick ? 5 : 50);
+    if (selected("waveform_features")) benchWaveform(occupancy, events);
+    if (selected("tracker_fill"))      benchTrackerFill(occupancy, events, summary, pedestals, panels);
+  }
+
+  if (selected("calo_summary_fill")) {
+    for (double nHits : {200., 1000., 4000.}) benchCalo(nHits);
+  }
+
+  if (selected("trigger")) {
+    for (double acceptance : {0.001, 0.01, 0.1}) benchTrigger(acceptance);
+  }
+
+  if (selected("stage_timer")) {
+    for (int nThreads : {1, 4}) benchStageTimer(nThreads);
+  }
+
+  // publish the tracker sets as filled above
+  if (selected("publish_serialize") || selected("tcp_send")) {
+    if (pedestals.hist(0)->GetEntries() == 0) {
+      std::vector<trackerEvent_> events = trackerEvents(10, 5);
+      for (const trackerEvent_& ev : events) {
+	for (size_t h = 0; h < ev.straws.size(); ++h) {
+	  mu2e::StrawId sid(ev.straws[h]);
+	  tracker_pedestal_fill(pedestals.fillBuffer, pedestal_est(ev.waveforms[h]), sid);
+	  tracker_panel_fill(panels.fillBuffer, sid);
+	}
+      }
+      pedestals.fillBuffer.Flush();
+      panels.fillBuffer.Flush();
+    }
+    struct set_ { const char* name; DQMHistSet* set; bool pedestals; };
+    for (const set_& s : {set_{"summary", &summary, false}, set_{"panels", &panels, false}, set_{"pedestals", &pedestals, true}}) {
+      TBufferFile buffer(TBuffer::kWrite);
+      if (selected("publish_serialize")) benchPublish(s.name, *s.set, s.pedestals, buffer);
+      else writeDQMPacket(buffer, 1, 0, trackerPacket(*s.set, s.pedestals));
+      if (selected("tcp_send")) benchTCP(s.name, s.set->size(), buffer, port > 0 ? port : freePort());
+    }
+  }
+
+  if (outName.empty()) {
+    writeJSON(std::cout);
+  } else {
+    std::ofstream out(outName);
+    writeJSON(out);
+    if (!out) {
+      std::cerr << "cannot write " << outName << std::endl;
+      return 1;
+    }
+  }
+  return failures.empty() ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+// Tests of the art-free DQM fill engines (otsdaq-mu2e-dqm/DQMEngine):
+// the fill buffer gives the same histograms as direct fills on both its
+// sparse and dense paths, the schemas book in enum order, and the tracker
+// and calo fills land in the expected histograms; the stage timers bucket
+// and merge the threads as documented; the memory accounting counts the bin
+// arrays and the degradation keeps the range and the statistics.
+
+#include "otsdaq-mu2e-dqm/DQMEngine/CaloFillEngine.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistMemory.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMHistSet.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/DQMStageTimers.h"
+#include "otsdaq-mu2e-dqm/DQMEngine/TrackerFillEngine.h"
+
+#include <TH1F.h>
+#include <TH2F.h>
+
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace ots;
+
+namespace {
+
+  int nFailed = 0;
+
+  void check(bool ok, const char* what) {
+    if (ok) return;
+    std::cerr << "FAILED: " << what << std::endl;
+    ++nFailed;
+  }
+
+  bool sameContent(const TH1* a, const TH1* b) {
+    if (a->GetNbinsX() != b->GetNbinsX() || a->GetEntries() != b->GetEntries()) return false;
+    for (int i = 0; i <= a->GetNbinsX() + 1; ++i) {
+      if (a->GetBinContent(i) != b->GetBinContent(i)) return false;
+    }
+    return true;
+  }
+
+  // nValues fills spread over nHists histograms, through the buffer and directly
+  void testFillBuffer(size_t nHists, size_t nValues) {
+    DQMHistSet buffered("buffered"), direct("direct");
+    for (size_t i = 0; i < nHists; ++i) {
+      buffered.add("b" + std::to_string(i), 50, 0, 100);
+      direct.add("d" + std::to_string(i), 50, 0, 100);
+    }
+    std::mt19937 gen(nHists*nValues);
+    std::uniform_int_distribution<size_t> pick(0, nHists - 1);
+    std::uniform_real_distribution<double> value(-10, 110);
+    for (size_t i = 0; i < nValues; ++i) {
+      size_t id = pick(gen);
+      double v  = value(gen);
+      buffered.fillBuffer.Add(id, v);
+      direct.hist(id)->Fill(v);
+    }
+    buffered.fillBuffer.Add(nHists, 1.);  // not booked: dropped
+    buffered.fillBuffer.Flush();
+    check(buffered.fillBuffer.size() == 0, "fill buffer empty after flush");
+
+    bool same = true;
+    for (size_t i = 0; i < nHists; ++i) same = same && sameContent(buffered.hist(i), direct.hist(i));
+    check(same, nValues*16 < nHists ? "sparse flush matches direct fills" : "dense flush matches direct fills");
+  }
+
+  struct cluster_ {
+    double e;
+    double energyDep() const { return e; }
+  };
+
+} // namespace
+
+int main() {
+  TH1::AddDirectory(kFALSE);
+
+  testFillBuffer(1000, 20);    // sparse: sorted path
+  testFillBuffer(10, 10000);   // dense: counting sort
+
+  // schema booking
+  DQMHistSet calo("Calo_summary");
+  calo.book(kCaloOnspillSchema);
+  check(calo.size() == kNCaloSummaryHists, "calo schema booked");
+  check(std::string(calo.hist(kCaloClusterEnergy)->GetName()) == kCaloOnspillSchema[kCaloClusterEnergy].title,
+	"calo schema in enum order");
+  bool refused = false;
+  try {
+    calo.book(kCaloOnspillSchema);
+  } catch (const std::logic_error&) {
+    refused = true;
+  }
+  check(refused, "booking into a non-empty set is refused");
+
+  std::vector<cluster_> clusters = {{50.}, {105.}, {1500.}};
+  calo_summary_fill(calo.fillBuffer, 1234, clusters);
+  calo.fillBuffer.Flush();
+  check(calo.hist(kCaloNHits)->GetEntries() == 1 && calo.hist(kCaloNClusters)->GetMean() == 3, "calo summary fill");
+  check(calo.hist(kCaloClusterEnergy)->GetEntries() == 3, "calo cluster energies");
+  schemaFill(&calo, kCaloNHits, 10);
+  calo.fillBuffer.Flush();
+  check(calo.hist(kCaloNHits)->GetEntries() == 2 && calo.hist(kCaloNClusters)->GetEntries() == 1, "schema fill by enum");
+
+  // tracker
+  mu2e::TrkTypes::ADCWaveform adcs = {100, 102, 104, 400, 380};
+  check(pedestal_est(adcs) == 102, "pedestal estimate");
+  check(max_adc(adcs) == 400, "max adc");
+  check(pedestal_est(mu2e::TrkTypes::ADCWaveform()) == 0, "empty waveform pedestal");
+
+  DQMHistSet tracker("Tracker_summary");
+  tracker.book(kTrackerSummarySchema);
+  mu2e::StrawId sid(3, 2, 7);
+  tracker_summary_fill(tracker.fillBuffer, sid);
+  tracker.fillBuffer.Flush();
+  check(tracker.hist(kTrackerPlaneOccupancy)->GetMean() == 3, "plane occupancy");
+  check(tracker.hist(kTrackerPanelOccupancy)->GetMean() == sid.uniquePanel(), "panel occupancy");
+
+  DQMHistSet panels("Tracker_panels");
+  for (int i = 0; i < mu2e::StrawId::_nplanes*mu2e::StrawId::_npanels; ++i) panels.add("Panel_" + std::to_string(i), 100, 0, 100);
+  check(tracker_panel_fill(panels.fillBuffer, sid), "booked panel accepted");
+  check(!tracker_pedestal_fill(panels.fillBuffer, 100, mu2e::StrawId(35, 5, 95)), "unbooked pedestal refused");
+  panels.fillBuffer.Flush();
+  check(panels.hist(panel_hist_id(sid))->GetMean() == 7, "panel fill lands on the straw");
+
+  // stage timers
+  bool monotonic = true;
+  for (uint64_t ns = 1; ns < (1ull << 40); ns += 1 + ns/7) {
+    size_t b = DQMStageTimers::bucket(ns);
+    monotonic &= DQMStageTimers::bucketLow(b) <= ns && ns < DQMStageTimers::bucketHigh(b);
+  }
+  check(monotonic, "timer buckets contain their values");
+
+  DQMStageTimers timers;
+  size_t fill    = timers.addStage("fill");
+  size_t publish = timers.addStage("publish");
+  std::thread other([&] { for (int i = 0; i < 100; ++i) timers.record(fill, 1000); });
+  for (int i = 0; i < 100; ++i) timers.record(fill, 3000);
+  other.join();
+  timers.record(publish, 1000000);
+  std::vector<DQMStageTimers::summary_t> interval = timers.interval();
+  check(interval[fill].n == 200 && interval[fill].mean == 2000, "timer threads merged");
+  check(interval[fill].p50 > 900 && interval[fill].p50 < 1200 && interval[fill].p99 > 2800 && interval[fill].p99 < 3600, "timer percentiles");
+  check(interval[publish].n == 1 && interval[publish].max >= 1000000, "timer max");
+  { DQMStageTimers::Scope scope = timers.time(fill); }
+  interval = timers.interval();
+  check(interval[fill].n == 1 && interval[publish].n == 0, "timer interval since the previous call");
+  bool full = false;
+  try {
+    for (size_t st = timers.nStages(); st <= DQMStageTimers::kMaxStages; ++st) timers.addStage("extra");
+  } catch (const std::logic_error&) {
+    full = timers.nStages() == DQMStageTimers::kMaxStages;
+  }
+  check(full, "timer stages beyond the table refused");
+
+  // memory accounting and degradation
+  TH1F wide("wide", "wide", 120, 0, 120);
+  TH1D dense("dense", "dense", 120, 0, 120);
+  wide.SetDirectory(nullptr);
+  dense.SetDirectory(nullptr);
+  check(DQMMemoryUsage::histBinBytes(&wide) == 122*sizeof(float), "TH1F bin bytes");
+  check(DQMMemoryUsage::histBinBytes(&dense) == 122*sizeof(double), "TH1D bin bytes");
+  DQMMemoryUsage usage;
+  usage.addHist(&wide);
+  usage.addHist(nullptr);
+  check(usage.bins == 122*sizeof(float) && usage.objects > 0, "usage of a set");
+
+  for (int i = 0; i < 120; ++i) wide.Fill(i + 0.5);
+  double mean = wide.GetMean();
+  degradeHist(&wide, kCoarseBinning);
+  check(wide.GetNbinsX() == 60 && wide.GetEntries() == 120 && wide.GetMean() == mean, "coarse binning keeps the stats");
+  degradeHist(&wide, kStatsOnly);
+  check(wide.GetNbinsX() == 1 && wide.GetEntries() == 120 && wide.GetMean() == mean, "stats only keeps the stats");
+  check(DQMMemoryUsage::histBinBytes(&wide) == 3*sizeof(float), "stats only bin bytes");
+
+  TH2F map("map", "map", 30, 0, 30, 7, 0, 7);
+  map.SetDirectory(nullptr);
+  degradeHist(&map, kCoarseBinning);
+  check(map.GetNbinsX() == 15 && map.GetNbinsY() == 1, "2D coarse binning (prime axis to one bin)");
+
+  std::cout << (nFailed == 0 ? "PASS" : "FAIL") << std::endl;
+  return nFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+// Synthetic DTC event generator (otsdaq-mu2e-dqm/DQMSim).
+//
+// Generates tracker or calo DTC events in memory and reports the generation
+// rate; optionally writes them to a file, one event after the other (each
+// event starts with its byte count), and/or reads every event back and checks
+// its structure and the hit count against the generator.
+//
+// usage: dqm_fragment_gen [options]
+//   -s tracker|calo   subsystem (tracker)
+//   -n N              events (10000)
+//   -d N              DTCs per event (1), -r N ROCs per DTC (6)
+//   -o X              mean hits per ROC and event (10)
+//   -w N              ADC samples per hit (15)
+//   -p X -P X         pedestal mean and channel spread (100, 5)
+//   -N X              noise RMS (2), -a X pulse amplitude (200)
+//   -D X -H X         dead and hot channel fractions (0, 0)
+//   -e X -h X -b X    block error, hit error and bad channel rates (0, 0, 0)
+//   -S N              seed (1)
+//   -f file           write the events to file
+//   -c                read back and check every event
+
+#include "otsdaq-mu2e-dqm/DQMSim/DTCFragmentGenerator.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace ots;
+
+namespace {
+
+  void usage(const char* name) {
+    std::cerr << "usage: " << name << " [-s tracker|calo] [-n events] [-d DTCs] [-r ROCs] [-o occupancy]"
+	      << " [-w samples] [-p pedestal] [-P spread] [-N noise] [-a amplitude] [-D dead] [-H hot]"
+	      << " [-e blockErrors] [-h hitErrors] [-b badChannels] [-S seed] [-f file] [-c]" << std::endl;
+  }
+
+} // namespace
+
+int main(int argc, char** argv) {
+  DTCGeneratorConfig config;
+  long        nEvents = 10000;
+  std::string fileName;
+  bool        check = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:n:d:r:o:w:p:P:N:a:D:H:e:h:b:S:f:c")) != -1) {
+    switch (opt) {
+    case 's':
+      if      (!strcmp(optarg, "tracker")) config.subsystem = dtc_format::kTracker;
+      else if (!strcmp(optarg, "calo"))    config.subsystem = dtc_format::kCalorimeter;
+      else { usage(argv[0]); return 1; }
+      break;
+    case 'n': nEvents               = atol(optarg); break;
+    case 'd': config.nDTCs          = atoi(optarg); break;
+    case 'r': config.nROCs          = atoi(optarg); break;
+    case 'o': config.occupancy      = atof(optarg); break;
+    case 'w': config.nSamples       = atoi(optarg); break;
+    case 'p': config.pedestal       = atof(optarg); break;
+    case 'P': config.pedestalSpread = atof(optarg); break;
+    case 'N': config.noise          = atof(optarg); break;
+    case 'a': config.pulseAmplitude = atof(optarg); break;
+    case 'D': config.deadFraction   = atof(optarg); break;
+    case 'H': config.hotFraction    = atof(optarg); break;
+    case 'e': config.blockErrorRate = atof(optarg); break;
+    case 'h': config.hitErrorRate   = atof(optarg); break;
+    case 'b': config.badChannelRate = atof(optarg); break;
+    case 'S': config.seed           = strtoull(optarg, nullptr, 0); break;
+    case 'f': fileName              = optarg; break;
+    case 'c': check                 = true; break;
+    default: usage(argv[0]); return 1;
+    }
+  }
+
+  DTCFragmentGenerator generator(config);
+  int  packetsPerHit = 0;
+
+  FILE* out = nullptr;
+  if (!fileName.empty() && !(out = fopen(fileName.c_str(), "wb"))) {
+    std::cerr << "cannot open " << fileName << std::endl;
+    return 1;
+  }
+
+  std::vector<uint8_t> buffer;
+  uint64_t nChecked = 0, hitsRead = 0, blockErrorsRead = 0;
+  double   genSeconds = 0;
+  for (long i = 0; i < nEvents; ++i) {
+    buffer.clear();
+    auto t0 = std::chrono::steady_clock::now();
+    size_t n = generator.generateEvent(i, buffer);
+    genSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    if (out && fwrite(buffer.data(), 1, n, out) != n) {
+      std::cerr << "write error on " << fileName << std::endl;
+      return 1;
+    }
+    if (!check) continue;
+
+    std::string error;
+    bool ok = walkDTCEvent(buffer.data(), n, [&](const uint8_t* subEvent, size_t size) {
+      std::string subError;
+      if (!walkDTCSubEvent(subEvent, size, [&](const DTCBlockView& block) {
+	    blockErrorsRead += (block.status != 0);
+	    if (block.packetCount == 0) return;
+	    // the hit size is fixed for a generator: from the first hit packet
+	    if (packetsPerHit == 0) {
+	      packetsPerHit = (config.subsystem == dtc_format::kTracker)
+		? 1 + (block.payload[10] & 0xF) : 1 + (block.payload[6] + 7)/8;
+	    }
+	    hitsRead += block.packetCount/packetsPerHit;
+	  }, &subError)) {
+	error = subError;
+      }
+    }, &error);
+    if (!ok || !error.empty()) {
+      std::cerr << "event " << i << ": " << error << std::endl;
+      return 2;
+    }
+    ++nChecked;
+  }
+  if (out) fclose(out);
+
+  const DTCFragmentGenerator::stats_t& stats = generator.stats();
+  double mb = stats.bytes/1048576.;
+  std::cout << nEvents << " events, " << stats.subEvents << " sub-events, " << stats.blocks << " blocks, "
+	    << stats.hits << " hits, " << mb << " MB in " << genSeconds << " s: "
+	    << (genSeconds > 0 ? nEvents/genSeconds : 0) << " events/s, "
+	    << (genSeconds > 0 ? mb/genSeconds : 0) << " MB/s" << std::endl;
+  std::cout << "injected: " << stats.blockErrors << " block errors, " << stats.hitErrors << " hit errors, "
+	    << stats.badChannels << " bad channels" << std::endl;
+
+  if (check) {
+    if (hitsRead != stats.hits || blockErrorsRead != stats.blockErrors) {
+      std::cerr << "read back " << hitsRead << " hits and " << blockErrorsRead << " block errors, generated "
+		<< stats.hits << " and " << stats.blockErrors << std::endl;
+      return 2;
+    }
+    std::cout << nChecked << " events checked" << std::endl;
+  }
+  return 0;
+}
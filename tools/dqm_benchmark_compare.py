@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+#
+# Compare two dqm_benchmark result files (test/dqm_benchmark.cc), case by
+# case (name, parameter, occupancy), on ns_per_event. Exits with 1 if a case
+# got slower than the threshold, so it can gate a release.
+#
+# usage: dqm_benchmark_compare.py reference.json candidate.json [-t 0.10]
+
+import argparse
+import json
+import sys
+
+
+def load(name):
+    with open(name) as f:
+        doc = json.load(f)
+    if doc.get('suite') != 'dqm_benchmark':
+        raise SystemExit('%s: not a dqm_benchmark result file' % name)
+    return {(r['name'], r['parameter'], r['occupancy']): r for r in doc['results']}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare two dqm_benchmark result files')
+    parser.add_argument('reference')
+    parser.add_argument('candidate')
+    parser.add_argument('-t', '--threshold', type=float, default=0.10,
+                        help='relative slowdown reported as a regression (default 0.10)')
+    args = parser.parse_args()
+
+    ref  = load(args.reference)
+    cand = load(args.candidate)
+
+    regressions = 0
+    print('%-20s %-16s %10s %14s %14s %8s' % ('case', 'parameter', 'occupancy', 'ref ns/event', 'new ns/event', 'change'))
+    for key in sorted(set(ref) | set(cand), key=lambda k: (k[0], k[1], k[2])):
+        if key not in ref or key not in cand:
+            print('%-20s %-16s %10g %s' % (key[0], key[1], key[2], 'only in ' + ('candidate' if key in cand else 'reference')))
+            continue
+        a = ref[key]['ns_per_event']
+        b = cand[key]['ns_per_event']
+        change = (b - a)/a if a > 0 else 0.
+        flag = ''
+        if change > args.threshold:
+            flag = '  REGRESSION'
+            regressions += 1
+        print('%-20s %-16s %10g %14.1f %14.1f %+7.1f%%%s' % (key[0], key[1], key[2], a, b, 100*change, flag))
+
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+#
+# Pull the buffered raw fragments of an event (or event range) from a DQM
+# module running with rawRingEvents/rawRequestPort, and write them to a file
+# as DataFragmentHeader + fragment bytes records (see
+# otsdaq-mu2e-dqm/ArtModules/detail/DataRequestMessage.hh).
+#
+# usage: dqm_raw_request.py host port first_event [last_event] [-o out.bin]
+
+import argparse
+import socket
+import struct
+
+REQUEST_MAGIC  = 0xAAAABBBBCCCCDDDD
+RESPONSE_MAGIC = 0xABCDABCDABCDABCD
+
+# DataRequestMessage: uint32 eventNumber, bool wantMWPC, bool wantSTIB,
+# (padding), uint64 request_magic, uint32 lastEventNumber, (padding)
+REQUEST  = struct.Struct('=I??2xQI4x')
+RESPONSE = struct.Struct('=QQQQ')
+FRAGMENT = struct.Struct('=QQHB5x')
+
+
+def read_all(sock, size):
+    data = bytearray()
+    while len(data) < size:
+        chunk = sock.recv(size - len(data))
+        if not chunk:
+            raise RuntimeError('connection closed after %d of %d bytes' % (len(data), size))
+        data += chunk
+    return bytes(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('host')
+    parser.add_argument('port', type=int)
+    parser.add_argument('first', type=int)
+    parser.add_argument('last', type=int, nargs='?', default=0)
+    parser.add_argument('-o', '--output', default='dqm_raw.bin')
+    args = parser.parse_args()
+
+    with socket.create_connection((args.host, args.port), timeout=10) as sock:
+        sock.sendall(REQUEST.pack(args.first, False, False, REQUEST_MAGIC, args.last))
+        count, magic, first_in_buffer, last_in_buffer = RESPONSE.unpack(read_all(sock, RESPONSE.size))
+        if magic != RESPONSE_MAGIC:
+            raise RuntimeError('invalid response')
+        print('buffer holds events %d-%d, %d fragments returned' % (first_in_buffer, last_in_buffer, count))
+
+        with open(args.output, 'wb') as out:
+            for _ in range(count):
+                header = read_all(sock, FRAGMENT.size)
+                event, size, frag_id, frag_type = FRAGMENT.unpack(header)
+                print('  event %d fragment %d type %d: %d bytes' % (event, frag_id, frag_type, size))
+                out.write(header)
+                out.write(read_all(sock, size))
+
+
+if __name__ == '__main__':
+    main()